@@ -0,0 +1,359 @@
+/*
+
+Copyright (c) 2015, John Smith
+
+Permission to use, copy, modify, and/or distribute this software for
+any purpose with or without fee is hereby granted, provided that the
+above copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+SOFTWARE.
+
+*/
+
+
+// Times the core project operations on synthetic projects.
+// Prints one JSON object per line, so the results can be compared between builds.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define PSAPI_VERSION 2
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include <QCoreApplication>
+#include <QTemporaryDir>
+
+#include "WobblyProject.h"
+
+
+static std::atomic<uint64_t> allocation_count{0};
+static std::atomic<uint64_t> allocated_bytes{0};
+
+
+void *operator new(size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+
+    void *ptr = malloc(size ? size : 1);
+    if (!ptr)
+        throw std::bad_alloc();
+
+    return ptr;
+}
+
+
+void operator delete(void *ptr) noexcept {
+    free(ptr);
+}
+
+
+void operator delete(void *ptr, size_t) noexcept {
+    free(ptr);
+}
+
+
+static int64_t getPeakRSS() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return -1;
+    return (int64_t)counters.PeakWorkingSetSize / 1024;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage))
+        return -1;
+#ifdef __APPLE__
+    return (int64_t)usage.ru_maxrss / 1024;
+#else
+    return (int64_t)usage.ru_maxrss;
+#endif
+#endif
+}
+
+
+template <typename Function>
+static void bench(const char *name, int frames, int iterations, Function &&function) {
+    uint64_t allocations_before = allocation_count;
+    uint64_t bytes_before = allocated_bytes;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < iterations; i++)
+        function(i);
+
+    auto end = std::chrono::steady_clock::now();
+
+    double wall_ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+    printf("{\"benchmark\": \"%s\", \"frames\": %d, \"iterations\": %d, \"wall_ms\": %.3f, \"allocations\": %llu, \"allocated_bytes\": %llu, \"peak_rss_kib\": %lld}\n",
+           name,
+           frames,
+           iterations,
+           wall_ms,
+           (unsigned long long)(allocation_count - allocations_before),
+           (unsigned long long)(allocated_bytes - bytes_before),
+           (long long)getPeakRSS());
+    fflush(stdout);
+}
+
+
+// Something that looks like a telecined video: 3:2 pulldown with
+// a scene change every thousand frames and the odd combed frame.
+static std::unique_ptr<WobblyProject> createProject(int num_frames) {
+    auto project = std::make_unique<WobblyProject>(true, "bench.mkv", "bs.VideoSource", 30000, 1001, 720, 480, num_frames);
+
+    project->addTrim(0, num_frames - 1);
+    project->setUndoSteps(50);
+
+    const char pattern[] = "cccnn";
+
+    for (int i = 0; i < num_frames; i++) {
+        char match = pattern[i % 5];
+        if (i % 997 == 0)
+            match = 'b';
+
+        project->setOriginalMatch(i, match);
+        project->setMatch(i, match);
+
+        int16_t low = (int16_t)(i % 7);
+        int16_t high = (int16_t)(20 + i % 13);
+        project->setMics(i, high, match == 'c' ? low : high, match == 'n' ? low : high, high, high);
+        project->setDMetrics(i, 1000 + i % 50, match == 'c' ? 100 : 5000, 800 + i % 30, match == 'c' ? 80 : 4000);
+        project->setDecimateMetric(i, i % 5 == 4 ? 10 : 5000);
+
+        if (i % 5 == 4) {
+            project->addOriginalDecimatedFrame(i);
+            project->addDecimatedFrame(i);
+        }
+
+        if (i % 211 == 0)
+            project->addCombedFrame(i);
+    }
+
+    project->addPreset("denoise", "clip = c.std.BoxBlur(clip=clip)");
+    project->addPreset("deband", "clip = c.std.Expr(clips=[clip], expr=['x'])");
+
+    for (int i = 1000; i < num_frames; i += 1000) {
+        project->addSection(i);
+
+        if (i % 3000 == 0)
+            project->setSectionPreset(i, "denoise");
+    }
+
+    project->addCustomList("deband_list");
+    project->setCustomListPreset(0, "deband");
+    for (int i = 500; i + 100 < num_frames; i += 5000)
+        project->addCustomListRange(0, i, i + 100);
+
+    for (int i = 2000; i + 10 < num_frames; i += 10000)
+        project->addFreezeFrame(i, i + 10, i - 1);
+
+    for (int i = 0; i < num_frames; i += 25000)
+        project->addBookmark(i, "bookmark " + std::to_string(i));
+
+    project->commit("Initial state");
+
+    return project;
+}
+
+
+static void benchModelData(const char *name, int frames, QAbstractItemModel *model) {
+    int rows = model->rowCount();
+    int columns = model->columnCount();
+
+    // Some of the models walk from the beginning of a std::set, so sample the rows.
+    int samples = std::min(rows, 2000);
+
+    bench(name, frames, samples, [model, rows, columns, samples] (int i) {
+        int row = (int)((int64_t)i * rows / samples);
+        for (int column = 0; column < columns; column++)
+            model->data(model->index(row, column), Qt::DisplayRole);
+    });
+}
+
+
+static void benchProject(int num_frames, const QString &directory) {
+    std::string path = QStringLiteral("%1/bench%2.wob").arg(directory).arg(num_frames).toStdString();
+
+    std::unique_ptr<WobblyProject> project;
+
+    bench("createProject", num_frames, 1, [&] (int) {
+        project = createProject(num_frames);
+    });
+
+    bench("writeProject", num_frames, 1, [&] (int) {
+        project->writeProject(path, false);
+    });
+
+    bench("writeProject compact", num_frames, 1, [&] (int) {
+        project->writeProject(path + ".compact", true);
+    });
+
+    bench("writeProject compressed", num_frames, 1, [&] (int) {
+        project->writeProject(path + ".gz", true, true);
+    });
+
+    bench("readProject", num_frames, 1, [&] (int) {
+        WobblyProject read(true);
+        read.readProject(path);
+    });
+
+    bench("readProject compressed", num_frames, 1, [&] (int) {
+        WobblyProject read(true);
+        read.readProject(path + ".gz");
+    });
+
+    bench("importFromOtherProject", num_frames, 1, [&] (int) {
+        WobblyProject target(true, "bench.mkv", "bs.VideoSource", 30000, 1001, 720, 480, num_frames);
+
+        ImportedThings imports = {};
+        imports.presets = true;
+        imports.custom_lists = true;
+        imports.crop = true;
+        target.importFromOtherProject(path, imports);
+    });
+
+    bench("commit", num_frames, 20, [&] (int i) {
+        project->setMatch(i * 1009 % num_frames, 'b');
+        project->commit("Change match");
+    });
+
+    bench("undo", num_frames, 20, [&] (int) {
+        project->undo();
+    });
+
+    // frameNumberAfterDecimation walks every cycle before the frame, so sample it.
+    bench("frameNumberAfterDecimation", num_frames, 10000, [&] (int i) {
+        project->frameNumberAfterDecimation((int)((int64_t)i * num_frames / 10000));
+    });
+
+    bench("generateFinalScript", num_frames, 5, [&] (int) {
+        project->generateFinalScript();
+    });
+
+    bench("generateFinalScript wobbly_plugin", num_frames, 5, [&] (int) {
+        FinalScriptFormat format{};
+        format.wobbly_plugin = true;
+        project->generateFinalScript(true, format);
+    });
+
+    bench("generateFinalScript variables", num_frames, 5, [&] (int) {
+        ScriptVariables variables;
+        project->generateFinalScript(true, {}, &variables);
+    });
+
+    bench("getCMatchSequences", num_frames, 5, [&] (int) {
+        project->getCMatchSequences(20);
+    });
+
+    bench("updateCMatchSequences", num_frames, 1, [&] (int) {
+        project->updateCMatchSequences();
+    });
+
+    bench("setMatch updateCMatchSequences", num_frames, 20, [&] (int i) {
+        project->setMatch(i * 1013 % num_frames, 'c');
+        project->updateCMatchSequences();
+    });
+
+    bench("setRangeMatchesFromPattern", num_frames, 20, [&] (int i) {
+        int start = i * 1013 % (num_frames / 2);
+        project->setRangeMatchesFromPattern(start, start + num_frames / 2 - 1, "cccnn");
+    });
+
+    bench("findNextPatternMismatch", num_frames, 1000, [&] (int i) {
+        project->findNextPatternMismatch((int)((int64_t)i * num_frames / 1000), "cccnn");
+    });
+
+    bench("updateEditedFrames", num_frames, 1, [&] (int) {
+        project->updateEditedFrames();
+    });
+
+    bench("findNextEditedRange", num_frames, 1000, [&] (int i) {
+        project->findNextEditedRange((int)((int64_t)i * num_frames / 1000));
+    });
+
+    bench("deleteDecimatedFrame", num_frames, 20, [&] (int i) {
+        project->deleteDecimatedFrame((i * 1013 % (num_frames / 5)) * 5 + 4);
+    });
+
+    int use_patterns = PatternCCCNN | PatternCCNNN | PatternCCCCC;
+
+    bench("guessProjectPatternsFromMatches", num_frames, 1, [&] (int) {
+        project->guessProjectPatternsFromMatches(10, UseThirdNMatchNever, DropFirstDuplicate);
+    });
+
+    bench("guessProjectPatternsFromMics", num_frames, 1, [&] (int) {
+        project->guessProjectPatternsFromMics(10, use_patterns, DropFirstDuplicate);
+    });
+
+    bench("guessProjectPatternsFromDMetrics", num_frames, 1, [&] (int) {
+        project->guessProjectPatternsFromDMetrics(10, use_patterns, DropFirstDuplicate);
+    });
+
+    bench("guessProjectPatternsFromMicsAndDMetrics", num_frames, 1, [&] (int) {
+        project->guessProjectPatternsFromMicsAndDMetrics(10, use_patterns, DropFirstDuplicate);
+    });
+
+    benchModelData("SectionsModel::data", num_frames, project->getSectionsModel());
+    benchModelData("CombedFramesModel::data", num_frames, project->getCombedFramesModel());
+    benchModelData("FrozenFramesModel::data", num_frames, project->getFrozenFramesModel());
+    benchModelData("CustomListsModel::data", num_frames, project->getCustomListsModel());
+    benchModelData("PresetsModel::data", num_frames, project->getPresetsModel());
+    benchModelData("BookmarksModel::data", num_frames, project->getBookmarksModel());
+    benchModelData("FrameRatesModel::data", num_frames, project->getFrameRatesModel());
+    benchModelData("CMatchSequencesModel::data", num_frames, project->getCMatchSequencesModel());
+    benchModelData("EditedFramesModel::data", num_frames, project->getEditedFramesModel());
+}
+
+
+int main(int argc, char **argv) {
+    QCoreApplication app(argc, argv);
+
+    std::vector<int> sizes;
+    for (int i = 1; i < argc; i++) {
+        int frames = atoi(argv[i]);
+        if (frames < 1000) {
+            fprintf(stderr, "Usage: %s [number of frames]...\nEvery project must have at least 1000 frames.\n", argv[0]);
+            return 1;
+        }
+        sizes.push_back(frames);
+    }
+
+    if (sizes.empty())
+        sizes = { 10000, 100000, 500000 };
+
+    QTemporaryDir directory;
+    if (!directory.isValid()) {
+        fprintf(stderr, "Failed to create a temporary directory.\n");
+        return 1;
+    }
+
+    try {
+        for (int frames : sizes)
+            benchProject(frames, directory.path());
+    } catch (WobblyException &e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}
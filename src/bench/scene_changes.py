@@ -0,0 +1,77 @@
+# Compares wobbly.SceneChanges with Scxvid on real clips.
+# Prints one JSON object per line: the time each detector took, and how well
+# the scene changes found by wobbly.SceneChanges agree with Scxvid's.
+#
+# Usage: python scene_changes.py [--threshold 0.15] [--tolerance 1] clip...
+
+import argparse
+import json
+import time
+
+import vapoursynth as vs
+
+core = vs.core
+
+
+def collect(clip):
+    start = time.perf_counter()
+
+    # Scxvid must see the frames in order.
+    found = [n for n, frame in enumerate(clip.frames()) if frame.props.get('_SceneChangePrev', 0)]
+
+    return found, (time.perf_counter() - start) * 1000
+
+
+def agreement(reference, found, tolerance):
+    matched_reference = set()
+    matched = 0
+
+    for n in found:
+        for other in range(n - tolerance, n + tolerance + 1):
+            if other in reference and other not in matched_reference:
+                matched_reference.add(other)
+                matched += 1
+                break
+
+    precision = matched / len(found) if found else 1.0
+    recall = len(matched_reference) / len(reference) if reference else 1.0
+
+    return precision, recall
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--threshold', type=float, default=0.15)
+    parser.add_argument('--tolerance', type=int, default=1, help='frames by which the scene changes may be apart and still agree')
+    parser.add_argument('--source-filter', default='bs.VideoSource')
+    parser.add_argument('clips', nargs='+')
+    args = parser.parse_args()
+
+    namespace, function = args.source_filter.split('.')
+
+    for path in args.clips:
+        src = getattr(getattr(core, namespace), function)(path)
+
+        # Index the file before timing anything.
+        src.get_frame(0)
+
+        scxvid, scxvid_ms = collect(core.scxvid.Scxvid(clip=src, use_slices=True))
+        wobbly, wobbly_ms = collect(core.wobbly.SceneChanges(clip=src, threshold=args.threshold))
+
+        precision, recall = agreement(set(scxvid), wobbly, args.tolerance)
+
+        print(json.dumps({
+            'clip': path,
+            'frames': src.num_frames,
+            'threshold': args.threshold,
+            'scxvid_ms': round(scxvid_ms, 3),
+            'wobbly_ms': round(wobbly_ms, 3),
+            'scxvid_scene_changes': len(scxvid),
+            'wobbly_scene_changes': len(wobbly),
+            'precision': round(precision, 4),
+            'recall': round(recall, 4),
+        }), flush=True)
+
+
+if __name__ == '__main__':
+    main()
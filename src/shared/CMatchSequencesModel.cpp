@@ -0,0 +1,81 @@
+/*
+
+Copyright (c) 2015, John Smith
+
+Permission to use, copy, modify, and/or distribute this software for
+any purpose with or without fee is hereby granted, provided that the
+above copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+SOFTWARE.
+
+*/
+
+
+#include "CMatchSequencesModel.h"
+
+CMatchSequencesModel::CMatchSequencesModel(QObject *parent)
+    : RangeVectorModel(parent)
+{
+
+}
+
+
+int CMatchSequencesModel::columnCount(const QModelIndex &parent) const {
+    if (parent.isValid())
+        return 0;
+
+    return ColumnCount;
+}
+
+
+QVariant CMatchSequencesModel::data(const QModelIndex &index, int role) const {
+    if (role == Qt::DisplayRole) {
+        const FrameRange &sequence = rows[index.row()];
+
+        if (index.column() == StartColumn)
+            return QVariant(sequence.first);
+        else if (index.column() == LengthColumn)
+            return QVariant(sequence.last - sequence.first + 1);
+    } else if (role == Qt::TextAlignmentRole) {
+        return QVariant(int(Qt::AlignRight | Qt::AlignVCenter));
+    }
+
+    return QVariant();
+}
+
+
+QVariant CMatchSequencesModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    const char *column_headers[ColumnCount] = {
+        "Start",
+        "Length"
+    };
+
+    if (role == Qt::DisplayRole) {
+        if (orientation == Qt::Horizontal) {
+            return QVariant(QString(column_headers[section]));
+        } else if (orientation == Qt::Vertical) {
+            return QVariant(section + 1);
+        }
+    }
+
+    return QVariant();
+}
+
+
+void CMatchSequencesModel::replaceSequences(int first, int last, const std::vector<FrameRange> &sequences) {
+    auto compare = [] (const FrameRange &sequence, int frame) {
+        return sequence.first < frame;
+    };
+
+    int first_row = (int)(std::lower_bound(rows.cbegin(), rows.cend(), first, compare) - rows.cbegin());
+    int end_row = (int)(std::lower_bound(rows.cbegin(), rows.cend(), last + 1, compare) - rows.cbegin());
+
+    replaceRows(first_row, end_row - first_row, sequences.cbegin(), sequences.cend());
+}
@@ -0,0 +1,51 @@
+/*
+
+Copyright (c) 2015, John Smith
+
+Permission to use, copy, modify, and/or distribute this software for
+any purpose with or without fee is hereby granted, provided that the
+above copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+SOFTWARE.
+
+*/
+
+
+#ifndef CMATCHSEQUENCESMODEL_H
+#define CMATCHSEQUENCESMODEL_H
+
+#include "FrameRangesModel.h"
+#include "RangeVectorModel.h"
+
+
+// The runs of consecutive 'c' matches that are at least as long as the minimum.
+class CMatchSequencesModel : public RangeVectorModel<FrameRange> {
+    Q_OBJECT
+
+public:
+    enum Columns {
+        StartColumn = 0,
+        LengthColumn,
+        ColumnCount
+    };
+
+    CMatchSequencesModel(QObject *parent = Q_NULLPTR);
+
+    int columnCount(const QModelIndex &parent = QModelIndex()) const;
+
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+
+    // Replaces the sequences that start between first and last.
+    void replaceSequences(int first, int last, const std::vector<FrameRange> &sequences);
+};
+
+#endif // CMATCHSEQUENCESMODEL_H
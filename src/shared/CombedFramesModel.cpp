@@ -103,3 +103,16 @@ void CombedFramesModel::clear() {
 
     endRemoveRows();
 }
+
+
+// Replaces the whole set in one go. The frames must be sorted.
+void CombedFramesModel::assign(const std::vector<int> &frames) {
+    beginResetModel();
+
+    std::set<int>::clear();
+
+    for (size_t i = 0; i < frames.size(); i++)
+        std::set<int>::insert(std::set<int>::cend(), frames[i]);
+
+    endResetModel();
+}
@@ -22,6 +22,7 @@ SOFTWARE.
 #define COMBEDFRAMESMODEL_H
 
 #include <set>
+#include <vector>
 
 #include <QAbstractListModel>
 
@@ -51,6 +52,8 @@ public:
     void erase(int frame);
 
     void clear();
+
+    void assign(const std::vector<int> &frames);
 };
 
 #endif // COMBEDFRAMESMODEL_H
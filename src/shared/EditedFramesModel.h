@@ -0,0 +1,64 @@
+/*
+
+Copyright (c) 2015, John Smith
+
+Permission to use, copy, modify, and/or distribute this software for
+any purpose with or without fee is hereby granted, provided that the
+above copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+SOFTWARE.
+
+*/
+
+
+
+#ifndef EDITEDFRAMESMODEL_H
+#define EDITEDFRAMESMODEL_H
+
+#include "RangeVectorModel.h"
+
+
+struct EditedRange {
+    int first;
+    int last;
+    int matches;        // Frames whose match differs from the original one.
+    int decimations;    // Frames whose decimation differs from the original one.
+
+    bool operator==(const EditedRange &other) const = default;
+};
+
+
+// The runs of consecutive frames where the matches or the decimation
+// were changed from what the field matcher and the decimator chose.
+class EditedFramesModel : public RangeVectorModel<EditedRange> {
+    Q_OBJECT
+
+public:
+    enum Columns {
+        StartColumn = 0,
+        EndColumn,
+        MatchesColumn,
+        DecimationsColumn,
+        ColumnCount
+    };
+
+    EditedFramesModel(QObject *parent = Q_NULLPTR);
+
+    int columnCount(const QModelIndex &parent = QModelIndex()) const;
+
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+
+    // Replaces the ranges that start between first and last.
+    void replaceRanges(int first, int last, const std::vector<EditedRange> &ranges);
+};
+
+#endif // EDITEDFRAMESMODEL_H
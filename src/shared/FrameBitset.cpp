@@ -0,0 +1,156 @@
+/*
+
+Copyright (c) 2015, John Smith
+
+Permission to use, copy, modify, and/or distribute this software for
+any purpose with or without fee is hereby granted, provided that the
+above copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+SOFTWARE.
+
+*/
+
+
+
+#include <bit>
+
+#include "FrameBitset.h"
+
+
+void FrameBitset::resize(int frames) {
+    words.resize((frames + 63) / 64, 0);
+
+    // Bits past the end must stay clear for the searches.
+    if (frames < num_frames && frames % 64)
+        words.back() &= ~(~(uint64_t)0 << (frames % 64));
+
+    num_frames = frames;
+}
+
+
+int FrameBitset::size() const {
+    return num_frames;
+}
+
+
+bool FrameBitset::test(int frame) const {
+    return (words[frame / 64] >> (frame % 64)) & 1;
+}
+
+
+void FrameBitset::set(int frame, bool value) {
+    uint64_t bit = (uint64_t)1 << (frame % 64);
+
+    if (value)
+        words[frame / 64] |= bit;
+    else
+        words[frame / 64] &= ~bit;
+}
+
+
+int FrameBitset::count(int first, int last) const {
+    int total = 0;
+
+    for (int i = first / 64; i <= last / 64; i++) {
+        uint64_t word = words[i];
+
+        if (i == first / 64)
+            word &= ~(uint64_t)0 << (first % 64);
+        if (i == last / 64 && last % 64 != 63)
+            word &= ~(~(uint64_t)0 << (last % 64 + 1));
+
+        total += std::popcount(word);
+    }
+
+    return total;
+}
+
+
+int FrameBitset::findFirstSet(int frame) const {
+    if (frame < 0)
+        frame = 0;
+    if (frame >= num_frames)
+        return -1;
+
+    int i = frame / 64;
+    uint64_t word = words[i] & (~(uint64_t)0 << (frame % 64));
+
+    while (!word) {
+        if (++i == (int)words.size())
+            return -1;
+        word = words[i];
+    }
+
+    return i * 64 + std::countr_zero(word);
+}
+
+
+int FrameBitset::findLastSet(int frame) const {
+    if (frame >= num_frames)
+        frame = num_frames - 1;
+    if (frame < 0)
+        return -1;
+
+    int i = frame / 64;
+    uint64_t word = words[i];
+    if (frame % 64 != 63)
+        word &= ~(~(uint64_t)0 << (frame % 64 + 1));
+
+    while (!word) {
+        if (--i < 0)
+            return -1;
+        word = words[i];
+    }
+
+    return i * 64 + 63 - std::countl_zero(word);
+}
+
+
+int FrameBitset::findFirstClear(int frame) const {
+    if (frame < 0)
+        frame = 0;
+    if (frame >= num_frames)
+        return num_frames;
+
+    int i = frame / 64;
+    uint64_t word = ~words[i] & (~(uint64_t)0 << (frame % 64));
+
+    while (!word) {
+        if (++i == (int)words.size())
+            return num_frames;
+        word = ~words[i];
+    }
+
+    // The bits past the end are clear too.
+    int found = i * 64 + std::countr_zero(word);
+
+    return found < num_frames ? found : num_frames;
+}
+
+
+int FrameBitset::findLastClear(int frame) const {
+    if (frame >= num_frames)
+        frame = num_frames - 1;
+    if (frame < 0)
+        return -1;
+
+    int i = frame / 64;
+    uint64_t word = ~words[i];
+    if (frame % 64 != 63)
+        word &= ~(~(uint64_t)0 << (frame % 64 + 1));
+
+    while (!word) {
+        if (--i < 0)
+            return -1;
+        word = ~words[i];
+    }
+
+    return i * 64 + 63 - std::countl_zero(word);
+}
@@ -0,0 +1,59 @@
+/*
+
+Copyright (c) 2015, John Smith
+
+Permission to use, copy, modify, and/or distribute this software for
+any purpose with or without fee is hereby granted, provided that the
+above copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+SOFTWARE.
+
+*/
+
+
+
+#ifndef FRAMEBITSET_H
+#define FRAMEBITSET_H
+
+#include <cstdint>
+#include <vector>
+
+
+// One bit per frame. The searches look at 64 frames at a time.
+class FrameBitset {
+    std::vector<uint64_t> words;
+    int num_frames = 0;
+
+public:
+    // New frames are clear.
+    void resize(int frames);
+
+    int size() const;
+
+    bool test(int frame) const;
+    void set(int frame, bool value);
+
+    // Number of set frames between first and last.
+    int count(int first, int last) const;
+
+    // First set frame at or after frame, or -1.
+    int findFirstSet(int frame) const;
+
+    // Last set frame at or before frame, or -1.
+    int findLastSet(int frame) const;
+
+    // First clear frame at or after frame, or size().
+    int findFirstClear(int frame) const;
+
+    // Last clear frame at or before frame, or -1.
+    int findLastClear(int frame) const;
+};
+
+#endif // FRAMEBITSET_H
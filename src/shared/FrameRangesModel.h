@@ -27,6 +27,8 @@ SOFTWARE.
 struct FrameRange {
     int first;
     int last;
+
+    bool operator==(const FrameRange &) const = default;
 };
 
 
@@ -0,0 +1,143 @@
+/*
+
+Copyright (c) 2015, John Smith
+
+Permission to use, copy, modify, and/or distribute this software for
+any purpose with or without fee is hereby granted, provided that the
+above copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+SOFTWARE.
+
+*/
+
+
+#include "FrameRatesModel.h"
+
+FrameRatesModel::FrameRatesModel(QObject *parent)
+    : RangeVectorModel(parent)
+    , num_frames(0)
+{
+
+}
+
+
+int FrameRatesModel::columnCount(const QModelIndex &parent) const {
+    if (parent.isValid())
+        return 0;
+
+    return ColumnCount;
+}
+
+
+QVariant FrameRatesModel::data(const QModelIndex &index, int role) const {
+    const char *rates[] = {
+        "30000/1001",
+        "24000/1001",
+        "18000/1001",
+        "12000/1001",
+        "6000/1001"
+    };
+
+    const DecimationRange &range = rows[index.row()];
+
+    int end = (size_t)index.row() + 1 < rows.size() ? rows[index.row() + 1].start - 1 : num_frames - 1;
+
+    if (role == Qt::DisplayRole) {
+        if (index.column() == StartColumn)
+            return QVariant(range.start);
+        else if (index.column() == EndColumn)
+            return QVariant(end);
+        else if (index.column() == FrameRateColumn)
+            return QVariant(QString(rates[range.num_dropped]));
+        else if (index.column() == LengthColumn)
+            return QVariant(end - range.start + 1);
+    } else if (role == NumDroppedRole) {
+        if (index.column() == FrameRateColumn)
+            return QVariant(range.num_dropped);
+    } else if (role == Qt::TextAlignmentRole) {
+        return QVariant(int(Qt::AlignRight | Qt::AlignVCenter));
+    }
+
+    return QVariant();
+}
+
+
+QVariant FrameRatesModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    const char *column_headers[ColumnCount] = {
+        "Start",
+        "End",
+        "Frame rate",
+        "Length"
+    };
+
+    if (role == Qt::DisplayRole) {
+        if (orientation == Qt::Horizontal) {
+            return QVariant(QString(column_headers[section]));
+        } else if (orientation == Qt::Vertical) {
+            return QVariant(section + 1);
+        }
+    }
+
+    return QVariant();
+}
+
+
+void FrameRatesModel::setNumFrames(int frames) {
+    if (num_frames == frames)
+        return;
+
+    num_frames = frames;
+
+    if (rows.size())
+        emit dataChanged(index((int)rows.size() - 1, EndColumn), index((int)rows.size() - 1, LengthColumn));
+}
+
+
+void FrameRatesModel::setCycle(int cycle, int num_dropped) {
+    int cycle_start = cycle * 5;
+
+    auto it = std::upper_bound(rows.cbegin(), rows.cend(), cycle_start, [] (int frame, const DecimationRange &range) {
+        return frame < range.start;
+    });
+
+    if (it == rows.cbegin())
+        return;
+
+    int row = (int)(it - rows.cbegin()) - 1;
+    const DecimationRange &range = rows[row];
+
+    if (range.num_dropped == num_dropped)
+        return;
+
+    int range_end = (size_t)row + 1 < rows.size() ? rows[row + 1].start : num_frames;
+    int last_cycle = (range_end - 1) / 5;
+
+    // The range is split around the cycle, which may join the ranges on either side.
+    int first_row = row;
+    int last_row = row;
+
+    std::vector<DecimationRange> new_rows;
+
+    if (range.start < cycle_start) {
+        new_rows.push_back(range);
+    } else if (row > 0 && rows[row - 1].num_dropped == num_dropped) {
+        first_row = row - 1;
+        cycle_start = rows[row - 1].start;
+    }
+
+    new_rows.push_back({ cycle_start, num_dropped });
+
+    if (cycle < last_cycle)
+        new_rows.push_back({ (cycle + 1) * 5, range.num_dropped });
+    else if ((size_t)row + 1 < rows.size() && rows[row + 1].num_dropped == num_dropped)
+        last_row = row + 1;
+
+    replaceRows(first_row, last_row - first_row + 1, new_rows.cbegin(), new_rows.cend());
+}
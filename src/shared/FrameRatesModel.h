@@ -0,0 +1,60 @@
+/*
+
+Copyright (c) 2015, John Smith
+
+Permission to use, copy, modify, and/or distribute this software for
+any purpose with or without fee is hereby granted, provided that the
+above copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+SOFTWARE.
+
+*/
+
+
+#ifndef FRAMERATESMODEL_H
+#define FRAMERATESMODEL_H
+
+#include "RangeVectorModel.h"
+#include "WobblyTypes.h"
+
+
+// The stretches of cycles with the same number of decimated frames.
+class FrameRatesModel : public RangeVectorModel<DecimationRange> {
+    Q_OBJECT
+
+    int num_frames;
+
+public:
+    enum Columns {
+        StartColumn = 0,
+        EndColumn,
+        FrameRateColumn,
+        LengthColumn,
+        ColumnCount
+    };
+
+    // Qt::UserRole in FrameRateColumn is the number of frames dropped per cycle.
+    static const int NumDroppedRole = Qt::UserRole;
+
+    FrameRatesModel(QObject *parent = Q_NULLPTR);
+
+    int columnCount(const QModelIndex &parent = QModelIndex()) const;
+
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+
+    void setNumFrames(int frames);
+
+    // The number of frames dropped in a cycle changed.
+    void setCycle(int cycle, int num_dropped);
+};
+
+#endif // FRAMERATESMODEL_H
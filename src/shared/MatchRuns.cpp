@@ -0,0 +1,319 @@
+/*
+
+Copyright (c) 2015, John Smith
+
+Permission to use, copy, modify, and/or distribute this software for
+any purpose with or without fee is hereby granted, provided that the
+above copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+SOFTWARE.
+
+*/
+
+
+#include <algorithm>
+
+#include "MatchRuns.h"
+
+
+MatchRuns::const_iterator MatchRuns::cbegin() const {
+    return runs.cbegin();
+}
+
+
+MatchRuns::const_iterator MatchRuns::cend() const {
+    return runs.cend();
+}
+
+
+size_t MatchRuns::size() const {
+    return runs.size();
+}
+
+
+// Forgets the parts of the pattern that no frame of the run uses anymore.
+void MatchRuns::restrictPattern(MatchRun &run) {
+    if (run.last - run.first + 1 >= 5)
+        return;
+
+    std::array<char, 5> pattern = {};
+    for (int i = run.first; i <= run.last; i++)
+        pattern[i % 5] = run.pattern[i % 5];
+
+    run.pattern = pattern;
+}
+
+
+bool MatchRuns::canJoin(const MatchRun &a, const MatchRun &b) {
+    for (int i = 0; i < 5; i++)
+        if (a.pattern[i] && b.pattern[i] && a.pattern[i] != b.pattern[i])
+            return false;
+
+    return true;
+}
+
+
+bool MatchRuns::hasOnly(const MatchRun &run, char match) {
+    for (int i = 0; i < 5; i++)
+        if (run.pattern[i] && run.pattern[i] != match)
+            return false;
+
+    return true;
+}
+
+
+// Makes a run start at frame, if a run contains it.
+void MatchRuns::splitAt(int frame) {
+    auto it = runs.upper_bound(frame);
+    if (it == runs.begin())
+        return;
+    it--;
+
+    MatchRun &left = it->second;
+    if (left.first == frame || left.last < frame)
+        return;
+
+    MatchRun right = left;
+    right.first = frame;
+    left.last = frame - 1;
+
+    restrictPattern(left);
+    restrictPattern(right);
+
+    runs.emplace_hint(std::next(it), frame, right);
+}
+
+
+// Joins the run that starts at frame with the one before it, if they have compatible patterns.
+void MatchRuns::joinAt(int frame) {
+    auto it = runs.find(frame);
+    if (it == runs.end() || it == runs.begin())
+        return;
+
+    MatchRun &left = std::prev(it)->second;
+    const MatchRun &right = it->second;
+
+    if (left.last + 1 != right.first || !canJoin(left, right))
+        return;
+
+    for (int i = 0; i < 5; i++)
+        if (!left.pattern[i])
+            left.pattern[i] = right.pattern[i];
+    left.last = right.last;
+
+    runs.erase(it);
+}
+
+
+// Covers the frames with runs, each as long as possible, without looking at the runs around them.
+void MatchRuns::addFrames(const char *matches, int first, int last) {
+    auto hint = runs.lower_bound(first);
+
+    int i = first;
+    while (i <= last) {
+        MatchRun run = { i, i, {} };
+        run.pattern[i % 5] = matches[i];
+
+        int j = i + 1;
+        for ( ; j <= last; j++) {
+            char &slot = run.pattern[j % 5];
+            if (slot && slot != matches[j])
+                break;
+            slot = matches[j];
+        }
+
+        run.last = j - 1;
+
+        hint = std::next(runs.emplace_hint(hint, i, run));
+
+        i = j;
+    }
+}
+
+
+void MatchRuns::fill(char match, int num_frames) {
+    runs.clear();
+
+    if (num_frames < 1)
+        return;
+
+    MatchRun run = { 0, num_frames - 1, {} };
+    run.pattern.fill(match);
+    restrictPattern(run);
+
+    runs.insert({ 0, run });
+}
+
+
+void MatchRuns::assign(const char *matches, int num_frames) {
+    runs.clear();
+
+    addFrames(matches, 0, num_frames - 1);
+}
+
+
+void MatchRuns::update(const char *matches, int first, int last) {
+    splitAt(first);
+    splitAt(last + 1);
+
+    runs.erase(runs.lower_bound(first), runs.lower_bound(last + 1));
+
+    addFrames(matches, first, last);
+
+    joinAt(last + 1);
+    joinAt(first);
+}
+
+
+int MatchRuns::findNextMismatch(int first, int last, const std::string &pattern) const {
+    auto it = runs.upper_bound(first);
+    if (it != runs.cbegin())
+        it--;
+
+    for ( ; it != runs.cend() && it->first <= last; it++) {
+        const MatchRun &run = it->second;
+
+        bool same = true;
+        for (int i = 0; i < 5; i++)
+            if (run.pattern[i] && run.pattern[i] != pattern[i])
+                same = false;
+
+        if (same)
+            continue;
+
+        int start = std::max(run.first, first);
+        int end = std::min({ run.last, last, start + 4 });
+
+        for (int i = start; i <= end; i++)
+            if (run.pattern[i % 5] != pattern[i % 5])
+                return i;
+    }
+
+    return -1;
+}
+
+
+// Whole runs with only the match are skipped. In any other run
+// a frame with another match comes up within five frames.
+int MatchRuns::findSequenceStart(char match, int frame) const {
+    auto it = runs.upper_bound(frame);
+
+    while (it != runs.cbegin()) {
+        it--;
+
+        const MatchRun &run = it->second;
+
+        if (run.last < frame)
+            break;
+
+        if (!hasOnly(run, match)) {
+            for (int i = frame; i >= run.first; i--)
+                if (run.pattern[i % 5] != match)
+                    return i + 1;
+        }
+
+        frame = run.first - 1;
+    }
+
+    return frame + 1;
+}
+
+
+int MatchRuns::findSequenceEnd(char match, int frame) const {
+    auto it = runs.upper_bound(frame);
+    if (it != runs.cbegin())
+        it--;
+
+    for ( ; it != runs.cend(); it++) {
+        const MatchRun &run = it->second;
+
+        if (run.first > frame || run.last < frame)
+            break;
+
+        if (!hasOnly(run, match)) {
+            for (int i = frame; i <= run.last; i++)
+                if (run.pattern[i % 5] != match)
+                    return i - 1;
+        }
+
+        frame = run.last + 1;
+    }
+
+    return frame - 1;
+}
+
+
+std::vector<std::pair<int, int> > MatchRuns::findSequences(char match, int minimum, int first, int last) const {
+    std::vector<std::pair<int, int> > sequences;
+
+    int start = -1;
+
+    auto end_sequence = [&] (int end) {
+        if (start != -1 && end - start >= minimum)
+            sequences.push_back({ start, end - start });
+        start = -1;
+    };
+
+    auto it = runs.upper_bound(first);
+    if (it != runs.cbegin())
+        it--;
+
+    for ( ; it != runs.cend() && it->first <= last; it++) {
+        const MatchRun &run = it->second;
+
+        int run_first = std::max(run.first, first);
+        int run_last = std::min(run.last, last);
+
+        if (run_last < run_first)
+            continue;
+
+        if (hasOnly(run, match)) {
+            if (start == -1)
+                start = run_first;
+            continue;
+        }
+
+        // Every five frames there is at least one other match, so only the
+        // sequences that continue from the previous run or into the next one
+        // can be longer than four frames.
+        if (minimum > 4 && run_last - run_first + 1 >= 5) {
+            int i = run_first;
+            while (run.pattern[i % 5] == match)
+                i++;
+
+            if (start == -1 && i > run_first)
+                start = run_first;
+            end_sequence(i);
+
+            i = run_last;
+            while (run.pattern[i % 5] == match)
+                i--;
+
+            if (i < run_last)
+                start = i + 1;
+
+            continue;
+        }
+
+        for (int i = run_first; i <= run_last; i++) {
+            if (run.pattern[i % 5] == match) {
+                if (start == -1)
+                    start = i;
+            } else {
+                end_sequence(i);
+            }
+        }
+    }
+
+    if (runs.size())
+        end_sequence(std::min(runs.crbegin()->second.last, last) + 1);
+
+    return sequences;
+}
@@ -0,0 +1,80 @@
+/*
+
+Copyright (c) 2015, John Smith
+
+Permission to use, copy, modify, and/or distribute this software for
+any purpose with or without fee is hereby granted, provided that the
+above copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+SOFTWARE.
+
+*/
+
+
+#ifndef MATCHRUNS_H
+#define MATCHRUNS_H
+
+#include <array>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+// A stretch of frames whose matches repeat every five frames,
+// like a telecined scene matched with "cccnn".
+struct MatchRun {
+    int first;
+    int last;
+    std::array<char, 5> pattern; // Indexed by frame % 5. 0 where no frame of the run falls.
+};
+
+
+// The matches as runs, kept next to the flat vector, so that questions
+// about ranges of frames take time proportional to the number of runs.
+// The runs are not necessarily as long as they could be.
+class MatchRuns {
+    std::map<int, MatchRun> runs; // Key is MatchRun::first
+
+    static void restrictPattern(MatchRun &run);
+    static bool canJoin(const MatchRun &a, const MatchRun &b);
+    static bool hasOnly(const MatchRun &run, char match);
+
+    void splitAt(int frame);
+    void joinAt(int frame);
+    void addFrames(const char *matches, int first, int last);
+
+public:
+    typedef std::map<int, MatchRun>::const_iterator const_iterator;
+
+    const_iterator cbegin() const;
+    const_iterator cend() const;
+    size_t size() const;
+
+    void fill(char match, int num_frames);
+    void assign(const char *matches, int num_frames);
+
+    // Frames first to last of matches changed.
+    void update(const char *matches, int first, int last);
+
+    // The first frame between first and last whose match isn't pattern[frame % 5], or -1.
+    int findNextMismatch(int first, int last, const std::string &pattern) const;
+
+    // The first and last frames of the stretch of frames with the match that
+    // ends or starts at frame. frame + 1 or frame - 1 if frame has another match.
+    int findSequenceStart(char match, int frame) const;
+    int findSequenceEnd(char match, int frame) const;
+
+    // Start and length of every sequence of at least minimum frames with
+    // the same match, counting only the frames between first and last.
+    std::vector<std::pair<int, int> > findSequences(char match, int minimum, int first, int last) const;
+};
+
+#endif // MATCHRUNS_H
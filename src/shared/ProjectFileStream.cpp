@@ -0,0 +1,194 @@
+/*
+
+Copyright (c) 2015, John Smith
+
+Permission to use, copy, modify, and/or distribute this software for
+any purpose with or without fee is hereby granted, provided that the
+above copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+SOFTWARE.
+
+*/
+
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <string>
+
+#include "ProjectFileStream.h"
+#include "WobblyException.h"
+
+
+static const size_t chunk_size = 256 * 1024;
+
+// Gzip, so the files can still be looked at with zcat.
+static const int gzip_window_bits = 15 + 16;
+
+
+static std::string zlibError(const z_stream &zstream, int ret) {
+    if (zstream.msg)
+        return zstream.msg;
+    return "zlib error " + std::to_string(ret);
+}
+
+
+ProjectFileWriteStream::ProjectFileWriteStream(QFile &_file, bool _compress)
+    : file(_file)
+    , compress(_compress)
+    , buffer(chunk_size)
+{
+    if (compress) {
+        memset(&zstream, 0, sizeof(zstream));
+
+        int ret = deflateInit2(&zstream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, gzip_window_bits, 8, Z_DEFAULT_STRATEGY);
+        if (ret != Z_OK)
+            throw WobblyException("Couldn't start compressing project file '" + file.fileName().toStdString() + "': " + zlibError(zstream, ret));
+
+        compressed.resize(chunk_size);
+    }
+}
+
+
+ProjectFileWriteStream::~ProjectFileWriteStream() {
+    if (compress)
+        deflateEnd(&zstream);
+}
+
+
+void ProjectFileWriteStream::writeBuffer(bool last) {
+    if (!compress) {
+        if (buffer_used && file.write(buffer.data(), buffer_used) < 0)
+            throw WobblyException("Couldn't write the project to file '" + file.fileName().toStdString() + "'. Error message: " + file.errorString().toStdString());
+
+        buffer_used = 0;
+        return;
+    }
+
+    zstream.next_in = (Bytef *)buffer.data();
+    zstream.avail_in = (uInt)buffer_used;
+
+    int ret;
+
+    do {
+        zstream.next_out = (Bytef *)compressed.data();
+        zstream.avail_out = (uInt)compressed.size();
+
+        ret = deflate(&zstream, last ? Z_FINISH : Z_NO_FLUSH);
+        if (ret == Z_STREAM_ERROR)
+            throw WobblyException("Couldn't compress project file '" + file.fileName().toStdString() + "': " + zlibError(zstream, ret));
+
+        size_t produced = compressed.size() - zstream.avail_out;
+
+        if (produced && file.write(compressed.data(), produced) < 0)
+            throw WobblyException("Couldn't write the project to file '" + file.fileName().toStdString() + "'. Error message: " + file.errorString().toStdString());
+    } while (zstream.avail_out == 0 || (last && ret != Z_STREAM_END));
+
+    buffer_used = 0;
+}
+
+
+void ProjectFileWriteStream::finish() {
+    writeBuffer(true);
+}
+
+
+static bool isGzip(QFile &file) {
+    char magic[2];
+
+    if (file.peek(magic, 2) != 2)
+        return false;
+
+    return (unsigned char)magic[0] == 0x1f && (unsigned char)magic[1] == 0x8b;
+}
+
+
+QByteArray readProjectFile(QFile &file) {
+    if (!isGzip(file))
+        return file.readAll();
+
+    std::string path = file.fileName().toStdString();
+
+    // The last four bytes of a gzip file are the uncompressed size modulo 2^32.
+    // Only a hint, since the file could be anything.
+    qint64 size_hint = 0;
+
+    if (file.size() >= 18) {
+        unsigned char trailer[4];
+        if (file.seek(file.size() - 4) && file.read((char *)trailer, 4) == 4)
+            size_hint = trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) | ((qint64)trailer[3] << 24);
+
+        if (!file.seek(0))
+            throw WobblyException("Couldn't read project file '" + path + "'. Error message: " + file.errorString().toStdString());
+    }
+
+    const qint64 max_size = std::numeric_limits<int>::max() - 1;
+
+    // Deflate can't do better than about 1032:1, so a bigger hint is a lie,
+    // and the buffer grows as needed anyway.
+    const qint64 max_ratio = 1032;
+    size_hint = std::min(size_hint, file.size() * max_ratio);
+
+    QByteArray contents;
+    contents.resize((int)std::clamp<qint64>(size_hint, chunk_size, max_size));
+
+    qint64 contents_used = 0;
+
+    z_stream zstream;
+    memset(&zstream, 0, sizeof(zstream));
+
+    int ret = inflateInit2(&zstream, gzip_window_bits);
+    if (ret != Z_OK)
+        throw WobblyException("Couldn't start decompressing project file '" + path + "': " + zlibError(zstream, ret));
+
+    std::vector<char> chunk(chunk_size);
+
+    try {
+        ret = Z_OK;
+
+        while (ret != Z_STREAM_END) {
+            qint64 chunk_used = file.read(chunk.data(), chunk.size());
+            if (chunk_used < 0)
+                throw WobblyException("Couldn't read project file '" + path + "'. Error message: " + file.errorString().toStdString());
+            if (chunk_used == 0)
+                throw WobblyException("Project file '" + path + "' is truncated: the compressed data ends too soon.");
+
+            zstream.next_in = (Bytef *)chunk.data();
+            zstream.avail_in = (uInt)chunk_used;
+
+            while (zstream.avail_in && ret != Z_STREAM_END) {
+                if (contents_used == contents.size()) {
+                    if (contents.size() == max_size)
+                        throw WobblyException("Project file '" + path + "' is too big.");
+
+                    contents.resize((int)std::min(max_size, (qint64)contents.size() * 2));
+                }
+
+                zstream.next_out = (Bytef *)contents.data() + contents_used;
+                zstream.avail_out = (uInt)(contents.size() - contents_used);
+
+                ret = inflate(&zstream, Z_NO_FLUSH);
+                if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR)
+                    throw WobblyException("Couldn't decompress project file '" + path + "': " + zlibError(zstream, ret));
+
+                contents_used = contents.size() - zstream.avail_out;
+            }
+        }
+    } catch (WobblyException &) {
+        inflateEnd(&zstream);
+        throw;
+    }
+
+    inflateEnd(&zstream);
+
+    contents.resize((int)contents_used);
+
+    return contents;
+}
@@ -0,0 +1,76 @@
+/*
+
+Copyright (c) 2015, John Smith
+
+Permission to use, copy, modify, and/or distribute this software for
+any purpose with or without fee is hereby granted, provided that the
+above copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+SOFTWARE.
+
+*/
+
+
+#ifndef PROJECTFILESTREAM_H
+#define PROJECTFILESTREAM_H
+
+#include <vector>
+
+#include <QByteArray>
+#include <QFile>
+
+#include <zlib.h>
+
+
+// Where writeProject puts the JSON, one chunk at a time, so the whole
+// project never has to be in memory as text. With compress, the file
+// is written as gzip, which readProjectFile recognises by itself.
+class ProjectFileWriteStream {
+    QFile &file;
+    bool compress;
+
+    z_stream zstream;
+
+    std::vector<char> buffer;
+    size_t buffer_used = 0;
+
+    std::vector<char> compressed;
+
+    void writeBuffer(bool last);
+
+public:
+    typedef char Ch;
+
+    ProjectFileWriteStream(QFile &_file, bool _compress);
+    ~ProjectFileWriteStream();
+
+    ProjectFileWriteStream(const ProjectFileWriteStream &) = delete;
+    ProjectFileWriteStream &operator=(const ProjectFileWriteStream &) = delete;
+
+    void Put(char c) {
+        if (buffer_used == buffer.size())
+            writeBuffer(false);
+        buffer[buffer_used++] = c;
+    }
+
+    // The writers call this after every complete document, which is not
+    // necessarily the end of the file, so it does nothing.
+    void Flush() { }
+
+    // Writes whatever is left and ends the compressed stream.
+    void finish();
+};
+
+
+// The contents of a project file, decompressed if they were compressed.
+// The compressed file is read a chunk at a time.
+QByteArray readProjectFile(QFile &file);
+
+#endif // PROJECTFILESTREAM_H
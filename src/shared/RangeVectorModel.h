@@ -0,0 +1,104 @@
+/*
+
+Copyright (c) 2015, John Smith
+
+Permission to use, copy, modify, and/or distribute this software for
+any purpose with or without fee is hereby granted, provided that the
+above copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+SOFTWARE.
+
+*/
+
+
+#ifndef RANGEVECTORMODEL_H
+#define RANGEVECTORMODEL_H
+
+#include <algorithm>
+#include <vector>
+
+#include <QAbstractTableModel>
+
+
+// A table model over a vector of rows sorted by frame number, for lists
+// that are worked out from other data rather than edited directly.
+// Replacing some rows only reports the ones that are actually different,
+// so the views keep their selection and don't redraw everything.
+template <typename Row>
+class RangeVectorModel : public QAbstractTableModel {
+protected:
+    std::vector<Row> rows;
+
+public:
+    typedef typename std::vector<Row>::const_iterator const_iterator;
+
+    RangeVectorModel(QObject *parent = Q_NULLPTR)
+        : QAbstractTableModel(parent)
+    {
+
+    }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const {
+        if (parent.isValid())
+            return 0;
+
+        return (int)rows.size();
+    }
+
+    const std::vector<Row> &getRows() const {
+        return rows;
+    }
+
+    // Replaces count rows, starting at row first, with the rows from begin to end.
+    void replaceRows(int first, int count, const_iterator begin, const_iterator end) {
+        // Only the part in the middle that differs needs to be reported.
+        while (count && begin != end && rows[first] == *begin) {
+            first++;
+            count--;
+            begin++;
+        }
+
+        while (count && begin != end && rows[first + count - 1] == *(end - 1)) {
+            count--;
+            end--;
+        }
+
+        int new_count = (int)(end - begin);
+
+        if (!count && !new_count)
+            return;
+
+        int common = std::min(count, new_count);
+
+        std::copy(begin, begin + common, rows.begin() + first);
+
+        // A row may show where it ends, which is where the next row starts.
+        int changed_first = std::max(first - 1, 0);
+        int changed_last = first + common - 1;
+        if (changed_last >= changed_first)
+            emit dataChanged(index(changed_first, 0), index(changed_last, columnCount() - 1));
+
+        if (new_count > count) {
+            beginInsertRows(QModelIndex(), first + common, first + new_count - 1);
+            rows.insert(rows.begin() + first + common, begin + common, end);
+            endInsertRows();
+        } else if (count > new_count) {
+            beginRemoveRows(QModelIndex(), first + common, first + count - 1);
+            rows.erase(rows.begin() + first + common, rows.begin() + first + count);
+            endRemoveRows();
+        }
+    }
+
+    void setRows(const std::vector<Row> &new_rows) {
+        replaceRows(0, (int)rows.size(), new_rows.cbegin(), new_rows.cend());
+    }
+};
+
+#endif // RANGEVECTORMODEL_H
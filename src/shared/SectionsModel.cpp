@@ -20,8 +20,9 @@ SOFTWARE.
 
 #include "SectionsModel.h"
 
-SectionsModel::SectionsModel(QObject *parent)
+SectionsModel::SectionsModel(const std::vector<std::string> &_preset_names, QObject *parent)
     : QAbstractTableModel(parent)
+    , preset_names(_preset_names)
 {
 
 }
@@ -53,9 +54,9 @@ QVariant SectionsModel::data(const QModelIndex &index, int role) const {
             QString presets;
 
             if (section.presets.size()) {
-                presets = QString::fromStdString(section.presets[0]);
+                presets = QString::fromStdString(preset_names[section.presets[0]]);
                 for (size_t i = 1; i < section.presets.size(); i++)
-                    presets += "," + QString::fromStdString(section.presets[i]);
+                    presets += "," + QString::fromStdString(preset_names[section.presets[i]]);
             }
 
             return presets;
@@ -124,11 +125,10 @@ void SectionsModel::clear() {
 }
 
 
-void SectionsModel::setSectionPresetName(int section_start, size_t preset_index, const std::string &preset_name) {
+// Call after renaming a preset the section uses.
+void SectionsModel::updateSectionPresetNames(int section_start) {
     SectionMap::iterator it = find(section_start);
 
-    it->second.presets[preset_index] = preset_name;
-
     int row = (int)std::distance(begin(), it);
 
     QModelIndex cell = index(row, PresetsColumn);
@@ -136,10 +136,10 @@ void SectionsModel::setSectionPresetName(int section_start, size_t preset_index,
 }
 
 
-void SectionsModel::appendSectionPreset(int section_start, const std::string &preset_name) {
+void SectionsModel::appendSectionPreset(int section_start, PresetId preset_id) {
     SectionMap::iterator it = find(section_start);
 
-    it->second.presets.push_back(preset_name);
+    it->second.presets.push_back(preset_id);
 
     int row = (int)std::distance(begin(), it);
 
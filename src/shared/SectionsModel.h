@@ -29,6 +29,8 @@ SOFTWARE.
 class SectionsModel : public QAbstractTableModel, public SectionMap {
     Q_OBJECT
 
+    const std::vector<std::string> &preset_names; // Indexed by PresetId.
+
 public:
     enum Columns {
         StartColumn = 0,
@@ -36,7 +38,8 @@ public:
         ColumnCount
     };
 
-    SectionsModel(QObject *parent = Q_NULLPTR);
+    // The sections hold preset IDs. preset_names is how they are displayed.
+    SectionsModel(const std::vector<std::string> &_preset_names, QObject *parent = Q_NULLPTR);
 
     int rowCount(const QModelIndex &parent = QModelIndex()) const;
 
@@ -57,9 +60,9 @@ public:
 
     void clear();
 
-    void setSectionPresetName(int section_start, size_t preset_index, const std::string &preset_name);
+    void updateSectionPresetNames(int section_start);
 
-    void appendSectionPreset(int section_start, const std::string &preset_name);
+    void appendSectionPreset(int section_start, PresetId preset_id);
 
     void deleteSectionPreset(int section_start, size_t preset_index);
 
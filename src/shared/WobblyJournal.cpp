@@ -0,0 +1,615 @@
+/*
+
+Copyright (c) 2015, John Smith
+
+Permission to use, copy, modify, and/or distribute this software for
+any purpose with or without fee is hereby granted, provided that the
+above copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+SOFTWARE.
+
+*/
+
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <QDateTime>
+#include <QFileInfo>
+
+#include "WobblyException.h"
+#include "WobblyJournal.h"
+
+
+static const char journal_magic[8] = { 'W', 'O', 'B', 'J', 'R', 'N', 'L', '\0' };
+static const uint32_t journal_version = 2;
+
+
+struct JournalFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    int64_t project_size;       // The project file the edits were made on.
+    int64_t project_modified;   // Milliseconds since the epoch.
+};
+
+
+struct JournalRecordHeader {
+    uint32_t size;
+    uint32_t checksum;
+};
+
+
+enum JournalEditFlags {
+    JournalFullState = 1 // The edit doesn't depend on the previous state.
+};
+
+
+static uint32_t checksum(const std::string &data) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+
+template <typename T>
+static void put(std::string &data, T value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+
+    data.append((const char *)&value, sizeof(T));
+}
+
+
+static void putString(std::string &data, const std::string &string) {
+    put<uint32_t>(data, (uint32_t)string.size());
+    data += string;
+}
+
+
+struct JournalReader {
+    const std::string &data;
+    size_t position = 0;
+
+    JournalReader(const std::string &_data)
+        : data(_data)
+    { }
+
+    template <typename T>
+    T get() {
+        if (data.size() - position < sizeof(T))
+            throw WobblyException("Can't replay the journal: an edit is damaged.");
+
+        T value;
+        memcpy(&value, data.data() + position, sizeof(T));
+        position += sizeof(T);
+        return value;
+    }
+
+    std::string getString() {
+        uint32_t size = get<uint32_t>();
+
+        if (data.size() - position < size)
+            throw WobblyException("Can't replay the journal: an edit is damaged.");
+
+        std::string string = data.substr(position, size);
+        position += size;
+        return string;
+    }
+};
+
+
+static void putPresets(std::string &data, const PresetMap &presets) {
+    put<uint32_t>(data, (uint32_t)presets.size());
+    for (auto it = presets.cbegin(); it != presets.cend(); it++) {
+        put<int32_t>(data, it->second.id);
+        putString(data, it->second.name);
+        putString(data, it->second.contents);
+    }
+}
+
+
+static void getPresets(JournalReader &reader, PresetMap &presets) {
+    presets.clear();
+
+    uint32_t count = reader.get<uint32_t>();
+    for (uint32_t i = 0; i < count; i++) {
+        Preset preset;
+        preset.id = reader.get<int32_t>();
+        preset.name = reader.getString();
+        preset.contents = reader.getString();
+        presets.insert({ preset.name, preset });
+    }
+}
+
+
+static void putCustomLists(std::string &data, const CustomListVector &lists) {
+    put<uint32_t>(data, (uint32_t)lists.size());
+    for (size_t i = 0; i < lists.size(); i++) {
+        putString(data, lists[i].name);
+        putString(data, lists[i].preset);
+        put<int32_t>(data, lists[i].position);
+
+        put<uint32_t>(data, (uint32_t)lists[i].ranges->size());
+        for (auto it = lists[i].ranges->cbegin(); it != lists[i].ranges->cend(); it++) {
+            put<int32_t>(data, it->second.first);
+            put<int32_t>(data, it->second.last);
+        }
+    }
+}
+
+
+// The ranges models are new, so the undo steps that shared the old ones don't change.
+static void getCustomLists(JournalReader &reader, CustomListVector &lists) {
+    lists.clear();
+
+    uint32_t count = reader.get<uint32_t>();
+    for (uint32_t i = 0; i < count; i++) {
+        std::string name = reader.getString();
+        std::string preset = reader.getString();
+        int position = reader.get<int32_t>();
+
+        CustomList list(name, preset, position);
+
+        uint32_t ranges = reader.get<uint32_t>();
+        for (uint32_t j = 0; j < ranges; j++) {
+            FrameRange range;
+            range.first = reader.get<int32_t>();
+            range.last = reader.get<int32_t>();
+            list.ranges->insert({ range.first, range });
+        }
+
+        lists.push_back(list);
+    }
+}
+
+
+static void putPatternGuessing(std::string &data, const PatternGuessing &pg) {
+    put<int32_t>(data, pg.method);
+    put<int32_t>(data, pg.minimum_length);
+    put<int32_t>(data, pg.third_n_match);
+    put<int32_t>(data, pg.decimation);
+    put<int32_t>(data, pg.use_patterns);
+
+    put<uint32_t>(data, (uint32_t)pg.failures.size());
+    for (auto it = pg.failures.cbegin(); it != pg.failures.cend(); it++) {
+        put<int32_t>(data, it->second.start);
+        put<int32_t>(data, it->second.reason);
+    }
+}
+
+
+static void getPatternGuessing(JournalReader &reader, PatternGuessing &pg) {
+    pg.method = reader.get<int32_t>();
+    pg.minimum_length = reader.get<int32_t>();
+    pg.third_n_match = reader.get<int32_t>();
+    pg.decimation = reader.get<int32_t>();
+    pg.use_patterns = reader.get<int32_t>();
+
+    pg.failures.clear();
+
+    uint32_t count = reader.get<uint32_t>();
+    for (uint32_t i = 0; i < count; i++) {
+        FailedPatternGuessing failure;
+        failure.start = reader.get<int32_t>();
+        failure.reason = reader.get<int32_t>();
+        pg.failures.insert({ failure.start, failure });
+    }
+}
+
+
+// The small tables are written whole, and only if they changed.
+template <typename T, typename Put>
+static void putIfChanged(std::string &data, const T &before, const T &after, Put put_table) {
+    bool changed = !(before == after);
+
+    put<uint8_t>(data, changed);
+    if (changed)
+        put_table(data, after);
+}
+
+
+// The keys that are gone, followed by the entries that are new or different.
+template <typename Map, typename Equal, typename PutValue>
+static void putMapDiff(std::string &data, const Map &before, const Map &after, Equal equal, PutValue put_value) {
+    std::vector<int> removed;
+    for (auto it = before.cbegin(); it != before.cend(); it++)
+        if (!after.count(it->first))
+            removed.push_back(it->first);
+
+    std::vector<typename Map::const_iterator> changed;
+    for (auto it = after.cbegin(); it != after.cend(); it++) {
+        auto old = before.find(it->first);
+        if (old == before.cend() || !equal(old->second, it->second))
+            changed.push_back(it);
+    }
+
+    put<uint32_t>(data, (uint32_t)removed.size());
+    for (int key : removed)
+        put<int32_t>(data, key);
+
+    put<uint32_t>(data, (uint32_t)changed.size());
+    for (auto it : changed) {
+        put<int32_t>(data, it->first);
+        put_value(data, it->second);
+    }
+}
+
+
+template <typename Map, typename GetValue>
+static void getMapDiff(JournalReader &reader, Map &map, GetValue get_value) {
+    uint32_t removed = reader.get<uint32_t>();
+    for (uint32_t i = 0; i < removed; i++)
+        map.erase(reader.get<int32_t>());
+
+    uint32_t changed = reader.get<uint32_t>();
+    for (uint32_t i = 0; i < changed; i++) {
+        int key = reader.get<int32_t>();
+        map.insert_or_assign(key, get_value(reader, key));
+    }
+}
+
+
+static void putSetDiff(std::string &data, const std::set<int> &before, const std::set<int> &after) {
+    std::vector<int> removed;
+    for (int frame : before)
+        if (!after.count(frame))
+            removed.push_back(frame);
+
+    std::vector<int> added;
+    for (int frame : after)
+        if (!before.count(frame))
+            added.push_back(frame);
+
+    put<uint32_t>(data, (uint32_t)removed.size());
+    for (int frame : removed)
+        put<int32_t>(data, frame);
+
+    put<uint32_t>(data, (uint32_t)added.size());
+    for (int frame : added)
+        put<int32_t>(data, frame);
+}
+
+
+static void getSetDiff(JournalReader &reader, std::set<int> &set) {
+    uint32_t removed = reader.get<uint32_t>();
+    for (uint32_t i = 0; i < removed; i++)
+        set.erase(reader.get<int32_t>());
+
+    uint32_t added = reader.get<uint32_t>();
+    for (uint32_t i = 0; i < added; i++)
+        set.insert(reader.get<int32_t>());
+}
+
+
+static std::string encodeEdit(const std::string &description, const UndoStep *before, const UndoStep &after, const FrameRange &changed_frames) {
+    static const UndoStep empty_state = {};
+
+    const UndoStep &old_state = before ? *before : empty_state;
+
+    std::string data;
+
+    putString(data, description);
+    put<uint8_t>(data, before ? 0 : JournalFullState);
+
+    // Only the frames that may have changed are compared, unless everything is written.
+    size_t first_frame = 0;
+    size_t last_frame = std::max(after.matches.size(), after.decimated_frames.size() * 5);
+    if (before) {
+        if (changed_frames.first > changed_frames.last) {
+            last_frame = 0;
+        } else {
+            first_frame = std::min((size_t)changed_frames.first, last_frame);
+            last_frame = std::min((size_t)changed_frames.last + 1, last_frame);
+        }
+    }
+
+    std::vector<std::pair<int, char> > matches;
+    for (size_t i = first_frame; i < last_frame && i < after.matches.size(); i++)
+        if (i >= old_state.matches.size() || old_state.matches[i] != after.matches[i])
+            matches.push_back({ (int)i, after.matches[i] });
+
+    put<uint32_t>(data, (uint32_t)after.matches.size());
+    put<uint32_t>(data, (uint32_t)matches.size());
+    for (size_t i = 0; i < matches.size(); i++) {
+        put<int32_t>(data, matches[i].first);
+        put<char>(data, matches[i].second);
+    }
+
+    auto cycleMask = [] (const std::set<int8_t> &cycle) {
+        uint8_t mask = 0;
+        for (int8_t offset : cycle)
+            mask |= 1 << offset;
+        return mask;
+    };
+
+    std::vector<std::pair<int, uint8_t> > cycles;
+    for (size_t i = first_frame / 5; i * 5 < last_frame && i < after.decimated_frames.size(); i++)
+        if (i >= old_state.decimated_frames.size() || old_state.decimated_frames[i] != after.decimated_frames[i])
+            cycles.push_back({ (int)i, cycleMask(after.decimated_frames[i]) });
+
+    put<uint32_t>(data, (uint32_t)after.decimated_frames.size());
+    put<uint32_t>(data, (uint32_t)cycles.size());
+    for (size_t i = 0; i < cycles.size(); i++) {
+        put<int32_t>(data, cycles[i].first);
+        put<uint8_t>(data, cycles[i].second);
+    }
+
+    putIfChanged(data, old_state.pattern_guessing, after.pattern_guessing, putPatternGuessing);
+    putIfChanged(data, old_state.presets, after.presets, putPresets);
+    putIfChanged(data, old_state.custom_lists, after.custom_lists, putCustomLists);
+
+    putSetDiff(data, old_state.combed_frames, after.combed_frames);
+
+    putMapDiff(data, old_state.frozen_frames, after.frozen_frames, [] (const FreezeFrame &a, const FreezeFrame &b) {
+        return a == b;
+    }, [] (std::string &d, const FreezeFrame &ff) {
+        put<int32_t>(d, ff.first);
+        put<int32_t>(d, ff.last);
+        put<int32_t>(d, ff.replacement);
+    });
+
+    putMapDiff(data, old_state.sections, after.sections, [] (const Section &a, const Section &b) {
+        return a.presets == b.presets;
+    }, [] (std::string &d, const Section &section) {
+        put<uint32_t>(d, (uint32_t)section.presets.size());
+        for (size_t i = 0; i < section.presets.size(); i++)
+            put<int32_t>(d, section.presets[i]);
+    });
+
+    putMapDiff(data, old_state.bookmarks, after.bookmarks, [] (const Bookmark &a, const Bookmark &b) {
+        return a.description == b.description;
+    }, [] (std::string &d, const Bookmark &bookmark) {
+        putString(d, bookmark.description);
+    });
+
+    return data;
+}
+
+
+void WobblyJournal::applyEdit(const JournalEdit &edit, UndoStep &state) {
+    JournalReader reader(edit.data);
+
+    state.description = reader.getString();
+
+    uint8_t flags = reader.get<uint8_t>();
+    if (flags & JournalFullState)
+        state = { .description = state.description };
+
+    // Replayed steps can be undone, and the undo is journalled with this range.
+    state.changed_frames = { 0, -1 };
+    auto markChanged = [&state] (int first, int last) {
+        if (state.changed_frames.first > state.changed_frames.last) {
+            state.changed_frames = { first, last };
+        } else {
+            state.changed_frames.first = std::min(state.changed_frames.first, first);
+            state.changed_frames.last = std::max(state.changed_frames.last, last);
+        }
+    };
+
+    uint32_t num_frames = reader.get<uint32_t>();
+    state.matches.resize(num_frames, 'c');
+
+    uint32_t matches = reader.get<uint32_t>();
+    for (uint32_t i = 0; i < matches; i++) {
+        uint32_t frame = reader.get<int32_t>();
+        char match = reader.get<char>();
+
+        if (frame >= num_frames)
+            throw WobblyException("Can't replay the journal: an edit is damaged.");
+
+        state.matches[frame] = match;
+        markChanged(frame, frame);
+    }
+
+    uint32_t num_cycles = reader.get<uint32_t>();
+    state.decimated_frames.resize(num_cycles);
+
+    if (flags & JournalFullState)
+        markChanged(0, (int)std::max(num_frames, num_cycles * 5) - 1);
+
+    uint32_t cycles = reader.get<uint32_t>();
+    for (uint32_t i = 0; i < cycles; i++) {
+        uint32_t cycle = reader.get<int32_t>();
+        uint8_t mask = reader.get<uint8_t>();
+
+        if (cycle >= num_cycles)
+            throw WobblyException("Can't replay the journal: an edit is damaged.");
+
+        state.decimated_frames[cycle].clear();
+        for (int8_t offset = 0; offset < 5; offset++)
+            if (mask & (1 << offset))
+                state.decimated_frames[cycle].insert(offset);
+        markChanged(cycle * 5, cycle * 5 + 4);
+    }
+
+    if (reader.get<uint8_t>())
+        getPatternGuessing(reader, state.pattern_guessing);
+    if (reader.get<uint8_t>())
+        getPresets(reader, state.presets);
+    if (reader.get<uint8_t>())
+        getCustomLists(reader, state.custom_lists);
+
+    getSetDiff(reader, state.combed_frames);
+
+    getMapDiff(reader, state.frozen_frames, [] (JournalReader &r, int) {
+        FreezeFrame ff;
+        ff.first = r.get<int32_t>();
+        ff.last = r.get<int32_t>();
+        ff.replacement = r.get<int32_t>();
+        return ff;
+    });
+
+    getMapDiff(reader, state.sections, [] (JournalReader &r, int start) {
+        Section section(start);
+        uint32_t count = r.get<uint32_t>();
+        for (uint32_t i = 0; i < count; i++)
+            section.presets.push_back(r.get<int32_t>());
+        return section;
+    });
+
+    getMapDiff(reader, state.bookmarks, [] (JournalReader &r, int frame) {
+        Bookmark bookmark;
+        bookmark.frame = frame;
+        bookmark.description = r.getString();
+        return bookmark;
+    });
+}
+
+
+static void syncFile(QFile &file) {
+    file.flush();
+
+#ifdef _WIN32
+    _commit(file.handle());
+#else
+    fsync(file.handle());
+#endif
+}
+
+
+static bool getProjectFingerprint(const std::string &project_path, int64_t &size, int64_t &modified) {
+    QFileInfo info(QString::fromStdString(project_path));
+    if (!info.isFile())
+        return false;
+
+    size = info.size();
+    modified = info.lastModified().toMSecsSinceEpoch();
+    return true;
+}
+
+
+// valid_size is the size of the part of the file that can be used.
+static std::vector<JournalEdit> readJournal(const std::string &project_path, qint64 &valid_size) {
+    std::vector<JournalEdit> edits;
+
+    valid_size = 0;
+
+    QFile file(QString::fromStdString(WobblyJournal::getJournalPath(project_path)));
+    if (!file.open(QIODevice::ReadOnly))
+        return edits;
+
+    int64_t project_size, project_modified;
+    if (!getProjectFingerprint(project_path, project_size, project_modified))
+        return edits;
+
+    JournalFileHeader header;
+    if (file.read((char *)&header, sizeof(header)) != sizeof(header) ||
+        memcmp(header.magic, journal_magic, sizeof(journal_magic)) ||
+        header.version != journal_version ||
+        header.project_size != project_size ||
+        header.project_modified != project_modified)
+        return edits;
+
+    valid_size = file.pos();
+
+    while (true) {
+        JournalRecordHeader record;
+        if (file.read((char *)&record, sizeof(record)) != sizeof(record) ||
+            record.size > file.size() - file.pos())
+            break;
+
+        std::string data(record.size, '\0');
+        if (file.read(data.data(), record.size) != record.size ||
+            checksum(data) != record.checksum)
+            break;
+
+        JournalEdit edit;
+        edit.description = JournalReader(data).getString();
+        edit.data = std::move(data);
+        edits.push_back(std::move(edit));
+
+        valid_size = file.pos();
+    }
+
+    return edits;
+}
+
+
+WobblyJournal::WobblyJournal(const std::string &project_path, bool keep_edits)
+    : file(QString::fromStdString(getJournalPath(project_path)))
+{
+    std::string path = getJournalPath(project_path);
+
+    qint64 valid_size = 0;
+    if (keep_edits)
+        num_edits = (int)readJournal(project_path, valid_size).size();
+
+    if (num_edits) {
+        // Whatever a crash left after the last complete edit goes away.
+        if (!file.open(QIODevice::ReadWrite) || !file.resize(valid_size) || !file.seek(valid_size))
+            throw WobblyException("Can't open the journal '" + path + "': " + file.errorString().toStdString());
+
+        return;
+    }
+
+    JournalFileHeader header = {};
+    memcpy(header.magic, journal_magic, sizeof(journal_magic));
+    header.version = journal_version;
+
+    if (!getProjectFingerprint(project_path, header.project_size, header.project_modified))
+        throw WobblyException("Can't start the journal '" + path + "': the project file '" + project_path + "' doesn't exist.");
+
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) ||
+        file.write((const char *)&header, sizeof(header)) != sizeof(header))
+        throw WobblyException("Can't start the journal '" + path + "': " + file.errorString().toStdString());
+
+    syncFile(file);
+}
+
+
+void WobblyJournal::append(const std::string &description, const UndoStep *before, const UndoStep &after, const FrameRange &changed_frames) {
+    std::string data = encodeEdit(description, before, after, changed_frames);
+
+    JournalRecordHeader record;
+    record.size = (uint32_t)data.size();
+    record.checksum = checksum(data);
+
+    // One write, so that a crash leaves at most one damaged edit at the end.
+    data.insert(0, (const char *)&record, sizeof(record));
+
+    if (file.write(data.data(), data.size()) != (qint64)data.size())
+        throw WobblyException("Can't add the edit '" + description + "' to the journal '" + file.fileName().toStdString() + "': " + file.errorString().toStdString());
+
+    syncFile(file);
+
+    num_edits++;
+}
+
+
+int WobblyJournal::getNumEdits() const {
+    return num_edits;
+}
+
+
+std::string WobblyJournal::getJournalPath(const std::string &project_path) {
+    return project_path + ".journal";
+}
+
+
+std::vector<JournalEdit> WobblyJournal::readEdits(const std::string &project_path) {
+    qint64 valid_size;
+    return readJournal(project_path, valid_size);
+}
+
+
+void WobblyJournal::remove(const std::string &project_path) {
+    QFile::remove(QString::fromStdString(getJournalPath(project_path)));
+}
@@ -0,0 +1,70 @@
+/*
+
+Copyright (c) 2015, John Smith
+
+Permission to use, copy, modify, and/or distribute this software for
+any purpose with or without fee is hereby granted, provided that the
+above copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+SOFTWARE.
+
+*/
+
+
+#ifndef WOBBLYJOURNAL_H
+#define WOBBLYJOURNAL_H
+
+#include <string>
+#include <vector>
+
+#include <QFile>
+
+#include "WobblyProject.h"
+
+
+struct JournalEdit {
+    std::string description;
+    std::string data;
+};
+
+
+// An append-only file next to a project file, holding the edits made since
+// the project file was last written. Every edit only stores what changed,
+// so it costs about as much to write as the edit itself.
+class WobblyJournal {
+    QFile file;
+    int num_edits = 0;
+
+public:
+    // Starts a journal for the project file as it is on disk now.
+    // With keep_edits, the edits already in a journal made for the same
+    // project file are kept, and new ones are added after them.
+    WobblyJournal(const std::string &project_path, bool keep_edits);
+
+    // Records the edit that turned before into after. Only the frames in
+    // changed_frames are checked for different matches and decimation.
+    // If before is null, after is recorded in full.
+    void append(const std::string &description, const UndoStep *before, const UndoStep &after, const FrameRange &changed_frames);
+
+    int getNumEdits() const;
+
+    static std::string getJournalPath(const std::string &project_path);
+
+    // The edits in the journal of a project file. Nothing if there is no journal,
+    // or if it was made for an older or newer version of the project file.
+    // An edit cut short by a crash is left out.
+    static std::vector<JournalEdit> readEdits(const std::string &project_path);
+
+    static void applyEdit(const JournalEdit &edit, UndoStep &state);
+
+    static void remove(const std::string &project_path);
+};
+
+#endif // WOBBLYJOURNAL_H
@@ -19,6 +19,7 @@ SOFTWARE.
 */
 
 
+#include <algorithm>
 #include <cstdio>
 #include <cstdint>
 #include <cstdlib>
@@ -37,8 +38,10 @@ SOFTWARE.
 #include "rapidjson/prettywriter.h"
 #include "rapidjson/error/en.h"
 
+#include "ProjectFileStream.h"
 #include "RandomStuff.h"
 #include "WobblyException.h"
+#include "WobblyJournal.h"
 #include "WobblyProject.h"
 
 
@@ -110,6 +113,7 @@ namespace Keys {
     const char original_matches[] = "original" " " "matches";;
     const char combed_frames[] = "combed" " " "frames";;
     const char decimated_frames[] = "decimated" " " "frames";;
+    const char original_decimated_frames[] = "original" " " "decimated" " " "frames";;
     const char decimate_metrics[] = "decimate" " " "metrics";;
     const char sections[] = "sections";;
     namespace Sections {
@@ -157,6 +161,89 @@ namespace Keys {
 }
 
 
+// Passes on the SAX events of the wanted top level keys and drops the rest,
+// so the values of the unwanted keys are only tokenised, never built.
+template <typename Handler>
+struct TopLevelKeyFilter {
+    Handler &handler;
+    const std::unordered_set<std::string> &keys;
+
+    int depth = 0;                      // The root object is at depth 1.
+    bool skipping = false;              // Skipping the value of an unwanted top level key.
+    rj::SizeType root_members = 0;      // Members passed on to the root object.
+
+    TopLevelKeyFilter(Handler &_handler, const std::unordered_set<std::string> &_keys)
+        : handler(_handler)
+        , keys(_keys)
+    { }
+
+    template <typename Function>
+    bool scalar(Function forward) {
+        if (skipping) {
+            if (depth == 1)
+                skipping = false;
+            return true;
+        }
+        return forward();
+    }
+
+    bool Null() { return scalar([&] { return handler.Null(); }); }
+    bool Bool(bool b) { return scalar([&] { return handler.Bool(b); }); }
+    bool Int(int i) { return scalar([&] { return handler.Int(i); }); }
+    bool Uint(unsigned u) { return scalar([&] { return handler.Uint(u); }); }
+    bool Int64(int64_t i) { return scalar([&] { return handler.Int64(i); }); }
+    bool Uint64(uint64_t u) { return scalar([&] { return handler.Uint64(u); }); }
+    bool Double(double d) { return scalar([&] { return handler.Double(d); }); }
+    bool RawNumber(const char *str, rj::SizeType length, bool copy) { return scalar([&] { return handler.RawNumber(str, length, copy); }); }
+    bool String(const char *str, rj::SizeType length, bool copy) { return scalar([&] { return handler.String(str, length, copy); }); }
+
+    bool Key(const char *str, rj::SizeType length, bool copy) {
+        if (skipping)
+            return true;
+
+        if (depth == 1) {
+            if (!keys.count(std::string(str, length))) {
+                skipping = true;
+                return true;
+            }
+            root_members++;
+        }
+
+        return handler.Key(str, length, copy);
+    }
+
+    bool StartObject() {
+        depth++;
+        return skipping || handler.StartObject();
+    }
+
+    bool EndObject(rj::SizeType member_count) {
+        depth--;
+        if (skipping) {
+            if (depth == 1)
+                skipping = false;
+            return true;
+        }
+        return handler.EndObject(depth ? member_count : root_members);
+    }
+
+    bool StartArray() {
+        depth++;
+        return skipping || handler.StartArray();
+    }
+
+    bool EndArray(rj::SizeType element_count) {
+        depth--;
+        if (skipping) {
+            if (depth == 1)
+                skipping = false;
+            return true;
+        }
+        return handler.EndArray(element_count);
+    }
+};
+
+
 WobblyProject::WobblyProject(bool _is_wobbly)
     : is_wobbly(_is_wobbly)
     , pattern_guessing{ PatternGuessingFromMics, 10, UseThirdNMatchNever, DropFirstDuplicate, PatternCCCNN | PatternCCNNN | PatternCCCCC, FailedPatternGuessingMap() }
@@ -165,8 +252,11 @@ WobblyProject::WobblyProject(bool _is_wobbly)
     , frozen_frames(new FrozenFramesModel(this))
     , presets(new PresetsModel(this))
     , custom_lists(new CustomListsModel(this))
-    , sections(new SectionsModel(this))
+    , sections(new SectionsModel(preset_names, this))
     , bookmarks(new BookmarksModel(this))
+    , frame_rates(new FrameRatesModel(this))
+    , c_match_sequences(new CMatchSequencesModel(this))
+    , edited_frames(new EditedFramesModel(this))
 {
     connect(bookmarks, &BookmarksModel::dataChanged, [this] () {
         setModified(true);
@@ -189,6 +279,10 @@ WobblyProject::WobblyProject(bool _is_wobbly, const std::string &_input_file, co
     // XXX What happens when the video happens to be bottom field first?
     vfm_parameters_int.insert({ "order", 1 });
     decimated_frames.resize((_num_frames - 1) / 5 + 1);
+    edited_matches.resize(_num_frames);
+    edited_decimations.resize(_num_frames);
+    rebuildDecimationRanges();
+    matchesChanged(0, _num_frames - 1);
     addSection(0);
     resize.width = _width;
     resize.height = _height;
@@ -197,6 +291,15 @@ WobblyProject::WobblyProject(bool _is_wobbly, const std::string &_input_file, co
 }
 
 
+// Closing the project one way or another means the edits were either saved or thrown away.
+WobblyProject::~WobblyProject() {
+    if (journal) {
+        journal.reset();
+        WobblyJournal::remove(journal_project_path);
+    }
+}
+
+
 int WobblyProject::getNumFrames(PositionInFilterChain position) const {
     if (position == PostSource)
         return num_frames[0];
@@ -222,7 +325,7 @@ void WobblyProject::setNumFrames(PositionInFilterChain position, int frames) {
 }
 
 
-void WobblyProject::writeProject(const std::string &path, bool compact_project) {
+void WobblyProject::writeProject(const std::string &path, bool compact_project, bool compress_project) {
     QFile file(QString::fromStdString(path));
 
     if (!file.open(QIODevice::WriteOnly))
@@ -459,6 +562,15 @@ void WobblyProject::writeProject(const std::string &path, bool compact_project)
         json_project.AddMember(Keys::decimated_frames, json_decimated_frames, a);
     }
 
+    if (original_decimated_frames.size()) {
+        rj::Value json_original_decimated_frames(rj::kArrayType);
+
+        for (int frame = original_decimated_frames.findFirstSet(0); frame != -1; frame = original_decimated_frames.findFirstSet(frame + 1))
+            json_original_decimated_frames.PushBack(frame, a);
+
+        json_project.AddMember(Keys::original_decimated_frames, json_original_decimated_frames, a);
+    }
+
     if (decimate_metrics.size()) {
         rj::Value json_decimate_metrics(rj::kArrayType);
 
@@ -476,7 +588,7 @@ void WobblyProject::writeProject(const std::string &path, bool compact_project)
         json_section.AddMember(Keys::Sections::start, it->second.start, a);
         rj::Value json_presets(rj::kArrayType);
         for (size_t i = 0; i < it->second.presets.size(); i++)
-            json_presets.PushBack(rj::Value(it->second.presets[i], a), a);
+            json_presets.PushBack(rj::Value(preset_names[it->second.presets[i]], a), a);
         json_section.AddMember(Keys::Sections::presets, json_presets, a);
 
         json_sections.PushBack(json_section, a);
@@ -583,37 +695,67 @@ void WobblyProject::writeProject(const std::string &path, bool compact_project)
         }
     }
 
-    rj::StringBuffer buffer;
+    ProjectFileWriteStream stream(file, compress_project);
 
     if (compact_project) {
-        rj::Writer<rj::StringBuffer> writer(buffer);
+        rj::Writer<ProjectFileWriteStream> writer(stream);
         json_project.Accept(writer);
     } else {
-        rj::PrettyWriter<rj::StringBuffer> writer(buffer);
+        rj::PrettyWriter<ProjectFileWriteStream> writer(stream);
         json_project.Accept(writer);
     }
 
-    if (file.write(buffer.GetString(), buffer.GetSize()) < 0)
-        throw WobblyException("Couldn't write the project to file '" + path + "'. Error message: " + file.errorString().toStdString());
+    stream.finish();
 
     setModified(false);
 }
 
 
-void WobblyProject::readProject(const std::string &path) {
+void WobblyProject::readProject(const std::string &path, const ReadProjectCallbacks &callbacks, const std::unordered_set<std::string> *only_keys) {
+    const int steps = 8;
+    int step = 0;
+
+    auto progress = [&] () {
+        step++;
+        if (callbacks.progress && !callbacks.progress(step, steps))
+            throw WobblyException("Reading project file '" + path + "' was cancelled.");
+    };
+
     QFile file(QString::fromStdString(path));
 
     if (!file.open(QIODevice::ReadOnly))
         throw WobblyException("Couldn't open project file '" + path + "'. Error message: " + file.errorString().toStdString());
 
-    QByteArray file_contents = file.readAll();
+    QByteArray file_contents = readProjectFile(file);
+
+    file.close();
 
     rj::Document json_project;
 
-    rj::ParseResult result = json_project.ParseInsitu(file_contents.data());
+    rj::ParseResult result;
+
+    if (only_keys) {
+        std::unordered_set<std::string> keys = *only_keys;
+        keys.insert({ Keys::project_format_version, Keys::input_file, Keys::input_frame_rate, Keys::input_resolution, Keys::trim, Keys::source_filter });
+
+        auto generator = [&] (rj::Document &document) {
+            TopLevelKeyFilter<rj::Document> filter(document, keys);
+            rj::InsituStringStream stream(file_contents.data());
+            rj::Reader reader;
+            result = reader.Parse<rj::kParseInsituFlag>(stream, filter);
+            return !result.IsError();
+        };
+
+        json_project.Populate(generator);
+    } else {
+        result = json_project.ParseInsitu(file_contents.data());
+    }
+
     if (result.IsError())
         throw WobblyException("Failed to parse project file '" + path + "' at byte " + std::to_string(result.Offset()) + ": " + rj::GetParseError_En(result.Code()));
 
+    progress();
+
     if (!json_project.IsObject())
         throw WobblyException("File '" + path + "' is not a valid Wobbly project: JSON document root is not an object.");
 
@@ -701,6 +843,11 @@ void WobblyProject::readProject(const std::string &path) {
     CHECK_STRING;
     source_filter = it->value.GetString();
 
+    if (callbacks.header_read)
+        callbacks.header_read();
+
+    progress();
+
 
     it = json_project.FindMember(Keys::user_interface);
     if (it != json_project.MemberEnd()) {
@@ -925,6 +1072,9 @@ void WobblyProject::readProject(const std::string &path) {
     }
 
 
+    progress();
+
+
     it = json_project.FindMember(Keys::vfm_parameters);
     if (it != json_project.MemberEnd()) {
         CHECK_OBJECT;
@@ -1023,6 +1173,8 @@ void WobblyProject::readProject(const std::string &path) {
         }
     }
 
+    progress();
+
     it = json_project.FindMember(Keys::mmetrics);
     if (it != json_project.MemberEnd()) {
         const rj::Value &json_mmetrics = it->value;
@@ -1093,6 +1245,8 @@ void WobblyProject::readProject(const std::string &path) {
     }
 
 
+    progress();
+
     it = json_project.FindMember(Keys::matches);
     if (it != json_project.MemberEnd()) {
         const rj::Value &json_matches = it->value;
@@ -1140,14 +1294,23 @@ void WobblyProject::readProject(const std::string &path) {
         if (!json_combed_frames.IsArray() || json_combed_frames.Size() > (rj::SizeType)getNumFrames(PostSource))
             throw WobblyException(path + ": JSON key '" + Keys::combed_frames + "' must be an array with at most " + std::to_string(getNumFrames(PostSource)) + " elements.");
 
+        std::vector<int> frames;
+        frames.reserve(json_combed_frames.Size());
+
         for (rj::SizeType i = 0; i < json_combed_frames.Size(); i++) {
             if (!json_combed_frames[i].IsInt())
                 throw WobblyException(path + ": element number " + std::to_string(i) + " of JSON key '" + Keys::combed_frames + "' must be an integer.");
-            addCombedFrame(json_combed_frames[i].GetInt());
+            frames.push_back(json_combed_frames[i].GetInt());
         }
+
+        setCombedFrames(std::move(frames));
     }
 
     decimated_frames.resize((getNumFrames(PostSource) - 1) / 5 + 1);
+    edited_matches.resize(getNumFrames(PostSource));
+    edited_decimations.resize(getNumFrames(PostSource));
+    rebuildDecimationRanges();
+    matchesChanged(0, getNumFrames(PostSource) - 1);
     it = json_project.FindMember(Keys::decimated_frames);
     if (it != json_project.MemberEnd()) {
         const rj::Value &json_decimated_frames = it->value;
@@ -1162,6 +1325,20 @@ void WobblyProject::readProject(const std::string &path) {
         }
     }
 
+    it = json_project.FindMember(Keys::original_decimated_frames);
+    if (it != json_project.MemberEnd()) {
+        const rj::Value &json_original_decimated_frames = it->value;
+
+        if (!json_original_decimated_frames.IsArray() || json_original_decimated_frames.Size() > (rj::SizeType)getNumFrames(PostSource))
+            throw WobblyException(path + ": JSON key '" + Keys::original_decimated_frames + "' must be an array with at most " + std::to_string(getNumFrames(PostSource)) + " elements.");
+
+        for (rj::SizeType i = 0; i < json_original_decimated_frames.Size(); i++) {
+            if (!json_original_decimated_frames[i].IsInt())
+                throw WobblyException(path + ": element number " + std::to_string(i) + " of JSON key '" + Keys::original_decimated_frames + "' must be an integer.");
+            addOriginalDecimatedFrame(json_original_decimated_frames[i].GetInt());
+        }
+    }
+
     // getNumFrames(PostDecimate) is correct at this point.
 
     it = json_project.FindMember(Keys::decimate_metrics);
@@ -1180,6 +1357,8 @@ void WobblyProject::readProject(const std::string &path) {
     }
 
 
+    progress();
+
     it = json_project.FindMember(Keys::presets);
     if (it != json_project.MemberEnd()) {
         CHECK_ARRAY;
@@ -1255,7 +1434,9 @@ void WobblyProject::readProject(const std::string &path) {
                 for (rj::SizeType k = 0; k < json_presets.Size(); k++) {
                     if (!json_presets[k].IsString())
                         throw WobblyException(path + ": element number " + std::to_string(k) + " of JSON key '" + Keys::Sections::presets + "', part of element number " + std::to_string(i) + " of key '" + Keys::sections + "', must be a string.");
-                    section.presets[k] = json_presets[k].GetString();
+                    if (!presetExists(json_presets[k].GetString()))
+                        throw WobblyException(path + ": element number " + std::to_string(k) + " of JSON key '" + Keys::Sections::presets + "', part of element number " + std::to_string(i) + " of key '" + Keys::sections + "', must be the name of a preset.");
+                    section.presets[k] = getPresetId(json_presets[k].GetString());
                 }
             }
 
@@ -1343,6 +1524,8 @@ void WobblyProject::readProject(const std::string &path) {
     }
 
 
+    progress();
+
     it = json_project.FindMember(Keys::resize);
     if (it != json_project.MemberEnd()) {
         CHECK_OBJECT;
@@ -1474,6 +1657,8 @@ void WobblyProject::readProject(const std::string &path) {
     }
 
     setModified(false);
+
+    progress();
 }
 
 
@@ -1505,11 +1690,17 @@ void WobblyProject::addFreezeFrame(int first, int last, int replacement) {
     };
     frozen_frames->insert(std::make_pair(first, ff));
 
+    markCombedDirty(first, last);
+
     setModified(true);
 }
 
 
 void WobblyProject::deleteFreezeFrame(int frame) {
+    auto it = frozen_frames->find(frame);
+    if (it != frozen_frames->cend())
+        markCombedDirty(it->second.first, it->second.last);
+
     frozen_frames->erase(frame);
 
     setModified(true);
@@ -1561,10 +1752,13 @@ void WobblyProject::addPreset(const std::string &preset_name, const std::string
         throw WobblyException("Can't add preset '" + preset_name + "': preset name already in use.");
 
     Preset preset;
+    preset.id = (PresetId)preset_names.size();
     preset.name = preset_name;
     preset.contents = preset_contents;
     presets->insert(std::make_pair(preset_name, preset));
 
+    preset_names.push_back(preset_name);
+
     setModified(true);
 }
 
@@ -1582,21 +1776,27 @@ void WobblyProject::renamePreset(const std::string &old_name, const std::string
     if (presetExists(new_name))
         throw WobblyException("Can't rename preset '" + old_name + "' to '" + new_name + "': preset '" + new_name + "' already exists.");
 
-    Preset preset;
+    Preset preset = presets->at(old_name);
     preset.name = new_name;
-    preset.contents = getPresetContents(old_name);
 
     presets->erase(old_name);
     presets->insert(std::make_pair(new_name, preset));
 
-    for (auto it = sections->cbegin(); it != sections->cend(); it++)
-        for (size_t j = 0; j < it->second.presets.size(); j++)
-            if (it->second.presets[j] == old_name)
-                sections->setSectionPresetName(it->second.start, j, new_name);
+    // The sections only hold the ID, so they keep pointing at the preset.
+    preset_names[preset.id] = new_name;
 
-    for (size_t i = 0; i < custom_lists->size(); i++)
-        if (custom_lists->at(i).preset == old_name)
-            custom_lists->setCustomListPreset(i, new_name);
+    auto uses = preset_uses.find(preset.id);
+    if (uses != preset_uses.end()) {
+        for (int section_start : uses->second.sections)
+            sections->updateSectionPresetNames(section_start);
+
+        int lists_left = uses->second.custom_lists;
+        for (size_t i = 0; i < custom_lists->size() && lists_left; i++)
+            if (custom_lists->at(i).preset == old_name) {
+                custom_lists->setCustomListPreset(i, new_name);
+                lists_left--;
+            }
+    }
 
     setModified(true);
 }
@@ -1606,16 +1806,32 @@ void WobblyProject::deletePreset(const std::string &preset_name) {
     if (!presetExists(preset_name))
         throw WobblyException("Can't delete preset '" + preset_name + "': no such preset.");
 
+    PresetId preset_id = presets->at(preset_name).id;
+
+    markPresetCombedDirty(preset_name);
+
     presets->erase(preset_name);
 
-    for (auto it = sections->cbegin(); it != sections->cend(); it++)
-        for (size_t j = 0; j < it->second.presets.size(); j++)
-            if (it->second.presets[j] == preset_name)
-                sections->deleteSectionPreset(it->second.start, j);
+    preset_names[preset_id].clear();
 
-    for (size_t i = 0; i < custom_lists->size(); i++)
-        if (custom_lists->at(i).preset == preset_name)
-            custom_lists->setCustomListPreset(i, "");
+    auto uses = preset_uses.extract(preset_id);
+    if (uses) {
+        for (int section_start : uses.mapped().sections) {
+            const Section &section = sections->at(section_start);
+
+            // Backwards, so that deleting one doesn't skip the next.
+            for (size_t j = section.presets.size(); j > 0; j--)
+                if (section.presets[j - 1] == preset_id)
+                    sections->deleteSectionPreset(section_start, j - 1);
+        }
+
+        int lists_left = uses.mapped().custom_lists;
+        for (size_t i = 0; i < custom_lists->size() && lists_left; i++)
+            if (custom_lists->at(i).preset == preset_name) {
+                custom_lists->setCustomListPreset(i, "");
+                lists_left--;
+            }
+    }
 
     setModified(true);
 }
@@ -1638,6 +1854,8 @@ void WobblyProject::setPresetContents(const std::string &preset_name, const std:
     if (preset.contents != preset_contents) {
         preset.contents = preset_contents;
 
+        markPresetCombedDirty(preset_name);
+
         setModified(true);
     }
 }
@@ -1647,16 +1865,8 @@ bool WobblyProject::isPresetInUse(const std::string &preset_name) const {
     if (!presets->count(preset_name))
         throw WobblyException("Can't check if preset '" + preset_name + "' is in use: no such preset.");
 
-    for (auto it = sections->cbegin(); it != sections->cend(); it++)
-        for (size_t j = 0; j < it->second.presets.size(); j++)
-            if (it->second.presets[j] == preset_name)
-                return true;
-
-    for (auto it = custom_lists->cbegin(); it != custom_lists->cend(); it++)
-        if (it->preset == preset_name)
-            return true;
-
-    return false;
+    // Presets that aren't used by anything don't have an entry.
+    return (bool)preset_uses.count(presets->at(preset_name).id);
 }
 
 
@@ -1665,6 +1875,27 @@ bool WobblyProject::presetExists(const std::string &preset_name) const {
 }
 
 
+PresetId WobblyProject::getPresetId(const std::string &preset_name) const {
+    if (!presets->count(preset_name))
+        throw WobblyException("Can't retrieve the id of preset '" + preset_name + "': no such preset.");
+
+    return presets->at(preset_name).id;
+}
+
+
+const std::string &WobblyProject::getPresetName(PresetId preset_id) const {
+    if (!presetIdExists(preset_id))
+        throw WobblyException("Can't retrieve the name of preset number " + std::to_string(preset_id) + ": no such preset.");
+
+    return preset_names[preset_id];
+}
+
+
+bool WobblyProject::presetIdExists(PresetId preset_id) const {
+    return preset_id >= 0 && preset_id < (PresetId)preset_names.size() && preset_names[preset_id].size();
+}
+
+
 PresetsModel *WobblyProject::getPresetsModel() {
     return presets;
 }
@@ -1693,6 +1924,15 @@ void WobblyProject::setVFMParameter(const std::string &name, bool value) {
 }
 
 
+int WobblyProject::getVFMParameterInt(const std::string &name) const {
+    auto it = vfm_parameters_int.find(name);
+    if (it == vfm_parameters_int.cend())
+        throw WobblyException("Can't get VFM parameter '" + name + "': the project doesn't have it.");
+
+    return it->second;
+}
+
+
 void WobblyProject::setVDecimateParameter(const std::string &name, int value) {
     vdecimate_parameters_int[name] = value;
 }
@@ -1890,6 +2130,10 @@ void WobblyProject::setOriginalMatch(int frame, char match) {
         original_matches.resize(getNumFrames(PostSource), 'c');
 
     original_matches[frame] = match;
+
+    // Only used when there are no matches.
+    if (!matches.size())
+        matchesChanged(frame, frame);
 }
 
 
@@ -1925,10 +2169,22 @@ void WobblyProject::setMatch(int frame, char match) {
             match = 'p';
     }
 
-    if (!matches.size())
+    if (!matches.size()) {
         matches.resize(getNumFrames(PostSource), 'c');
 
-    matches[frame] = match;
+        if (original_matches.size())
+            matchesChanged(0, getNumFrames(PostSource) - 1);
+    }
+
+    if (matches[frame] != match) {
+        markCombedDirty(frame, frame);
+
+        matches[frame] = match;
+
+        matchesChanged(frame, frame);
+
+        emit framesChanged(frame, frame);
+    }
 }
 
 
@@ -2020,7 +2276,19 @@ void WobblyProject::addSection(const Section &section) {
     if (section.start < 0 || section.start >= getNumFrames(PostSource))
         throw WobblyException("Can't add section starting at " + std::to_string(section.start) + ": value out of range.");
 
-    sections->insert(std::make_pair(section.start, section));
+    for (size_t i = 0; i < section.presets.size(); i++)
+        if (!presetIdExists(section.presets[i]))
+            throw WobblyException("Can't add section starting at " + std::to_string(section.start) + ": preset number " + std::to_string(section.presets[i]) + " doesn't exist.");
+
+    auto result = sections->insert(std::make_pair(section.start, section));
+
+    if (result.second) {
+        addSectionPresetUses(section);
+
+        markSectionCombedDirty(section.start);
+
+        emit framesChanged(section.start, section.start);
+    }
 
     setModified(true);
 }
@@ -2034,9 +2302,16 @@ void WobblyProject::deleteSection(int section_start) {
         throw WobblyException("Can't delete section starting at " + std::to_string(section_start) + ": no such section.");
 
     // Never delete the very first section.
-    if (section_start > 0)
+    if (section_start > 0) {
+        markSectionCombedDirty(section_start);
+
+        removeSectionPresetUses(sections->at(section_start));
+
         sections->erase(section_start);
 
+        emit framesChanged(section_start, section_start);
+    }
+
     setModified(true);
 }
 
@@ -2086,8 +2361,14 @@ void WobblyProject::setSectionPreset(int section_start, const std::string &prese
     if (!presets->count(preset_name))
         throw WobblyException("Can't add preset '" + preset_name + "' to section starting at " + std::to_string(section_start) + ": no such preset.");
 
+    PresetId preset_id = presets->at(preset_name).id;
+
     // The user may want to assign the same preset twice.
-    sections->appendSectionPreset(section_start, preset_name);
+    sections->appendSectionPreset(section_start, preset_id);
+
+    updateSectionPresetUse(section_start, preset_id);
+
+    markSectionCombedDirty(section_start);
 
     setModified(true);
 }
@@ -2100,8 +2381,17 @@ void WobblyProject::deleteSectionPreset(int section_start, size_t preset_index)
     if (!sections->count(section_start))
         throw WobblyException("Can't delete preset number " + std::to_string(preset_index) + " from section starting at " + std::to_string(section_start) + ": no such section.");
 
+    if (preset_index >= sections->at(section_start).presets.size())
+        throw WobblyException("Can't delete preset number " + std::to_string(preset_index) + " from section starting at " + std::to_string(section_start) + ": preset index out of range.");
+
+    PresetId preset_id = sections->at(section_start).presets[preset_index];
+
     sections->deleteSectionPreset(section_start, preset_index);
 
+    updateSectionPresetUse(section_start, preset_id);
+
+    markSectionCombedDirty(section_start);
+
     setModified(true);
 }
 
@@ -2115,6 +2405,8 @@ void WobblyProject::moveSectionPresetUp(int section_start, size_t preset_index)
 
     sections->moveSectionPresetUp(section_start, preset_index);
 
+    markSectionCombedDirty(section_start);
+
     setModified(true);
 }
 
@@ -2128,6 +2420,8 @@ void WobblyProject::moveSectionPresetDown(int section_start, size_t preset_index
 
     sections->moveSectionPresetDown(section_start, preset_index);
 
+    markSectionCombedDirty(section_start);
+
     setModified(true);
 }
 
@@ -2174,23 +2468,48 @@ void WobblyProject::setRangeMatchesFromPattern(int range_start, int range_end, c
     if (range_start < 0 || range_end >= getNumFrames(PostSource))
         throw WobblyException("Can't apply match pattern to frames [" + std::to_string(range_start) + "," + std::to_string(range_end) + "]: frame numbers out of range.");
 
-    for (int i = range_start; i <= range_end; i++) {
+    if (!matches.size()) {
+        matches.resize(getNumFrames(PostSource), 'c');
+
+        if (original_matches.size())
+            matchesChanged(0, getNumFrames(PostSource) - 1);
+    }
+
+    auto applyPattern = [&] (int i) {
         if ((i == 0 && (pattern[i % 5] == 'p' || pattern[i % 5] == 'b')))
-            continue;
+            return;
 
         if (i == getNumFrames(PostSource) - 1 && (pattern[i % 5] == 'n' || pattern[i % 5] == 'u')) {
             if (pattern[i % 5] == 'n')
                 setMatch(i, 'b');
 
-            continue;
+            return;
         }
 
         if (i == range_end && pattern[i % 5] == 'n')
             setMatch(i, 'b');
         else
             setMatch(i, pattern[i % 5]);
+    };
+
+    // Only the first frame of the video and the last frame of the range
+    // can need something other than the pattern. Between them, the runs
+    // lead straight to the frames that don't follow it yet.
+    if (range_start == 0 && range_end > 0)
+        applyPattern(0);
+
+    int frame = std::max(range_start, 1);
+    while (frame < range_end) {
+        frame = match_runs.findNextMismatch(frame, range_end - 1, pattern);
+        if (frame == -1)
+            break;
+
+        applyPattern(frame);
+        frame++;
     }
 
+    applyPattern(range_end);
+
     setModified(true);
 }
 
@@ -2220,14 +2539,23 @@ void WobblyProject::resetRangeMatches(int start, int end) {
     if (start < 0 || end >= getNumFrames(PostSource))
         throw WobblyException("Can't reset the matches for frames [" + std::to_string(start) + "," + std::to_string(end) + "]: values out of range.");
 
-    if (!matches.size())
+    if (!matches.size()) {
         matches.resize(getNumFrames(PostSource), 'c');
 
+        if (original_matches.size())
+            matchesChanged(0, getNumFrames(PostSource) - 1);
+    }
+
     if (original_matches.size())
         memcpy(matches.data() + start, original_matches.data() + start, end - start + 1);
     else
         memset(matches.data() + start, 'c', end - start + 1);
 
+    markCombedDirty(start, end);
+    matchesChanged(start, end);
+
+    emit framesChanged(start, end);
+
     setModified(true);
 }
 
@@ -2269,6 +2597,10 @@ void WobblyProject::addCustomList(const CustomList &list) {
 
     custom_lists->push_back(list);
 
+    addCustomListPresetUse(list.preset);
+
+    markCustomListCombedDirty(custom_lists->size() - 1);
+
     setModified(true);
 }
 
@@ -2316,6 +2648,10 @@ void WobblyProject::deleteCustomList(int list_index) {
     if (list_index < 0 || list_index >= (int)custom_lists->size())
         throw WobblyException("Can't delete custom list with index " + std::to_string(list_index) + ": index out of range.");
 
+    markCustomListCombedDirty(list_index);
+
+    removeCustomListPresetUse(custom_lists->at(list_index).preset);
+
     custom_lists->erase(list_index);
 
     setModified(true);
@@ -2329,6 +2665,9 @@ void WobblyProject::moveCustomListUp(int list_index) {
     if (list_index == 0)
         return;
 
+    markCustomListCombedDirty(list_index);
+    markCustomListCombedDirty(list_index - 1);
+
     custom_lists->moveCustomListUp(list_index);
 
     setModified(true);
@@ -2342,6 +2681,9 @@ void WobblyProject::moveCustomListDown(int list_index) {
     if (list_index == (int)custom_lists->size() - 1)
         return;
 
+    markCustomListCombedDirty(list_index);
+    markCustomListCombedDirty(list_index + 1);
+
     custom_lists->moveCustomListDown(list_index);
 
     setModified(true);
@@ -2365,8 +2707,13 @@ void WobblyProject::setCustomListPreset(int list_index, const std::string &prese
     if (!presets->count(preset_name))
         throw WobblyException("Can't assign preset '" + preset_name + "' to custom list '" + cl.name + "': no such preset.");
 
+    removeCustomListPresetUse(cl.preset);
+    addCustomListPresetUse(preset_name);
+
     custom_lists->setCustomListPreset(list_index, preset_name);
 
+    markCustomListCombedDirty(list_index);
+
     setModified(true);
 }
 
@@ -2390,6 +2737,8 @@ void WobblyProject::setCustomListPosition(int list_index, PositionInFilterChain
 
     custom_lists->setCustomListPosition(list_index, position);
 
+    markCustomListCombedDirty(list_index);
+
     setModified(true);
 }
 
@@ -2423,6 +2772,9 @@ void WobblyProject::addCustomListRange(int list_index, int first, int last) {
 
     ranges->insert({ first, { first, last } });
 
+    if (cl.preset.size())
+        markCombedDirty(first, last);
+
     setModified(true);
 }
 
@@ -2438,6 +2790,9 @@ void WobblyProject::deleteCustomListRange(int list_index, int first) {
     if (!ranges->count(first))
         throw WobblyException("Can't delete range starting at frame " + std::to_string(first) + " from custom list '" + cl.name + "': no such range.");
 
+    if (cl.preset.size())
+        markCombedDirty(first, ranges->at(first).last);
+
     ranges->erase(first);
 
     setModified(true);
@@ -2526,6 +2881,13 @@ void WobblyProject::addDecimatedFrame(int frame) {
     if (result.second) {
         setNumFrames(PostDecimate, getNumFrames(PostDecimate) - 1);
 
+        frame_rates->setCycle(frame / 5, (int)decimated_frames[frame / 5].size());
+
+        markCombedDirty(frame, frame);
+        updateEditedDecimations(frame, frame);
+
+        emit framesChanged(frame, frame);
+
         setModified(true);
     }
 }
@@ -2540,6 +2902,13 @@ void WobblyProject::deleteDecimatedFrame(int frame) {
     if (result) {
         setNumFrames(PostDecimate, getNumFrames(PostDecimate) + 1);
 
+        frame_rates->setCycle(frame / 5, (int)decimated_frames[frame / 5].size());
+
+        markCombedDirty(frame, frame);
+        updateEditedDecimations(frame, frame);
+
+        emit framesChanged(frame, frame);
+
         setModified(true);
     }
 }
@@ -2561,13 +2930,51 @@ void WobblyProject::clearDecimatedFramesFromCycle(int frame) {
 
     size_t new_frames = decimated_frames[cycle].size();
 
+    for (auto it = decimated_frames[cycle].cbegin(); it != decimated_frames[cycle].cend(); it++)
+        markCombedDirty(cycle * 5 + *it, cycle * 5 + *it);
+
     decimated_frames[cycle].clear();
 
+    frame_rates->setCycle(cycle, 0);
+
+    updateEditedDecimations(cycle * 5, std::min(cycle * 5 + 4, getNumFrames(PostSource) - 1));
+
     setNumFrames(PostDecimate, getNumFrames(PostDecimate) + new_frames);
+
+    if (new_frames)
+        emit framesChanged(cycle * 5, std::min(cycle * 5 + 4, getNumFrames(PostSource) - 1));
+}
+
+
+void WobblyProject::addOriginalDecimatedFrame(int frame) {
+    if (frame < 0 || frame >= getNumFrames(PostSource))
+        throw WobblyException("Can't mark frame " + std::to_string(frame) + " as decimated by the decimator: value out of range.");
+
+    if (original_decimated_frames.size()) {
+        original_decimated_frames.set(frame, true);
+
+        updateEditedDecimations(frame, frame);
+    } else {
+        original_decimated_frames.resize(getNumFrames(PostSource));
+        original_decimated_frames.set(frame, true);
+
+        // Until now there was nothing to compare the decimation with.
+        updateEditedDecimations(0, getNumFrames(PostSource) - 1);
+    }
+}
+
+
+FrameRatesModel *WobblyProject::getFrameRatesModel() {
+    return frame_rates;
+}
+
+
+const DecimationRangeVector &WobblyProject::getDecimationRanges() const {
+    return frame_rates->getRows();
 }
 
 
-DecimationRangeVector WobblyProject::getDecimationRanges() const {
+void WobblyProject::rebuildDecimationRanges() {
     DecimationRangeVector ranges;
 
     DecimationRange current_range;
@@ -2581,7 +2988,8 @@ DecimationRangeVector WobblyProject::getDecimationRanges() const {
         }
     }
 
-    return ranges;
+    frame_rates->setNumFrames(getNumFrames(PostSource));
+    frame_rates->setRows(ranges);
 }
 
 
@@ -2618,103 +3026,490 @@ DecimationPatternRangeVector WobblyProject::getDecimationPatternRanges() const {
 std::map<size_t, size_t> WobblyProject::getCMatchSequences(int minimum) const {
     std::map<size_t, size_t> sequences;
 
-    size_t start = 0;
-    size_t length = 0;
-
-    auto cbegin = matches.cbegin();
-    auto cend = matches.cend();
-    if (!matches.size()) {
-        cbegin = original_matches.cbegin();
-        cend = original_matches.cend();
-    }
-
-    for (auto match = cbegin; match != cend; match++) {
-        if (*match == 'c') {
-            if (length == 0)
-                start = std::distance(cbegin, match);
-            length++;
-        } else {
-            if (length >= (size_t)minimum)
-                sequences.insert({ start, length });
-            length = 0;
-        }
-    }
-
-    if (!matches.size() && !original_matches.size())
-        length = getNumFrames(PostSource);
-
-    // The very last sequence.
-    if (length > 0)
-        sequences.insert({ start, length });
+    auto found = match_runs.findSequences('c', minimum, 0, getNumFrames(PostSource) - 1);
+    for (size_t i = 0; i < found.size(); i++)
+        sequences.insert({ found[i].first, found[i].second });
 
     return sequences;
 }
 
 
-void WobblyProject::updateOrphanFields() {
-    // Find the ends manually so this is not O(#sections^2)
-    auto it = sections->cbegin();
-    while (it != sections->cend()) {
-        int section_start = it->second.start;
-        it++;
-        int section_end = it == sections->cend() ? getNumFrames(PostSource) : it->second.start;
-
-        updateSectionOrphanFields(section_start, section_end);
-    }
+CMatchSequencesModel *WobblyProject::getCMatchSequencesModel() {
+    return c_match_sequences;
 }
 
-void WobblyProject::updateSectionOrphanFields(int section_start, int section_end) {
-    orphan_fields->erase(section_start);
-    orphan_fields->erase(section_end - 1);
 
-    if (getMatch(section_start) == 'n')
-        orphan_fields->insert({ section_start, { 'n', isDecimatedFrame(section_start) } });
+// The matches used for the frames changed. They are the original matches if there are no matches.
+void WobblyProject::matchesChanged(int first, int last) {
+    const std::vector<char> &hints = matches.size() ? matches : original_matches;
 
-    if (getMatch(section_end - 1) == 'b')
-        orphan_fields->insert({ section_end - 1, { 'b', isDecimatedFrame(section_end - 1) } });
+    if (hints.size())
+        match_runs.update(hints.data(), first, last);
+    else
+        match_runs.fill('c', getNumFrames(PostSource));
+
+    markCMatchesDirty(first, last);
+    updateEditedMatches(first, last);
+    markCommitDirty(first, last);
 }
 
 
-CombedFramesModel *WobblyProject::getCombedFramesModel() {
-    return combed_frames;
+void WobblyProject::updateEditedMatches(int first, int last) {
+    bool have_originals = matches.size() && original_matches.size();
+
+    for (int i = first; i <= last; i++)
+        edited_matches.set(i, have_originals && matches[i] != original_matches[i]);
+
+    markEditedFramesDirty(first, last);
 }
 
 
-void WobblyProject::addCombedFrame(int frame) {
-    if (frame < 0 || frame >= getNumFrames(PostSource))
-        throw WobblyException("Can't mark frame " + std::to_string(frame) + " as combed: value out of range.");
+void WobblyProject::updateEditedDecimations(int first, int last) {
+    bool have_originals = original_decimated_frames.size();
 
-    combed_frames->insert(frame);
+    for (int i = first; i <= last; i++)
+        edited_decimations.set(i, have_originals && (bool)decimated_frames[i / 5].count(i % 5) != original_decimated_frames.test(i));
 
-    setModified(true);
+    markEditedFramesDirty(first, last);
+    markCommitDirty(first, last);
 }
 
 
-void WobblyProject::deleteCombedFrame(int frame) {
-    if (frame < 0 || frame >= getNumFrames(PostSource))
-        throw WobblyException("Can't mark frame " + std::to_string(frame) + " as not combed: value out of range.");
-
-    combed_frames->erase(frame);
+void WobblyProject::markEditedFramesDirty(int first, int last) {
+    if (first > last)
+        return;
 
-    setModified(true);
+    if (edited_dirty.first > edited_dirty.last) {
+        edited_dirty = { first, last };
+    } else {
+        edited_dirty.first = std::min(edited_dirty.first, first);
+        edited_dirty.last = std::max(edited_dirty.last, last);
+    }
 }
 
 
-bool WobblyProject::isCombedFrame(int frame) const {
-    if (frame < 0 || frame >= getNumFrames(PostSource))
-        throw WobblyException("Can't check if frame " + std::to_string(frame) + " is combed: value out of range.");
+// The journal only compares these frames when recording the commit.
+void WobblyProject::markCommitDirty(int first, int last) {
+    if (first > last)
+        return;
 
-    return (bool)combed_frames->count(frame);
+    if (commit_dirty.first > commit_dirty.last) {
+        commit_dirty = { first, last };
+    } else {
+        commit_dirty.first = std::min(commit_dirty.first, first);
+        commit_dirty.last = std::max(commit_dirty.last, last);
+    }
 }
 
 
-void WobblyProject::clearCombedFrames() {
-    combed_frames->clear();
+int WobblyProject::findFirstEditedFrame(int frame) const {
+    int match = edited_matches.findFirstSet(frame);
+    int decimation = edited_decimations.findFirstSet(frame);
+
+    if (match == -1)
+        return decimation;
+    if (decimation == -1)
+        return match;
+
+    return std::min(match, decimation);
 }
 
 
-OrphanFieldsModel *WobblyProject::getOrphanFieldsModel() {
-    return orphan_fields;
+int WobblyProject::findLastEditedFrame(int frame) const {
+    return std::max(edited_matches.findLastSet(frame), edited_decimations.findLastSet(frame));
+}
+
+
+int WobblyProject::findFirstUneditedFrame(int frame) const {
+    while (true) {
+        int match = edited_matches.findFirstClear(frame);
+        int decimation = edited_decimations.findFirstClear(frame);
+
+        if (match == decimation)
+            return match;
+
+        frame = std::max(match, decimation);
+    }
+}
+
+
+int WobblyProject::findLastUneditedFrame(int frame) const {
+    while (true) {
+        int match = edited_matches.findLastClear(frame);
+        int decimation = edited_decimations.findLastClear(frame);
+
+        if (match == decimation)
+            return match;
+
+        frame = std::min(match, decimation);
+    }
+}
+
+
+void WobblyProject::markCMatchesDirty(int first, int last) {
+    if (c_match_dirty.last < c_match_dirty.first) {
+        c_match_dirty = { first, last };
+    } else {
+        c_match_dirty.first = std::min(c_match_dirty.first, first);
+        c_match_dirty.last = std::max(c_match_dirty.last, last);
+    }
+}
+
+
+void WobblyProject::updateCMatchSequences() {
+    int num = getNumFrames(PostSource);
+
+    int first = std::max(c_match_dirty.first, 0);
+    int last = std::min(c_match_dirty.last, num - 1);
+
+    c_match_dirty = { 0, -1 };
+
+    if (last < first)
+        return;
+
+    // The sequences around the changed frames can start or end outside them.
+    first = match_runs.findSequenceStart('c', first - 1);
+    last = match_runs.findSequenceEnd('c', last + 1);
+
+    auto sequences = match_runs.findSequences('c', c_match_sequences_minimum, first, last);
+
+    std::vector<FrameRange> found;
+    found.reserve(sequences.size());
+    for (size_t i = 0; i < sequences.size(); i++)
+        found.push_back({ sequences[i].first, sequences[i].first + sequences[i].second - 1 });
+
+    c_match_sequences->replaceSequences(first, last, found);
+}
+
+
+EditedFramesModel *WobblyProject::getEditedFramesModel() {
+    return edited_frames;
+}
+
+
+void WobblyProject::updateEditedFrames() {
+    int num = getNumFrames(PostSource);
+
+    int first = std::max(edited_dirty.first, 0);
+    int last = std::min(edited_dirty.last, num - 1);
+
+    edited_dirty = { 0, -1 };
+
+    if (last < first)
+        return;
+
+    // The ranges around the changed frames can start or end outside them.
+    first = findLastUneditedFrame(first - 1) + 1;
+    last = findFirstUneditedFrame(last + 1) - 1;
+
+    std::vector<EditedRange> found;
+
+    for (int start = findFirstEditedFrame(first); start != -1 && start <= last; start = findFirstEditedFrame(start)) {
+        int end = findFirstUneditedFrame(start) - 1;
+
+        found.push_back({ start, end, edited_matches.count(start, end), edited_decimations.count(start, end) });
+
+        start = end + 1;
+    }
+
+    edited_frames->replaceRanges(first, last, found);
+}
+
+
+void WobblyProject::updateOrphanFields() {
+    // Find the ends manually so this is not O(#sections^2)
+    auto it = sections->cbegin();
+    while (it != sections->cend()) {
+        int section_start = it->second.start;
+        it++;
+        int section_end = it == sections->cend() ? getNumFrames(PostSource) : it->second.start;
+
+        updateSectionOrphanFields(section_start, section_end);
+    }
+}
+
+void WobblyProject::updateSectionOrphanFields(int section_start, int section_end) {
+    orphan_fields->erase(section_start);
+    orphan_fields->erase(section_end - 1);
+
+    if (getMatch(section_start) == 'n')
+        orphan_fields->insert({ section_start, { 'n', isDecimatedFrame(section_start) } });
+
+    if (getMatch(section_end - 1) == 'b')
+        orphan_fields->insert({ section_end - 1, { 'b', isDecimatedFrame(section_end - 1) } });
+
+    emit framesChanged(section_start, section_start);
+    emit framesChanged(section_end - 1, section_end - 1);
+}
+
+
+CombedFramesModel *WobblyProject::getCombedFramesModel() {
+    return combed_frames;
+}
+
+
+void WobblyProject::addCombedFrame(int frame) {
+    if (frame < 0 || frame >= getNumFrames(PostSource))
+        throw WobblyException("Can't mark frame " + std::to_string(frame) + " as combed: value out of range.");
+
+    combed_frames->insert(frame);
+
+    emit framesChanged(frame, frame);
+
+    setModified(true);
+}
+
+
+void WobblyProject::deleteCombedFrame(int frame) {
+    if (frame < 0 || frame >= getNumFrames(PostSource))
+        throw WobblyException("Can't mark frame " + std::to_string(frame) + " as not combed: value out of range.");
+
+    combed_frames->erase(frame);
+
+    emit framesChanged(frame, frame);
+
+    setModified(true);
+}
+
+
+bool WobblyProject::isCombedFrame(int frame) const {
+    if (frame < 0 || frame >= getNumFrames(PostSource))
+        throw WobblyException("Can't check if frame " + std::to_string(frame) + " is combed: value out of range.");
+
+    return (bool)combed_frames->count(frame);
+}
+
+
+void WobblyProject::clearCombedFrames() {
+    combed_frames->clear();
+
+    emit framesChanged(0, getNumFrames(PostSource) - 1);
+}
+
+
+void WobblyProject::setCombedFrames(std::vector<int> frames) {
+    std::sort(frames.begin(), frames.end());
+    frames.erase(std::unique(frames.begin(), frames.end()), frames.end());
+
+    if (frames.size() && (frames.front() < 0 || frames.back() >= getNumFrames(PostSource)))
+        throw WobblyException("Can't mark frame " + std::to_string(frames.front() < 0 ? frames.front() : frames.back()) + " as combed: value out of range.");
+
+    combed_frames->assign(frames);
+
+    emit framesChanged(0, getNumFrames(PostSource) - 1);
+
+    setModified(true);
+}
+
+
+void WobblyProject::markCombedDirty(int first, int last) {
+    if (combed_dirty_all)
+        return;
+
+    if (first > last)
+        std::swap(first, last);
+
+    // Merge with any overlapping or adjacent ranges.
+    auto it = combed_dirty_ranges.upper_bound(first);
+
+    if (it != combed_dirty_ranges.begin()) {
+        auto prev = std::prev(it);
+        if (prev->second >= first - 1) {
+            first = prev->first;
+            last = std::max(last, prev->second);
+            it = combed_dirty_ranges.erase(prev);
+        }
+    }
+
+    while (it != combed_dirty_ranges.end() && it->first <= last + 1) {
+        last = std::max(last, it->second);
+        it = combed_dirty_ranges.erase(it);
+    }
+
+    combed_dirty_ranges.insert({ first, last });
+}
+
+
+void WobblyProject::markCombedDirtyAll() {
+    combed_dirty_all = true;
+    combed_dirty_ranges.clear();
+}
+
+
+void WobblyProject::markSectionCombedDirty(int section_start) {
+    markCombedDirty(section_start, getSectionEnd(section_start) - 1);
+}
+
+
+void WobblyProject::markPresetCombedDirty(const std::string &preset_name) {
+    auto uses = preset_uses.find(presets->at(preset_name).id);
+    if (uses == preset_uses.end())
+        return;
+
+    for (int section_start : uses->second.sections)
+        markSectionCombedDirty(section_start);
+
+    int lists_left = uses->second.custom_lists;
+    for (size_t i = 0; i < custom_lists->size() && lists_left; i++)
+        if (custom_lists->at(i).preset == preset_name) {
+            markCustomListCombedDirty(i);
+            lists_left--;
+        }
+}
+
+
+// Call after adding or removing one instance of the preset in the section.
+void WobblyProject::updateSectionPresetUse(int section_start, PresetId preset_id) {
+    const std::vector<PresetId> &section_presets = sections->at(section_start).presets;
+
+    if (std::find(section_presets.cbegin(), section_presets.cend(), preset_id) != section_presets.cend()) {
+        preset_uses[preset_id].sections.insert(section_start);
+    } else {
+        auto uses = preset_uses.find(preset_id);
+        if (uses == preset_uses.end())
+            return;
+
+        uses->second.sections.erase(section_start);
+        if (uses->second.sections.empty() && !uses->second.custom_lists)
+            preset_uses.erase(uses);
+    }
+}
+
+
+void WobblyProject::addSectionPresetUses(const Section &section) {
+    for (size_t i = 0; i < section.presets.size(); i++)
+        preset_uses[section.presets[i]].sections.insert(section.start);
+}
+
+
+void WobblyProject::removeSectionPresetUses(const Section &section) {
+    for (size_t i = 0; i < section.presets.size(); i++) {
+        auto uses = preset_uses.find(section.presets[i]);
+        if (uses == preset_uses.end())
+            continue;
+
+        uses->second.sections.erase(section.start);
+        if (uses->second.sections.empty() && !uses->second.custom_lists)
+            preset_uses.erase(uses);
+    }
+}
+
+
+// Custom lists still refer to their preset by name.
+void WobblyProject::addCustomListPresetUse(const std::string &preset_name) {
+    auto preset = presets->find(preset_name);
+    if (preset != presets->cend())
+        preset_uses[preset->second.id].custom_lists++;
+}
+
+
+void WobblyProject::removeCustomListPresetUse(const std::string &preset_name) {
+    auto preset = presets->find(preset_name);
+    if (preset == presets->cend())
+        return;
+
+    auto uses = preset_uses.find(preset->second.id);
+    if (uses == preset_uses.end())
+        return;
+
+    uses->second.custom_lists--;
+    if (uses->second.sections.empty() && !uses->second.custom_lists)
+        preset_uses.erase(uses);
+}
+
+
+void WobblyProject::rebuildPresetUses() {
+    preset_uses.clear();
+
+    for (auto it = sections->cbegin(); it != sections->cend(); it++)
+        addSectionPresetUses(it->second);
+
+    for (size_t i = 0; i < custom_lists->size(); i++)
+        addCustomListPresetUse(custom_lists->at(i).preset);
+}
+
+
+void WobblyProject::markCustomListCombedDirty(int list_index) {
+    const auto &ranges = custom_lists->at(list_index).ranges;
+
+    for (auto it = ranges->cbegin(); it != ranges->cend(); it++)
+        markCombedDirty(it->second.first, it->second.last);
+}
+
+
+std::vector<FrameRange> WobblyProject::getCombedDirtyRanges() const {
+    if (combed_dirty_all)
+        return { { 0, getNumFrames(PostSource) - 1 } };
+
+    std::vector<FrameRange> ranges;
+    ranges.reserve(combed_dirty_ranges.size());
+
+    for (auto it = combed_dirty_ranges.cbegin(); it != combed_dirty_ranges.cend(); it++)
+        ranges.push_back({ it->first, it->second });
+
+    return ranges;
+}
+
+
+// Returns the numbers after decimation of the frames in the ranges that aren't decimated.
+// The ranges must be sorted and must not overlap.
+std::vector<int> WobblyProject::getFramesAfterDecimation(const std::vector<FrameRange> &ranges) const {
+    std::vector<int> frames;
+
+    int cycle = 0;
+    int cycle_start = 0; // Frame number after decimation of the first frame in the cycle.
+
+    for (size_t i = 0; i < ranges.size(); i++) {
+        for (int frame = ranges[i].first; frame <= ranges[i].last; frame++) {
+            for (; cycle < frame / 5; cycle++)
+                cycle_start += 5 - (int)decimated_frames[cycle].size();
+
+            const std::set<int8_t> &dropped = decimated_frames[cycle];
+
+            if (dropped.count(frame % 5))
+                continue;
+
+            int out_frame = cycle_start;
+            for (int8_t j = 0; j < frame % 5; j++)
+                if (!dropped.count(j))
+                    out_frame++;
+
+            frames.push_back(out_frame);
+        }
+    }
+
+    return frames;
+}
+
+
+// Replaces the combed frames inside checked_ranges with frames. Both must be sorted.
+void WobblyProject::updateCombedFrames(const std::vector<FrameRange> &checked_ranges, const std::vector<int> &frames) {
+    std::vector<int> new_frames;
+    new_frames.reserve(combed_frames->size() + frames.size());
+
+    size_t range = 0;
+
+    for (auto it = combed_frames->cbegin(); it != combed_frames->cend(); it++) {
+        while (range < checked_ranges.size() && checked_ranges[range].last < *it)
+            range++;
+
+        if (range < checked_ranges.size() && checked_ranges[range].first <= *it)
+            continue;
+
+        new_frames.push_back(*it);
+    }
+
+    new_frames.insert(new_frames.end(), frames.cbegin(), frames.cend());
+
+    setCombedFrames(std::move(new_frames));
+
+    combed_dirty_all = false;
+    combed_dirty_ranges.clear();
+}
+
+
+OrphanFieldsModel *WobblyProject::getOrphanFieldsModel() {
+    return orphan_fields;
 }
 
 
@@ -2728,6 +3523,8 @@ bool WobblyProject::isOrphanField(int frame) const {
 
 void WobblyProject::clearOrphanFields() {
     orphan_fields->clear();
+
+    emit framesChanged(0, getNumFrames(PostSource) - 1);
 }
 
 
@@ -2744,6 +3541,8 @@ void WobblyProject::setResize(int new_width, int new_height, const std::string &
     resize.height = new_height;
     resize.filter = filter;
 
+    markCombedDirtyAll();
+
     setModified(true);
 }
 
@@ -2751,6 +3550,8 @@ void WobblyProject::setResize(int new_width, int new_height, const std::string &
 void WobblyProject::setResizeEnabled(bool enabled) {
     resize.enabled = enabled;
 
+    markCombedDirtyAll();
+
     setModified(true);
 }
 
@@ -2774,6 +3575,8 @@ void WobblyProject::setCrop(int left, int top, int right, int bottom) {
     crop.right = right;
     crop.bottom = bottom;
 
+    markCombedDirtyAll();
+
     setModified(true);
 }
 
@@ -2781,6 +3584,8 @@ void WobblyProject::setCrop(int left, int top, int right, int bottom) {
 void WobblyProject::setCropEnabled(bool enabled) {
     crop.enabled = enabled;
 
+    markCombedDirtyAll();
+
     setModified(true);
 }
 
@@ -2793,6 +3598,8 @@ bool WobblyProject::isCropEnabled() const {
 void WobblyProject::setCropEarly(bool early) {
     crop.early = early;
 
+    markCombedDirtyAll();
+
     setModified(true);
 }
 
@@ -2812,6 +3619,8 @@ void WobblyProject::setBitDepth(int bits, bool float_samples, const std::string
     depth.float_samples = float_samples;
     depth.dither = dither;
 
+    markCombedDirtyAll();
+
     setModified(true);
 }
 
@@ -2819,6 +3628,8 @@ void WobblyProject::setBitDepth(int bits, bool float_samples, const std::string
 void WobblyProject::setBitDepthEnabled(bool enabled) {
     depth.enabled = enabled;
 
+    markCombedDirtyAll();
+
     setModified(true);
 }
 
@@ -2875,14 +3686,109 @@ std::string WobblyProject::getRedoDescription() {
 }
 
 void WobblyProject::restoreState(UndoStep state) {
+    // Work out which frames the combed frames detection has to look at again.
+    if (!combed_dirty_all) {
+        bool same_custom_lists = state.custom_lists.size() == custom_lists->size();
+        for (size_t i = 0; same_custom_lists && i < state.custom_lists.size(); i++) {
+            const CustomList &a = state.custom_lists[i];
+            const CustomList &b = custom_lists->at(i);
+
+            same_custom_lists = a.preset == b.preset && a.position == b.position && a.ranges->size() == b.ranges->size() &&
+                                std::equal(a.ranges->cbegin(), a.ranges->cend(), b.ranges->cbegin(), [] (const auto &x, const auto &y) {
+                                    return x.second.first == y.second.first && x.second.last == y.second.last;
+                                });
+        }
+
+        if (state.combed_frames != static_cast<const std::set<int> &>(*combed_frames) ||
+            state.presets != static_cast<const PresetMap &>(*presets) ||
+            !same_custom_lists) {
+            markCombedDirtyAll();
+        } else {
+            for (size_t i = 0; i < state.matches.size() || i < matches.size(); i++) {
+                char a = i < state.matches.size() ? state.matches[i] : 'c';
+                char b = i < matches.size() ? matches[i] : 'c';
+                if (a != b)
+                    markCombedDirty((int)i, (int)i);
+            }
+
+            for (size_t i = 0; i < state.decimated_frames.size() && i < decimated_frames.size(); i++) {
+                if (state.decimated_frames[i] == decimated_frames[i])
+                    continue;
+
+                for (int8_t j = 0; j < 5; j++)
+                    if (state.decimated_frames[i].count(j) != decimated_frames[i].count(j))
+                        markCombedDirty((int)i * 5 + j, (int)i * 5 + j);
+            }
+
+            for (auto it = state.frozen_frames.cbegin(); it != state.frozen_frames.cend(); it++) {
+                auto other = frozen_frames->find(it->first);
+                if (other == frozen_frames->cend() || !(other->second == it->second))
+                    markCombedDirty(it->second.first, it->second.last);
+            }
+            for (auto it = frozen_frames->cbegin(); it != frozen_frames->cend(); it++) {
+                auto other = state.frozen_frames.find(it->first);
+                if (other == state.frozen_frames.cend() || !(other->second == it->second))
+                    markCombedDirty(it->second.first, it->second.last);
+            }
+
+            // Compare the presets applied to each stretch between the section starts of both states.
+            std::set<int> starts;
+            for (auto it = state.sections.cbegin(); it != state.sections.cend(); it++)
+                starts.insert(it->first);
+            for (auto it = sections->cbegin(); it != sections->cend(); it++)
+                starts.insert(it->first);
+
+            for (auto it = starts.cbegin(); it != starts.cend(); it++) {
+                auto a = std::prev(state.sections.upper_bound(*it));
+                auto b = std::prev(sections->upper_bound(*it));
+
+                if (a->second.presets != b->second.presets) {
+                    auto next = std::next(it);
+                    markCombedDirty(*it, (next != starts.cend() ? *next : getNumFrames(PostSource)) - 1);
+                }
+            }
+        }
+    }
+
+    FrameRange changed_matches = { 0, getNumFrames(PostSource) - 1 };
+
+    if (state.matches.size() == matches.size()) {
+        auto first = std::mismatch(matches.cbegin(), matches.cend(), state.matches.cbegin());
+        auto last = std::mismatch(matches.crbegin(), matches.crend(), state.matches.crbegin());
+
+        changed_matches = { (int)(first.first - matches.cbegin()), (int)(matches.crend() - last.first) - 1 };
+    }
+
+    // Both states always have the same number of cycles.
+    auto first_cycle = std::mismatch(decimated_frames.cbegin(), decimated_frames.cend(), state.decimated_frames.cbegin());
+    auto last_cycle = std::mismatch(decimated_frames.crbegin(), decimated_frames.crend(), state.decimated_frames.crbegin());
+
+    FrameRange changed_decimation = { (int)(first_cycle.first - decimated_frames.cbegin()) * 5, std::min((int)(decimated_frames.crend() - last_cycle.first) * 5, getNumFrames(PostSource)) - 1 };
+
     matches = state.matches;
     decimated_frames = state.decimated_frames;
     pattern_guessing = state.pattern_guessing;
 
+    if (changed_matches.first <= changed_matches.last)
+        matchesChanged(changed_matches.first, changed_matches.last);
+
+    updateEditedDecimations(changed_decimation.first, changed_decimation.last);
+
+    rebuildDecimationRanges();
+
+    // The IDs of the presets missing from the state stay reserved, as redo may bring them back.
+    for (size_t i = 0; i < preset_names.size(); i++)
+        preset_names[i].clear();
+
     presets->clear();
-    for (auto const& p : state.presets)
+    for (auto const& p : state.presets) {
         presets->insert(p);
 
+        if (p.second.id >= (PresetId)preset_names.size())
+            preset_names.resize(p.second.id + 1);
+        preset_names[p.second.id] = p.second.name;
+    }
+
     custom_lists->clear();
     for (auto const& c : state.custom_lists) {
         custom_lists->push_back(c);
@@ -2906,6 +3812,13 @@ void WobblyProject::restoreState(UndoStep state) {
     bookmarks->clear();
     for (auto const& b : state.bookmarks)
         bookmarks->insert(b);
+
+    rebuildPresetUses();
+
+    // The project is exactly the state now.
+    commit_dirty = { 0, -1 };
+
+    emit framesChanged(0, getNumFrames(PostSource) - 1);
 }
 
 void WobblyProject::commit(std::string description) {
@@ -2921,7 +3834,11 @@ void WobblyProject::commit(std::string description) {
         .frozen_frames = *frozen_frames,
         .sections = *sections,
         .bookmarks = *bookmarks,
+
+        .changed_frames = commit_dirty,
     };
+    commit_dirty = { 0, -1 };
+
     for (auto &cl : step.custom_lists) {
         std::shared_ptr<FrameRangesModel> oldranges = cl.ranges;
         cl.ranges = std::make_shared<FrameRangesModel>();
@@ -2930,8 +3847,13 @@ void WobblyProject::commit(std::string description) {
             cl.ranges->insert(r);
     }
 
+    // The last undo step is always the state the journal has reached.
+    const UndoStep *previous = undo_stack.size() ? &undo_stack.back() : nullptr;
+
     undo_stack.push_back(step);
 
+    journalEdit(description, previous, undo_stack.back(), undo_stack.back().changed_frames);
+
     redo_stack.clear();
 
     while (undo_stack.size() > undo_steps)
@@ -2943,6 +3865,7 @@ void WobblyProject::undo() {
     redo_stack.push_back(undo_stack.back());
     undo_stack.pop_back();
     restoreState(undo_stack.back());
+    journalEdit("Undo " + redo_stack.back().description, &redo_stack.back(), undo_stack.back(), redo_stack.back().changed_frames);
 }
 
 void WobblyProject::redo() {
@@ -2950,6 +3873,7 @@ void WobblyProject::redo() {
     restoreState(redo_stack.back());
     undo_stack.push_back(redo_stack.back());
     redo_stack.pop_back();
+    journalEdit("Redo " + undo_stack.back().description, undo_stack.size() > 1 ? &*std::prev(undo_stack.end(), 2) : nullptr, undo_stack.back(), undo_stack.back().changed_frames);
 }
 
 void WobblyProject::setUndoSteps(size_t steps) {
@@ -2964,6 +3888,82 @@ void WobblyProject::setUndoSteps(size_t steps) {
 }
 
 
+void WobblyProject::journalEdit(const std::string &description, const UndoStep *before, const UndoStep &after, const FrameRange &changed_frames) {
+    if (!journal)
+        return;
+
+    try {
+        journal->append(description, before, after, changed_frames);
+    } catch (WobblyException &e) {
+        journal.reset();
+
+        emit journalFailed(e.what());
+        return;
+    }
+
+    emit editJournalled(journal->getNumEdits());
+}
+
+
+void WobblyProject::startJournal(const std::string &project_path, bool keep_edits) {
+    if (journal) {
+        journal.reset();
+        if (journal_project_path != project_path)
+            WobblyJournal::remove(journal_project_path);
+    }
+
+    journal = std::make_unique<WobblyJournal>(project_path, keep_edits);
+    journal_project_path = project_path;
+}
+
+
+int WobblyProject::getJournalEdits() const {
+    return journal ? journal->getNumEdits() : 0;
+}
+
+
+int WobblyProject::countJournalEdits(const std::string &project_path) {
+    return (int)WobblyJournal::readEdits(project_path).size();
+}
+
+
+int WobblyProject::replayJournal(const std::string &project_path) {
+    std::vector<JournalEdit> edits = WobblyJournal::readEdits(project_path);
+    if (edits.empty())
+        return 0;
+
+    if (undo_stack.empty())
+        throw WobblyException("Can't replay the journal of '" + project_path + "': the project's initial state was never committed.");
+
+    // Nothing changes unless every edit can be applied.
+    std::list<UndoStep> steps;
+    UndoStep state = undo_stack.back();
+
+    for (size_t i = 0; i < edits.size(); i++) {
+        WobblyJournal::applyEdit(edits[i], state);
+
+        steps.push_back(state);
+        while (steps.size() > undo_steps)
+            steps.pop_front();
+    }
+
+    if (state.matches.size() != matches.size() || state.decimated_frames.size() != decimated_frames.size())
+        throw WobblyException("Can't replay the journal of '" + project_path + "': it was made for a project with a different number of frames.");
+
+    undo_stack.splice(undo_stack.end(), steps);
+    redo_stack.clear();
+
+    while (undo_stack.size() > undo_steps)
+        undo_stack.pop_front();
+
+    restoreState(state);
+
+    setModified(true);
+
+    return (int)edits.size();
+}
+
+
 int WobblyProject::getZoom() const {
     return zoom;
 }
@@ -3042,7 +4042,12 @@ int WobblyProject::getCMatchSequencesMinimum() const {
 
 
 void WobblyProject::setCMatchSequencesMinimum(int minimum) {
+    if (c_match_sequences_minimum == minimum)
+        return;
+
     c_match_sequences_minimum = minimum;
+
+    markCMatchesDirty(0, getNumFrames(PostSource) - 1);
 }
 
 
@@ -3944,6 +4949,39 @@ int WobblyProject::findPreviousCombedFrame(int frame) const {
 }
 
 
+int WobblyProject::findNextPatternMismatch(int frame, const std::string &pattern) const {
+    if (pattern.size() < 5)
+        throw WobblyException("Can't look for frames that don't follow the match pattern '" + pattern + "': it must have at least five matches.");
+
+    int found = match_runs.findNextMismatch(frame + 1, getNumFrames(PostSource) - 1, pattern);
+
+    if (found != -1)
+        return found;
+
+    return frame;
+}
+
+
+int WobblyProject::findNextEditedRange(int frame) const {
+    int found = findFirstEditedFrame(findFirstUneditedFrame(frame));
+
+    if (found != -1)
+        return found;
+
+    return frame;
+}
+
+
+int WobblyProject::findPreviousEditedRange(int frame) const {
+    int found = findLastEditedFrame(frame - 1);
+
+    if (found != -1)
+        return findLastUneditedFrame(found) + 1;
+
+    return frame;
+}
+
+
 int WobblyProject::findNextAmbiguousPatternSection(int frame) const {
     FailedPatternGuessingMap::const_iterator it = pattern_guessing.failures.upper_bound(frame);
 
@@ -3967,8 +5005,8 @@ int WobblyProject::findPreviousAmbiguousPatternSection(int frame) const {
 }
 
 
-void WobblyProject::sectionsToScript(std::string &script) const {
-    auto samePresets = [] (const std::vector<std::string> &a, const std::vector<std::string> &b) -> bool {
+void WobblyProject::sectionsToScript(std::string &script, bool route, ScriptVariables *variables) const {
+    auto samePresets = [] (const std::vector<PresetId> &a, const std::vector<PresetId> &b) -> bool {
         if (a.size() != b.size())
             return false;
 
@@ -3987,6 +5025,54 @@ void WobblyProject::sectionsToScript(std::string &script) const {
             merged_sections.insert({ it->first, it->second });
 
 
+    if (route) {
+        // Sections with the same presets share a clip.
+        std::map<std::vector<PresetId>, size_t> chains;
+
+        std::string starts = ", starts=[";
+        std::string indices = ", indices=[";
+
+        std::vector<int64_t> starts_array;
+        std::vector<int64_t> indices_array;
+
+        for (auto it = merged_sections.cbegin(); it != merged_sections.cend(); it++) {
+            auto chain = chains.find(it->second.presets);
+
+            if (chain == chains.cend()) {
+                chain = chains.insert({ it->second.presets, chains.size() }).first;
+
+                std::string chain_name = "chain" + std::to_string(chain->second);
+                script += chain_name + " = src\n";
+
+                for (size_t i = 0; i < it->second.presets.size(); i++)
+                    script += chain_name + " = preset_" + preset_names[it->second.presets[i]] + "(" + chain_name + ")\n";
+            }
+
+            if (variables) {
+                starts_array.push_back(it->first);
+                indices_array.push_back(chain->second);
+            } else {
+                starts += std::to_string(it->first) + ",";
+                indices += std::to_string(chain->second) + ",";
+            }
+        }
+
+        script += "src = c.wobbly.Route(clips=[";
+        for (size_t i = 0; i < chains.size(); i++)
+            script += "chain" + std::to_string(i) + ",";
+
+        if (variables) {
+            script += "], starts=wobbly_section_starts, indices=wobbly_section_indices)\n\n";
+
+            variables->int_arrays["wobbly_section_starts"] = std::move(starts_array);
+            variables->int_arrays["wobbly_section_indices"] = std::move(indices_array);
+        } else {
+            script += "]" + starts + "]" + indices + "])\n\n";
+        }
+
+        return;
+    }
+
     std::string splice = "src = c.std.Splice(mismatch=True, clips=[";
     for (auto it = merged_sections.cbegin(); it != merged_sections.cend(); it++) {
         std::string section_name = "section";
@@ -3996,7 +5082,7 @@ void WobblyProject::sectionsToScript(std::string &script) const {
         for (size_t i = 0; i < it->second.presets.size(); i++) {
             script += "\n";
             script += section_name + " = preset_";
-            script += it->second.presets[i] + "(";
+            script += preset_names[it->second.presets[i]] + "(";
             script += section_name + ")";
         }
 
@@ -4031,7 +5117,7 @@ int WobblyProject::maybeTranslate(int frame, bool is_end, PositionInFilterChain
 }
 
 
-void WobblyProject::customListsToScript(std::string &script, PositionInFilterChain position) const {
+void WobblyProject::customListsToScript(std::string &script, PositionInFilterChain position, bool route) const {
     for (size_t i = 0; i < custom_lists->size(); i++) {
         const CustomList &cl = custom_lists->at(i);
 
@@ -4053,6 +5139,41 @@ void WobblyProject::customListsToScript(std::string &script, PositionInFilterCha
 
         script += list_name + " = preset_" + cl.preset + "(src)\n";
 
+        if (route) {
+            std::string starts = ", starts=[";
+            std::string indices = ", indices=[";
+
+            int next_frame = 0;
+
+            for (auto it = cl.ranges->cbegin(); it != cl.ranges->cend(); it++) {
+                int first = maybeTranslate(it->second.first, false, position);
+                int last = maybeTranslate(it->second.last, true, position);
+
+                // Every frame of the range was decimated.
+                if (last < first)
+                    continue;
+
+                if (first > next_frame) {
+                    starts += std::to_string(next_frame) + ",";
+                    indices += "0,";
+                }
+
+                starts += std::to_string(first) + ",";
+                indices += "1,";
+
+                next_frame = last + 1;
+            }
+
+            if (next_frame <= maybeTranslate(getNumFrames(PostSource) - 1, true, position)) {
+                starts += std::to_string(next_frame) + ",";
+                indices += "0,";
+            }
+
+            script += "src = c.wobbly.Route(clips=[src," + list_name + "]" + starts + "]" + indices + "])\n\n";
+
+            continue;
+        }
+
         std::string splice = "src = c.std.Splice(mismatch=True, clips=[";
 
         auto it = cl.ranges->cbegin();
@@ -4124,6 +5245,33 @@ void WobblyProject::presetsToScript(std::string &script) const {
 }
 
 
+void WobblyProject::presetProfilingToScript(std::string &script) const {
+    script +=
+            "wobbly_profile_names = []\n"
+            "wobbly_profile_inputs = []\n"
+            "wobbly_profile_outputs = []\n"
+            "\n"
+            "def wobbly_profile(name, preset):\n"
+            "    def profiled_preset(clip):\n"
+            "        output = preset(clip)\n"
+            "        wobbly_profile_names.append(name)\n"
+            "        wobbly_profile_inputs.append(clip)\n"
+            "        wobbly_profile_outputs.append(output)\n"
+            "        return output\n"
+            "    return profiled_preset\n"
+            "\n";
+
+    for (auto it = presets->cbegin(); it != presets->cend(); it++) {
+        if (!isPresetInUse(it->second.name))
+            continue;
+
+        script += "preset_" + it->second.name + " = wobbly_profile('" + it->second.name + "', preset_" + it->second.name + ")\n";
+    }
+
+    script += "\n\n";
+}
+
+
 const char *WobblyProject::getArgsForSourceFilter() const {
     if (source_filter == "bs.VideoSource")
         return ", rff=True, showprogress=False";
@@ -4166,24 +5314,74 @@ void WobblyProject::trimToScript(std::string &script) const {
 }
 
 
-void WobblyProject::fieldHintToScript(std::string &script) const {
+void WobblyProject::fieldHintToScript(std::string &script, ScriptVariables *variables) const {
     if (!matches.size() && !original_matches.size())
         return;
 
+    const std::vector<char> &hints = matches.size() ? matches : original_matches;
+
     script += "src = c.fh.FieldHint(clip=src, tff=";
     script += std::to_string(vfm_parameters_int.at("order"));
-    script += ", matches='";
-    if (matches.size())
-        script.append(matches.data(), matches.size());
-    else
-        script.append(original_matches.data(), original_matches.size());
+
+    if (variables) {
+        script += ", matches=wobbly_matches";
+
+        variables->data["wobbly_matches"].assign(hints.data(), hints.size());
+    } else if (match_runs.size() * 32 < hints.size()) {
+        // Mostly long stretches of the same pattern, so each one is written once with a repeat count.
+        script += ", matches=''.join((";
+
+        for (auto it = match_runs.cbegin(); it != match_runs.cend(); it++) {
+            const MatchRun &run = it->second;
+            int length = run.last - run.first + 1;
+
+            std::string cycle;
+            for (int i = run.first; i < run.first + std::min(length, 5); i++)
+                cycle += run.pattern[i % 5];
+
+            if (length >= 5)
+                script += "'" + cycle + "'*" + std::to_string(length / 5) + ",";
+
+            if (length % 5)
+                script += "'" + cycle.substr(0, length % 5) + "',";
+        }
+
+        script += "))";
+    } else {
+        script += ", matches='";
+        script.append(hints.data(), hints.size());
+        script += "'";
+    }
+
     script +=
-            "')\n"
+            ")\n"
             "\n";
 }
 
 
-void WobblyProject::freezeFramesToScript(std::string &script) const {
+void WobblyProject::freezeFramesToScript(std::string &script, ScriptVariables *variables) const {
+    if (variables) {
+        std::vector<int64_t> &first = variables->int_arrays["wobbly_freeze_first"];
+        std::vector<int64_t> &last = variables->int_arrays["wobbly_freeze_last"];
+        std::vector<int64_t> &replacement = variables->int_arrays["wobbly_freeze_replacement"];
+
+        first.clear();
+        last.clear();
+        replacement.clear();
+
+        for (auto it = frozen_frames->cbegin(); it != frozen_frames->cend(); it++) {
+            first.push_back(it->second.first);
+            last.push_back(it->second.last);
+            replacement.push_back(it->second.replacement);
+        }
+
+        script +=
+                "src = c.std.FreezeFrames(clip=src, first=wobbly_freeze_first, last=wobbly_freeze_last, replacement=wobbly_freeze_replacement)\n"
+                "\n";
+
+        return;
+    }
+
     std::string ff_first = ", first=[";
     std::string ff_last = ", last=[";
     std::string ff_replacement = ", replacement=[";
@@ -4207,7 +5405,7 @@ void WobblyProject::freezeFramesToScript(std::string &script) const {
 }
 
 
-void WobblyProject::decimatedFramesToScript(std::string &script, DecimationFunction decimation_function) const {
+void WobblyProject::decimatedFramesToScript(std::string &script, DecimationFunction decimation_function, ScriptVariables *variables) const {
     std::string delete_frames;
 
     const DecimationRangeVector &decimation_ranges = getDecimationRanges();
@@ -4237,11 +5435,17 @@ void WobblyProject::decimatedFramesToScript(std::string &script, DecimationFunct
 
     delete_frames += "])\n";
 
+    size_t delete_frames_list_start = delete_frames.size();
+
     delete_frames += "src = c.std.DeleteFrames(clip=src, frames=[";
 
+    std::vector<int64_t> deleted;
+
     for (size_t i = 0; i < decimated_frames.size(); i++)
-        for (auto it = decimated_frames[i].cbegin(); it != decimated_frames[i].cend(); it++)
+        for (auto it = decimated_frames[i].cbegin(); it != decimated_frames[i].cend(); it++) {
             delete_frames += std::to_string(i * 5 + *it) + ",";
+            deleted.push_back(i * 5 + *it);
+        }
 
     delete_frames +=
             "])\n"
@@ -4291,10 +5495,37 @@ void WobblyProject::decimatedFramesToScript(std::string &script, DecimationFunct
 
     select_every += "\n" + splice + "])\n\n";
 
-    if (decimation_function == DELETEFRAMES || (decimation_function == AUTO && delete_frames.size() < select_every.size()))
+    // The choice doesn't depend on variables, so the preview uses the same function as the saved script.
+    if (decimation_function == DELETEFRAMES || (decimation_function == AUTO && delete_frames.size() < select_every.size())) {
+        if (variables) {
+            delete_frames.resize(delete_frames_list_start);
+            delete_frames +=
+                    "src = c.std.DeleteFrames(clip=src, frames=wobbly_deleted_frames)\n"
+                    "\n";
+
+            variables->int_arrays["wobbly_deleted_frames"] = std::move(deleted);
+        }
+
         script += delete_frames;
-    else
+    } else {
         script += select_every;
+    }
+}
+
+
+void WobblyProject::wobblyApplyToScript(std::string &script, const std::string &project_path, bool match, bool freeze, bool decimate) const {
+    script += "src = c.wobbly.Apply(clip=src, project=r'" + handleSingleQuotes(project_path) + "'";
+
+    if (!match)
+        script += ", match=False";
+    if (!freeze)
+        script += ", freeze=False";
+    if (!decimate)
+        script += ", decimate=False";
+
+    script +=
+            ")\n"
+            "\n";
 }
 
 
@@ -4336,7 +5567,7 @@ void WobblyProject::setOutputToScript(std::string &script) const {
 }
 
 
-std::string WobblyProject::generateFinalScript(bool save_source_node, FinalScriptFormat format) const {
+std::string WobblyProject::generateFinalScript(bool save_source_node, FinalScriptFormat format, ScriptVariables *variables) const {
     // XXX Insert comments before and after each part.
     std::string script;
 
@@ -4344,6 +5575,9 @@ std::string WobblyProject::generateFinalScript(bool save_source_node, FinalScrip
 
     presetsToScript(script);
 
+    if (format.profile_presets)
+        presetProfilingToScript(script);
+
     sourceToScript(script, save_source_node);
 
     if (crop.early && crop.enabled)
@@ -4351,27 +5585,53 @@ std::string WobblyProject::generateFinalScript(bool save_source_node, FinalScrip
 
     trimToScript(script);
 
-    customListsToScript(script, PostSource);
+    customListsToScript(script, PostSource, format.wobbly_plugin);
 
-    fieldHintToScript(script);
+    if (format.project_path.size()) {
+        // The plugin can do everything in one go, unless something must happen between
+        // the field matching and the frozen frames.
+        bool filters_after_matching = false;
 
-    customListsToScript(script, PostFieldMatch);
+        for (auto it = sections->cbegin(); it != sections->cend(); it++)
+            if (it->second.presets.size())
+                filters_after_matching = true;
 
-    sectionsToScript(script);
+        for (size_t i = 0; i < custom_lists->size(); i++)
+            if (custom_lists->at(i).position == PostFieldMatch && custom_lists->at(i).ranges->size())
+                filters_after_matching = true;
 
-    if (frozen_frames->size())
-        freezeFramesToScript(script);
+        if (filters_after_matching) {
+            wobblyApplyToScript(script, format.project_path, true, false, false);
 
-    bool decimation_needed = false;
-    for (size_t i = 0; i < decimated_frames.size(); i++)
-        if (decimated_frames[i].size()) {
-            decimation_needed = true;
-            break;
+            customListsToScript(script, PostFieldMatch, format.wobbly_plugin);
+
+            sectionsToScript(script, format.wobbly_plugin, variables);
+
+            wobblyApplyToScript(script, format.project_path, false, true, true);
+        } else {
+            wobblyApplyToScript(script, format.project_path, true, true, true);
         }
-    if (decimation_needed)
-        decimatedFramesToScript(script, format.decimation_function);
+    } else {
+        fieldHintToScript(script, variables);
+
+        customListsToScript(script, PostFieldMatch, format.wobbly_plugin);
+
+        sectionsToScript(script, format.wobbly_plugin, variables);
+
+        if (frozen_frames->size())
+            freezeFramesToScript(script, variables);
+
+        bool decimation_needed = false;
+        for (size_t i = 0; i < decimated_frames.size(); i++)
+            if (decimated_frames[i].size()) {
+                decimation_needed = true;
+                break;
+            }
+        if (decimation_needed)
+            decimatedFramesToScript(script, format.decimation_function, variables);
+    }
 
-    customListsToScript(script, PostDecimate);
+    customListsToScript(script, PostDecimate, format.wobbly_plugin);
 
     if (!crop.early && crop.enabled)
         cropToScript(script);
@@ -4385,7 +5645,7 @@ std::string WobblyProject::generateFinalScript(bool save_source_node, FinalScrip
 }
 
 
-std::string WobblyProject::generateMainDisplayScript() const {
+std::string WobblyProject::generateMainDisplayScript(ScriptVariables *variables) const {
     std::string script;
 
     headerToScript(script);
@@ -4394,10 +5654,10 @@ std::string WobblyProject::generateMainDisplayScript() const {
 
     trimToScript(script);
 
-    fieldHintToScript(script);
+    fieldHintToScript(script, variables);
 
     if (frozen_frames->size() && freeze_frames_wanted)
-        freezeFramesToScript(script);
+        freezeFramesToScript(script, variables);
 
     setOutputToScript(script);
 
@@ -4405,6 +5665,17 @@ std::string WobblyProject::generateMainDisplayScript() const {
 }
 
 
+std::string WobblyProject::generateSourceScript() const {
+    std::string script;
+
+    headerToScript(script);
+
+    sourceToScript(script, true);
+
+    return script;
+}
+
+
 std::string WobblyProject::generateTimecodesV1() const {
     std::string tc =
             "# timecode format v1\n"
@@ -4457,7 +5728,22 @@ std::string WobblyProject::generateKeyframesV1() const {
 void WobblyProject::importFromOtherProject(const std::string &path, const ImportedThings &imports) {
     std::unique_ptr<WobblyProject> other(new WobblyProject(true));
 
-    other->readProject(path);
+    // The metrics, matches, and sections make up most of a project, and nothing here needs them.
+    std::unordered_set<std::string> keys;
+    if (imports.geometry || imports.mic_search || imports.zoom)
+        keys.insert(Keys::user_interface);
+    if (imports.presets || imports.custom_lists)
+        keys.insert(Keys::presets);
+    if (imports.custom_lists)
+        keys.insert(Keys::custom_lists);
+    if (imports.crop)
+        keys.insert(Keys::crop);
+    if (imports.resize)
+        keys.insert(Keys::resize);
+    if (imports.bit_depth)
+        keys.insert(Keys::depth);
+
+    other->readProject(path, {}, &keys);
 
     if (imports.geometry) {
         setUIState(other->getUIState());
@@ -30,8 +30,11 @@ SOFTWARE.
 #endif
 
 #include <cstdint>
+#include <functional>
+#include <memory>
 
 #include <unordered_map>
+#include <unordered_set>
 #include <map>
 
 #include <set>
@@ -43,9 +46,14 @@ SOFTWARE.
 #include <QObject>
 
 #include "BookmarksModel.h"
+#include "CMatchSequencesModel.h"
 #include "CombedFramesModel.h"
 #include "CustomListsModel.h"
+#include "EditedFramesModel.h"
+#include "FrameBitset.h"
+#include "FrameRatesModel.h"
 #include "FrozenFramesModel.h"
+#include "MatchRuns.h"
 #include "PresetsModel.h"
 #include "OrphanFieldsModel.h"
 #include "SectionsModel.h"
@@ -100,6 +108,8 @@ struct UndoStep {
     FreezeFrameMap frozen_frames;
     SectionMap sections;
     BookmarkMap bookmarks;
+
+    FrameRange changed_frames = { 0, -1 }; // Frames whose match or decimation differ from the step before.
 };
 
 
@@ -111,8 +121,38 @@ enum DecimationFunction {
 
 struct FinalScriptFormat {
     DecimationFunction decimation_function;
+
+    // If true, the sections and the custom lists are put together with wobbly.Route
+    // instead of std.Splice.
+    bool wobbly_plugin;
+
+    // If not empty, the matches, the frozen frames, and the decimation are applied
+    // by the Wobbly plugin, which reads them from this project file.
+    std::string project_path;
+
+    // If true, every call to a preset records the preset's name, input, and output
+    // in the lists wobbly_profile_names, wobbly_profile_inputs, and wobbly_profile_outputs.
+    bool profile_presets;
 };
 
+// Tables that a generated script expects to find among its variables, instead of
+// as literals in the script. They must be passed to the script with setVariables.
+struct ScriptVariables {
+    std::map<std::string, std::string> data;
+    std::map<std::string, std::vector<int64_t> > int_arrays;
+};
+
+// Called by readProject from the thread it runs in.
+struct ReadProjectCallbacks {
+    // The input file, the trims, and the source filter are known.
+    std::function<void ()> header_read;
+
+    // Returning false stops reading the project, which then throws WobblyException.
+    std::function<bool (int step, int steps)> progress;
+};
+
+class WobblyJournal;
+
 class WobblyProject : public QObject {
     Q_OBJECT
 
@@ -150,15 +190,30 @@ class WobblyProject : public QObject {
         std::vector<std::array<int32_t, 2> > vmetrics;
         std::vector<char> matches;
         std::vector<char> original_matches;
+
+        // The matches that are used: matches, or original_matches if there are no matches.
+        MatchRuns match_runs;
+
         std::vector<std::set<int8_t> > decimated_frames; // unordered_set may be sufficient.
         std::vector<int> decimate_metrics;
 
+        // The frames the decimator dropped. Empty if they aren't known.
+        FrameBitset original_decimated_frames;
+
+        // Frames whose match or decimation differs from the original one.
+        FrameBitset edited_matches;
+        FrameBitset edited_decimations;
+
         bool is_wobbly; // XXX Maybe only the json writing function needs to know.
 
         PatternGuessing pattern_guessing;
 
         InterlacedFadeMap interlaced_fades; // Key is InterlacedFade::frame
 
+        // Preset names, indexed by PresetId. Empty for presets that were deleted.
+        // IDs are never reused, so undo steps can refer to deleted presets safely.
+        std::vector<std::string> preset_names;
+
         CombedFramesModel *combed_frames;
         OrphanFieldsModel *orphan_fields;
         FrozenFramesModel *frozen_frames;
@@ -166,6 +221,30 @@ class WobblyProject : public QObject {
         CustomListsModel *custom_lists;
         SectionsModel *sections;
         BookmarksModel *bookmarks;
+        FrameRatesModel *frame_rates;               // Kept up to date with decimated_frames.
+        CMatchSequencesModel *c_match_sequences;    // Brought up to date by updateCMatchSequences.
+        EditedFramesModel *edited_frames;           // Brought up to date by updateEditedFrames.
+
+        // Frames whose matches changed since the C match sequences were last updated.
+        FrameRange c_match_dirty = { 0, -1 };
+
+        // Frames whose edited status changed since the edited frames were last updated.
+        FrameRange edited_dirty = { 0, -1 };
+
+        // Frames whose match or decimation changed since the last commit.
+        FrameRange commit_dirty = { 0, -1 };
+
+        // Where each preset is used, so that checking, renaming, and deleting
+        // a preset only has to look at the sections and lists that use it.
+        struct PresetUses {
+            std::set<int> sections; // Starts of the sections that use the preset, once or more.
+            int custom_lists = 0;   // Number of custom lists that use the preset.
+        };
+        std::unordered_map<PresetId, PresetUses> preset_uses;
+
+        // Frames whose combed status may have changed since the combed frames were last detected.
+        std::map<int, int> combed_dirty_ranges; // Key is the first frame, value is the last frame
+        bool combed_dirty_all = true;
 
         DMetrics dmetrics = { false, 10 };
         Resize resize = { false, 0, 0, "spline16" };
@@ -182,26 +261,62 @@ class WobblyProject : public QObject {
         std::list<UndoStep> redo_stack;
         size_t undo_steps;
 
+        std::unique_ptr<WobblyJournal> journal;
+        std::string journal_project_path;
+
         // Only functions below.
 
         static bool isValidMatchChar(char match);
         void setNumFrames(PositionInFilterChain position, int frames);
 
         bool isNameSafeForPython(const std::string &name) const;
+        bool presetIdExists(PresetId preset_id) const;
         int maybeTranslate(int frame, bool is_end, PositionInFilterChain position) const;
 
         void applyPatternGuessingDecimation(const int section_start, const int section_end, const int first_duplicate, int drop_duplicate);
 
         void restoreState(UndoStep state);
 
+        void markCombedDirty(int first, int last);
+        void markCombedDirtyAll();
+        void markSectionCombedDirty(int section_start);
+        void markPresetCombedDirty(const std::string &preset_name);
+        void markCustomListCombedDirty(int list_index);
+
+        void updateSectionPresetUse(int section_start, PresetId preset_id);
+        void addSectionPresetUses(const Section &section);
+        void removeSectionPresetUses(const Section &section);
+        void addCustomListPresetUse(const std::string &preset_name);
+        void removeCustomListPresetUse(const std::string &preset_name);
+        void rebuildPresetUses();
+
+        void rebuildDecimationRanges();
+        void markCMatchesDirty(int first, int last);
+        void matchesChanged(int first, int last);
+
+        void updateEditedMatches(int first, int last);
+        void updateEditedDecimations(int first, int last);
+        void markEditedFramesDirty(int first, int last);
+        void markCommitDirty(int first, int last);
+        int findFirstEditedFrame(int frame) const;
+        int findLastEditedFrame(int frame) const;
+        int findFirstUneditedFrame(int frame) const;
+        int findLastUneditedFrame(int frame) const;
+
+        void journalEdit(const std::string &description, const UndoStep *before, const UndoStep &after, const FrameRange &changed_frames);
+
     public:
         WobblyProject(bool _is_wobbly);
         WobblyProject(bool _is_wobbly, const std::string &_input_file, const std::string &_source_filter, int64_t _fps_num, int64_t _fps_den, int _width, int _height, int _num_frames);
+        ~WobblyProject();
 
         int getNumFrames(PositionInFilterChain position) const;
 
-        void writeProject(const std::string &path, bool compact_project);
-        void readProject(const std::string &path);
+        // With compress_project the file is gzip. readProject notices by itself.
+        void writeProject(const std::string &path, bool compact_project, bool compress_project = false);
+        // With only_keys, the top level keys not in it are skipped without being built,
+        // except the ones every project must have.
+        void readProject(const std::string &path, const ReadProjectCallbacks &callbacks = {}, const std::unordered_set<std::string> *only_keys = nullptr);
 
 
         void addFreezeFrame(int first, int last, int replacement);
@@ -218,6 +333,8 @@ class WobblyProject : public QObject {
         void setPresetContents(const std::string &preset_name, const std::string &preset_contents);
         bool isPresetInUse(const std::string &preset_name) const;
         bool presetExists(const std::string &preset_name) const;
+        PresetId getPresetId(const std::string &preset_name) const;
+        const std::string &getPresetName(PresetId preset_id) const;
         PresetsModel *getPresetsModel();
 
 
@@ -227,6 +344,7 @@ class WobblyProject : public QObject {
         void setVFMParameter(const std::string &name, int value);
         void setVFMParameter(const std::string &name, double value);
         void setVFMParameter(const std::string &name, bool value);
+        int getVFMParameterInt(const std::string &name) const;
 
         void setVDecimateParameter(const std::string &name, int value);
         void setVDecimateParameter(const std::string &name, double value);
@@ -304,13 +422,24 @@ class WobblyProject : public QObject {
         bool isDecimatedFrame(int frame) const;
         void clearDecimatedFramesFromCycle(int frame);
 
+        void addOriginalDecimatedFrame(int frame);
+
 
-        DecimationRangeVector getDecimationRanges() const;
+        FrameRatesModel *getFrameRatesModel();
+        const DecimationRangeVector &getDecimationRanges() const;
         DecimationPatternRangeVector getDecimationPatternRanges() const;
 
 
         std::map<size_t, size_t> getCMatchSequences(int minimum) const;
 
+        CMatchSequencesModel *getCMatchSequencesModel();
+        // Updates the model's sequences around the matches changed since the last call.
+        void updateCMatchSequences();
+
+        EditedFramesModel *getEditedFramesModel();
+        // Updates the model's ranges around the frames edited since the last call.
+        void updateEditedFrames();
+
         void updateOrphanFields();
         void updateSectionOrphanFields(int section_start, int section_end);
 
@@ -319,6 +448,10 @@ class WobblyProject : public QObject {
         void deleteCombedFrame(int frame);
         bool isCombedFrame(int frame) const;
         void clearCombedFrames();
+        void setCombedFrames(std::vector<int> frames);
+        std::vector<FrameRange> getCombedDirtyRanges() const;
+        std::vector<int> getFramesAfterDecimation(const std::vector<FrameRange> &ranges) const;
+        void updateCombedFrames(const std::vector<FrameRange> &checked_ranges, const std::vector<int> &frames);
 
         OrphanFieldsModel *getOrphanFieldsModel();
         void deleteOrphanField(int frame);
@@ -364,6 +497,14 @@ class WobblyProject : public QObject {
         void redo();
         void setUndoSteps(size_t steps);
 
+        // The journal records every commit, undo, and redo made after the project
+        // file was last read or written. It is removed when the project is closed.
+        void startJournal(const std::string &project_path, bool keep_edits);
+        int getJournalEdits() const;
+        static int countJournalEdits(const std::string &project_path);
+        // Applies the edits in the journal of the project file as new undo steps.
+        int replayJournal(const std::string &project_path);
+
 
         int getZoom() const;
         void setZoom(int ratio);
@@ -431,25 +572,36 @@ class WobblyProject : public QObject {
         int findPreviousCombedFrame(int frame) const;
         int findNextCombedFrame(int frame) const;
 
+        int findNextPatternMismatch(int frame, const std::string &pattern) const;
+
+        // Start of the previous or next range of frames whose match or decimation was edited.
+        int findPreviousEditedRange(int frame) const;
+        int findNextEditedRange(int frame) const;
+
         int findPreviousAmbiguousPatternSection(int frame) const;
         int findNextAmbiguousPatternSection(int frame) const;
 
-        void sectionsToScript(std::string &script) const;
-        void customListsToScript(std::string &script, PositionInFilterChain position) const;
+        void sectionsToScript(std::string &script, bool route, ScriptVariables *variables) const;
+        void customListsToScript(std::string &script, PositionInFilterChain position, bool route) const;
         void headerToScript(std::string &script) const;
         void presetsToScript(std::string &script) const;
+        void presetProfilingToScript(std::string &script) const;
         const char *getArgsForSourceFilter() const;
         void sourceToScript(std::string &script, bool save_node) const;
         void trimToScript(std::string &script) const;
-        void fieldHintToScript(std::string &script) const;
-        void freezeFramesToScript(std::string &script) const;
-        void decimatedFramesToScript(std::string &script, DecimationFunction decimation_function) const;
+        void fieldHintToScript(std::string &script, ScriptVariables *variables) const;
+        void freezeFramesToScript(std::string &script, ScriptVariables *variables) const;
+        void decimatedFramesToScript(std::string &script, DecimationFunction decimation_function, ScriptVariables *variables) const;
+        void wobblyApplyToScript(std::string &script, const std::string &project_path, bool match, bool freeze, bool decimate) const;
         void cropToScript(std::string &script) const;
         void resizeAndBitDepthToScript(std::string &script, bool resize_enabled, bool depth_enabled) const;
         void setOutputToScript(std::string &script) const;
 
-        std::string generateFinalScript(bool save_source_node = true, FinalScriptFormat format = {}) const;
-        std::string generateMainDisplayScript() const;
+        // With variables, the tables that grow with the length of the video are put there.
+        std::string generateFinalScript(bool save_source_node = true, FinalScriptFormat format = {}, ScriptVariables *variables = nullptr) const;
+        std::string generateMainDisplayScript(ScriptVariables *variables = nullptr) const;
+        // Only opens the source, and keeps it at output index 1 for the other scripts.
+        std::string generateSourceScript() const;
 
         std::string generateTimecodesV1() const;
         std::string generateKeyframesV1() const;
@@ -459,6 +611,14 @@ class WobblyProject : public QObject {
 
     signals:
         void modifiedChanged(bool modified);
+
+        // The matches, decimated frames, combed frames, orphan fields, or section
+        // starts changed somewhere between these source frames.
+        void framesChanged(int first, int last);
+
+        void editJournalled(int edits);
+        // The journal was stopped because it couldn't be written.
+        void journalFailed(const std::string &error);
 };
 
 #endif // WOBBLYPROJECT_H
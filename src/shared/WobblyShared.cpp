@@ -62,6 +62,7 @@ static PluginDetectionInfo requiredPlugins[] = {
     {"DMetrics", "com.vapoursynth.dmetrics", "DMetrics", nullptr},
     {"SCXVID", "com.nodame.scxvid", "Scxvid", nullptr},
     {"FieldHint", "com.nodame.fieldhint", "FieldHint", nullptr},
+    {"Wobbly", WOBBLY_PLUGIN_ID, "Route", "Apply"},
     {"TDeintMod", "com.holywu.tdeintmod", "IsCombed", nullptr},
     {"d2vsource", "com.sources.d2vsource", "Source", nullptr},
     {"BestSource", "com.vapoursynth.bestsource", "VideoSource", nullptr},
@@ -28,6 +28,8 @@ SOFTWARE.
 #include <VSScript4.h>
 #include <VapourSynth4.h>
 
+#define WOBBLY_PLUGIN_ID "com.jaded-encoding-thaumaturgy.wobbly"
+
 enum class FilterState
 {
     MissingPlugin,
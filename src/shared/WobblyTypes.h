@@ -39,14 +39,21 @@ struct FreezeFrame {
     int first;
     int last;
     int replacement;
+
+    bool operator==(const FreezeFrame &) const = default;
 };
 
 typedef std::map<int, FreezeFrame> FreezeFrameMap;
 
 
+typedef int PresetId;
+
 struct Preset {
+    PresetId id; // Sections refer to the preset by this. Stays the same when the preset is renamed.
     std::string name; // Must be suitable for use as Python function name.
     std::string contents;
+
+    bool operator==(const Preset &) const = default;
 };
 
 typedef std::map<std::string, Preset> PresetMap;
@@ -54,7 +61,7 @@ typedef std::map<std::string, Preset> PresetMap;
 
 struct Section {
     int start;
-    std::vector<std::string> presets; // Preset names, in user-defined order.
+    std::vector<PresetId> presets; // Preset IDs, in user-defined order.
 
     Section(int _start)
         : start(_start)
@@ -76,6 +83,12 @@ struct CustomList {
         , position(_position)
         , ranges(std::make_shared<FrameRangesModel>())
     { }
+
+    // The ranges are compared by value, because every undo step has its own copy.
+    bool operator==(const CustomList &other) const {
+        return name == other.name && preset == other.preset && position == other.position &&
+               static_cast<const std::map<int, FrameRange> &>(*ranges) == static_cast<const std::map<int, FrameRange> &>(*other.ranges);
+    }
 };
 
 typedef std::vector<CustomList> CustomListVector;
@@ -122,6 +135,8 @@ struct Depth {
 struct DecimationRange {
     int start;
     int num_dropped;
+
+    bool operator==(const DecimationRange &) const = default;
 };
 
 typedef std::vector<DecimationRange> DecimationRangeVector;
@@ -167,6 +182,8 @@ enum Patterns {
 struct FailedPatternGuessing {
     int start;
     int reason;
+
+    bool operator==(const FailedPatternGuessing &) const = default;
 };
 
 typedef std::map<int, FailedPatternGuessing> FailedPatternGuessingMap;
@@ -193,6 +210,8 @@ struct PatternGuessing {
     int decimation;
     int use_patterns;
     FailedPatternGuessingMap failures; // Key is FailedPatternGuessing::start
+
+    bool operator==(const PatternGuessing &) const = default;
 };
 
 
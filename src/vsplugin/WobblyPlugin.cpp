@@ -0,0 +1,692 @@
+/*
+
+Copyright (c) 2015, John Smith
+
+Permission to use, copy, modify, and/or distribute this software for
+any purpose with or without fee is hereby granted, provided that the
+above copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+SOFTWARE.
+
+*/
+
+
+// A VapourSynth plugin that applies a Wobbly project's matches, frozen frames,
+// and decimation in a single filter, using tables built from the project file.
+// It also has the filter that puts together the output of the sections and custom lists,
+// and a scene change detector for Wibbly.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define WOBBLY_SSE2
+#include <emmintrin.h>
+#endif
+
+#include <VapourSynth4.h>
+
+#include "WobblyProject.h"
+
+
+struct OutputFrame {
+    int base;               // The frame whose field is kept, and whose properties are used.
+    int other;              // The frame the other field comes from.
+    bool base_is_top;
+    int8_t num_dropped;     // Frames dropped from the cycle, or -1 when not decimating.
+};
+
+
+struct ApplyData {
+    VSNode *node;
+    VSVideoInfo vi;
+    std::vector<OutputFrame> frames;
+};
+
+
+static void getMatchFields(char match, int frame, int num_frames, bool tff, OutputFrame &output) {
+    output.base = frame;
+    output.other = frame;
+    output.base_is_top = true;
+
+    // Same as VFM with field=!order, and FieldHint: "p" and "n" keep the current
+    // frame's second field (bottom when top field first) and take the first field
+    // from the previous or next frame. "b" and "u" keep the first field instead.
+    if (match == 'p' || match == 'b')
+        output.other = std::max(frame - 1, 0);
+    else if (match == 'n' || match == 'u')
+        output.other = std::min(frame + 1, num_frames - 1);
+    else
+        return;
+
+    output.base_is_top = (match == 'p' || match == 'n') ? !tff : tff;
+}
+
+
+static void buildFrames(ApplyData *d, const WobblyProject &project, bool match, bool freeze, bool decimate) {
+    int num_frames = project.getNumFrames(PostSource);
+
+    if (d->vi.numFrames != num_frames)
+        throw WobblyException("The clip has " + std::to_string(d->vi.numFrames) + " frames, but the project expects " + std::to_string(num_frames) + ".");
+
+    std::vector<int8_t> num_dropped(num_frames, -1);
+
+    if (decimate) {
+        const DecimationRangeVector ranges = project.getDecimationRanges();
+
+        bool decimation_needed = false;
+        for (size_t i = 0; i < ranges.size(); i++)
+            if (ranges[i].num_dropped)
+                decimation_needed = true;
+
+        if (decimation_needed) {
+            for (size_t i = 0; i < ranges.size(); i++) {
+                int range_end = i == ranges.size() - 1 ? num_frames : ranges[i + 1].start;
+
+                std::fill(num_dropped.begin() + ranges[i].start, num_dropped.begin() + range_end, (int8_t)ranges[i].num_dropped);
+            }
+
+            // Like the generated scripts, which splice clips with different frame rates.
+            bool same_rate = std::all_of(ranges.cbegin(), ranges.cend(), [&ranges] (const DecimationRange &range) {
+                return range.num_dropped == ranges[0].num_dropped;
+            });
+            if (same_rate) {
+                d->vi.fpsNum = (30 - ranges[0].num_dropped * 6) * 1000;
+                d->vi.fpsDen = 1001;
+            } else {
+                d->vi.fpsNum = 0;
+                d->vi.fpsDen = 0;
+            }
+        } else {
+            decimate = false;
+        }
+    }
+
+    // Only needed if there is a match other than "c".
+    int tff = -1;
+
+    d->frames.reserve(num_frames);
+
+    for (int i = 0; i < num_frames; i++) {
+        if (decimate && project.isDecimatedFrame(i))
+            continue;
+
+        int frame = i;
+
+        if (freeze) {
+            const FreezeFrame *ff = project.findFreezeFrame(frame);
+            if (ff)
+                frame = ff->replacement;
+        }
+
+        char frame_match = match ? project.getMatch(frame) : 'c';
+        if (frame_match != 'c' && tff == -1)
+            tff = project.getVFMParameterInt("order");
+
+        OutputFrame output;
+        getMatchFields(frame_match, frame, num_frames, tff == 1, output);
+        output.num_dropped = num_dropped[i];
+
+        d->frames.push_back(output);
+    }
+
+    if (d->frames.empty())
+        throw WobblyException("Every frame is decimated.");
+
+    d->vi.numFrames = (int)d->frames.size();
+}
+
+
+static const VSFrame *VS_CC applyGetFrame(int n, int activation_reason, void *instance_data, void **frame_data, VSFrameContext *frame_ctx, VSCore *core, const VSAPI *vsapi) {
+    (void)frame_data;
+
+    const ApplyData *d = (const ApplyData *)instance_data;
+    const OutputFrame &output = d->frames[n];
+
+    if (activation_reason == arInitial) {
+        vsapi->requestFrameFilter(output.base, d->node, frame_ctx);
+        if (output.other != output.base)
+            vsapi->requestFrameFilter(output.other, d->node, frame_ctx);
+    } else if (activation_reason == arAllFramesReady) {
+        const VSFrame *base = vsapi->getFrameFilter(output.base, d->node, frame_ctx);
+
+        if (output.other == output.base && output.num_dropped == -1)
+            return base;
+
+        VSFrame *dst;
+
+        if (output.other == output.base) {
+            dst = vsapi->copyFrame(base, core);
+        } else {
+            const VSFrame *other = vsapi->getFrameFilter(output.other, d->node, frame_ctx);
+            const VSFrame *top = output.base_is_top ? base : other;
+            const VSFrame *bottom = output.base_is_top ? other : base;
+
+            const VSVideoFormat *format = vsapi->getVideoFrameFormat(base);
+
+            dst = vsapi->newVideoFrame(format, vsapi->getFrameWidth(base, 0), vsapi->getFrameHeight(base, 0), base, core);
+
+            for (int plane = 0; plane < format->numPlanes; plane++) {
+                int row_size = vsapi->getFrameWidth(dst, plane) * format->bytesPerSample;
+                int height = vsapi->getFrameHeight(dst, plane);
+                ptrdiff_t stride = vsapi->getStride(dst, plane);
+                uint8_t *dstp = vsapi->getWritePtr(dst, plane);
+
+                for (int y = 0; y < height; y++) {
+                    const VSFrame *src = (y % 2) ? bottom : top;
+
+                    memcpy(dstp + y * stride, vsapi->getReadPtr(src, plane) + y * vsapi->getStride(src, plane), row_size);
+                }
+            }
+
+            vsapi->freeFrame(other);
+        }
+
+        vsapi->freeFrame(base);
+
+        if (output.num_dropped != -1) {
+            // Like std.AssumeFPS.
+            VSMap *props = vsapi->getFramePropertiesRW(dst);
+            vsapi->mapSetInt(props, "_DurationNum", 1001, maReplace);
+            vsapi->mapSetInt(props, "_DurationDen", (30 - output.num_dropped * 6) * 1000, maReplace);
+        }
+
+        return dst;
+    }
+
+    return nullptr;
+}
+
+
+static void VS_CC applyFree(void *instance_data, VSCore *core, const VSAPI *vsapi) {
+    (void)core;
+
+    ApplyData *d = (ApplyData *)instance_data;
+
+    vsapi->freeNode(d->node);
+
+    delete d;
+}
+
+
+static void VS_CC applyCreate(const VSMap *in, VSMap *out, void *user_data, VSCore *core, const VSAPI *vsapi) {
+    (void)user_data;
+
+    std::unique_ptr<ApplyData> d(new ApplyData);
+
+    d->node = vsapi->mapGetNode(in, "clip", 0, nullptr);
+    d->vi = *vsapi->getVideoInfo(d->node);
+
+    int err;
+
+    bool match = !!vsapi->mapGetInt(in, "match", 0, &err);
+    if (err)
+        match = true;
+
+    bool freeze = !!vsapi->mapGetInt(in, "freeze", 0, &err);
+    if (err)
+        freeze = true;
+
+    bool decimate = !!vsapi->mapGetInt(in, "decimate", 0, &err);
+    if (err)
+        decimate = true;
+
+    try {
+        if (d->vi.format.colorFamily == cfUndefined || !d->vi.width || !d->vi.height)
+            throw WobblyException("The clip must have constant format and dimensions.");
+
+        const char *path = vsapi->mapGetData(in, "project", 0, nullptr);
+
+        WobblyProject project(true);
+        project.readProject(path);
+
+        buildFrames(d.get(), project, match, freeze, decimate);
+    } catch (WobblyException &e) {
+        vsapi->mapSetError(out, (std::string("Apply: ") + e.what()).c_str());
+        vsapi->freeNode(d->node);
+        return;
+    }
+
+    VSFilterDependency deps[] = { { d->node, rpGeneral } };
+
+    vsapi->createVideoFilter(out, "Apply", &d->vi, applyGetFrame, applyFree, fmParallel, deps, 1, d.get(), core);
+
+    d.release();
+}
+
+
+struct RouteData {
+    std::vector<VSNode *> nodes;
+    std::vector<int> clip_indices; // One for every frame.
+};
+
+
+static bool isSameVideoFormat(const VSVideoFormat &a, const VSVideoFormat &b) {
+    return a.colorFamily == b.colorFamily &&
+           a.sampleType == b.sampleType &&
+           a.bitsPerSample == b.bitsPerSample &&
+           a.subSamplingW == b.subSamplingW &&
+           a.subSamplingH == b.subSamplingH;
+}
+
+
+static const VSFrame *VS_CC routeGetFrame(int n, int activation_reason, void *instance_data, void **frame_data, VSFrameContext *frame_ctx, VSCore *core, const VSAPI *vsapi) {
+    (void)frame_data;
+    (void)core;
+
+    const RouteData *d = (const RouteData *)instance_data;
+    VSNode *node = d->nodes[d->clip_indices[n]];
+
+    if (activation_reason == arInitial)
+        vsapi->requestFrameFilter(n, node, frame_ctx);
+    else if (activation_reason == arAllFramesReady)
+        return vsapi->getFrameFilter(n, node, frame_ctx);
+
+    return nullptr;
+}
+
+
+static void VS_CC routeFree(void *instance_data, VSCore *core, const VSAPI *vsapi) {
+    (void)core;
+
+    RouteData *d = (RouteData *)instance_data;
+
+    for (size_t i = 0; i < d->nodes.size(); i++)
+        vsapi->freeNode(d->nodes[i]);
+
+    delete d;
+}
+
+
+static void VS_CC routeCreate(const VSMap *in, VSMap *out, void *user_data, VSCore *core, const VSAPI *vsapi) {
+    (void)user_data;
+
+    std::unique_ptr<RouteData> d(new RouteData);
+
+    int num_clips = vsapi->mapNumElements(in, "clips");
+    for (int i = 0; i < num_clips; i++)
+        d->nodes.push_back(vsapi->mapGetNode(in, "clips", i, nullptr));
+
+    // Like std.Splice with mismatch=True, properties that differ between the clips become variable.
+    VSVideoInfo vi = *vsapi->getVideoInfo(d->nodes[0]);
+
+    try {
+        for (int i = 1; i < num_clips; i++) {
+            const VSVideoInfo *clip_vi = vsapi->getVideoInfo(d->nodes[i]);
+
+            if (clip_vi->numFrames != vi.numFrames)
+                throw WobblyException("All the clips must have the same number of frames.");
+
+            if (!isSameVideoFormat(clip_vi->format, vi.format))
+                vi.format = {};
+
+            if (clip_vi->width != vi.width || clip_vi->height != vi.height) {
+                vi.width = 0;
+                vi.height = 0;
+            }
+
+            if ((int64_t)clip_vi->fpsNum * vi.fpsDen != (int64_t)vi.fpsNum * clip_vi->fpsDen || (!clip_vi->fpsDen != !vi.fpsDen)) {
+                vi.fpsNum = 0;
+                vi.fpsDen = 0;
+            }
+        }
+
+        // Frames from starts[i] until starts[i + 1] come from clips[indices[i]].
+        int num_starts = vsapi->mapNumElements(in, "starts");
+        if (num_starts < 1 || num_starts != vsapi->mapNumElements(in, "indices"))
+            throw WobblyException("starts and indices must have the same number of elements, at least one.");
+
+        const int64_t *starts = vsapi->mapGetIntArray(in, "starts", nullptr);
+        const int64_t *indices = vsapi->mapGetIntArray(in, "indices", nullptr);
+
+        if (starts[0] != 0)
+            throw WobblyException("The first start must be 0.");
+
+        d->clip_indices.resize(vi.numFrames);
+
+        for (int i = 0; i < num_starts; i++) {
+            int64_t end = i == num_starts - 1 ? vi.numFrames : starts[i + 1];
+
+            if (end <= starts[i] || end > vi.numFrames)
+                throw WobblyException("The starts must be increasing and smaller than the number of frames.");
+
+            if (indices[i] < 0 || indices[i] >= num_clips)
+                throw WobblyException("Clip index " + std::to_string(indices[i]) + " is out of range.");
+
+            std::fill(d->clip_indices.begin() + starts[i], d->clip_indices.begin() + end, (int)indices[i]);
+        }
+    } catch (WobblyException &e) {
+        vsapi->mapSetError(out, (std::string("Route: ") + e.what()).c_str());
+        for (size_t i = 0; i < d->nodes.size(); i++)
+            vsapi->freeNode(d->nodes[i]);
+        return;
+    }
+
+    std::vector<VSFilterDependency> deps;
+    for (size_t i = 0; i < d->nodes.size(); i++)
+        deps.push_back({ d->nodes[i], rpStrictSpatial });
+
+    vsapi->createVideoFilter(out, "Route", &vi, routeGetFrame, routeFree, fmParallel, deps.data(), (int)deps.size(), d.get(), core);
+
+    d.release();
+}
+
+
+struct SceneChangesData {
+    VSNode *node;
+    VSVideoInfo vi;
+    double threshold;
+};
+
+
+static const int scene_change_block_size = 8;
+static const int scene_change_histogram_bins = 32;
+
+
+// Averages of the luma in blocks of 8x8 pixels, scaled to 8 bits.
+// The partial blocks at the right and bottom edges are left out.
+// The rows are summed a whole line at a time, which the compiler can vectorise.
+template <typename T>
+static void downscaleLuma(const uint8_t *srcp, ptrdiff_t stride, int blocks_x, int blocks_y, int bits, uint8_t *dstp) {
+    const int size = scene_change_block_size;
+    const int width = blocks_x * size;
+    const int shift = 6 + bits - 8;
+
+    std::vector<uint32_t> column_sums(width);
+    uint32_t *sums = column_sums.data();
+
+    for (int by = 0; by < blocks_y; by++) {
+        std::fill(column_sums.begin(), column_sums.end(), 0);
+
+        for (int y = 0; y < size; y++) {
+            const T *row = (const T *)(srcp + (by * size + y) * stride);
+
+            for (int x = 0; x < width; x++)
+                sums[x] += row[x];
+        }
+
+        for (int bx = 0; bx < blocks_x; bx++) {
+            uint32_t sum = 0;
+            for (int x = 0; x < size; x++)
+                sum += sums[bx * size + x];
+
+            dstp[by * blocks_x + bx] = (uint8_t)(sum >> shift);
+        }
+    }
+}
+
+
+#ifdef WOBBLY_SSE2
+// psadbw against zero sums 8 pixels into each half of the register, which is one row of two blocks.
+template <>
+void downscaleLuma<uint8_t>(const uint8_t *srcp, ptrdiff_t stride, int blocks_x, int blocks_y, int bits, uint8_t *dstp) {
+    (void)bits;
+
+    const int size = scene_change_block_size;
+    const __m128i zero = _mm_setzero_si128();
+
+    for (int by = 0; by < blocks_y; by++) {
+        const uint8_t *block_row = srcp + by * size * stride;
+        uint8_t *dst_row = dstp + by * blocks_x;
+
+        int bx = 0;
+
+        for (; bx + 2 <= blocks_x; bx += 2) {
+            __m128i sums = zero;
+            for (int y = 0; y < size; y++)
+                sums = _mm_add_epi64(sums, _mm_sad_epu8(_mm_loadu_si128((const __m128i *)(block_row + y * stride + bx * size)), zero));
+
+            dst_row[bx] = (uint8_t)(_mm_cvtsi128_si32(sums) >> 6);
+            dst_row[bx + 1] = (uint8_t)(_mm_cvtsi128_si32(_mm_srli_si128(sums, 8)) >> 6);
+        }
+
+        for (; bx < blocks_x; bx++) {
+            uint32_t sum = 0;
+            for (int y = 0; y < size; y++)
+                for (int x = 0; x < size; x++)
+                    sum += block_row[y * stride + bx * size + x];
+
+            dst_row[bx] = (uint8_t)(sum >> 6);
+        }
+    }
+}
+#endif
+
+
+static void getDownscaledLuma(const VSFrame *frame, const VSVideoFormat &format, int blocks_x, int blocks_y, uint8_t *dstp, const VSAPI *vsapi) {
+    const uint8_t *srcp = vsapi->getReadPtr(frame, 0);
+    ptrdiff_t stride = vsapi->getStride(frame, 0);
+
+    if (format.bytesPerSample == 1)
+        downscaleLuma<uint8_t>(srcp, stride, blocks_x, blocks_y, format.bitsPerSample, dstp);
+    else
+        downscaleLuma<uint16_t>(srcp, stride, blocks_x, blocks_y, format.bitsPerSample, dstp);
+}
+
+
+static uint64_t getSumOfAbsoluteDifferences(const uint8_t *a, const uint8_t *b, int size) {
+    uint64_t sad = 0;
+    int i = 0;
+
+#ifdef WOBBLY_SSE2
+    __m128i sums = _mm_setzero_si128();
+    for (; i + 16 <= size; i += 16)
+        sums = _mm_add_epi64(sums, _mm_sad_epu8(_mm_loadu_si128((const __m128i *)(a + i)), _mm_loadu_si128((const __m128i *)(b + i))));
+
+    uint64_t halves[2];
+    _mm_storeu_si128((__m128i *)halves, sums);
+    sad = halves[0] + halves[1];
+#endif
+
+    for (; i < size; i++)
+        sad += (uint64_t)std::abs(a[i] - b[i]);
+
+    return sad;
+}
+
+
+// Between 0 and 1. Cuts change both the picture and its histogram a lot.
+// Motion mostly changes the picture, and fades mostly change the histogram.
+static double getSceneChangeScore(const uint8_t *a, const uint8_t *b, int blocks) {
+    if (!blocks)
+        return 0;
+
+    uint64_t sad = getSumOfAbsoluteDifferences(a, b, blocks);
+
+    int histogram_a[scene_change_histogram_bins] = { 0 };
+    int histogram_b[scene_change_histogram_bins] = { 0 };
+    for (int i = 0; i < blocks; i++) {
+        histogram_a[a[i] * scene_change_histogram_bins / 256]++;
+        histogram_b[b[i] * scene_change_histogram_bins / 256]++;
+    }
+
+    int histogram_difference = 0;
+    for (int i = 0; i < scene_change_histogram_bins; i++)
+        histogram_difference += std::abs(histogram_a[i] - histogram_b[i]);
+
+    double normalised_sad = (double)sad / (255.0 * blocks);
+    double normalised_histogram_difference = histogram_difference / (2.0 * blocks);
+
+    return std::sqrt(normalised_sad * normalised_histogram_difference);
+}
+
+
+// Frame property where the first filter leaves the downscaled luma for the second.
+static const char scene_change_luma_key[] = "WobblySceneChangeLuma";
+
+
+// Downscales each frame once. Its output is cached, so the second filter
+// finds frame n-1's averages already there when it compares it with frame n.
+static const VSFrame *VS_CC sceneChangesLumaGetFrame(int n, int activation_reason, void *instance_data, void **frame_data, VSFrameContext *frame_ctx, VSCore *core, const VSAPI *vsapi) {
+    (void)frame_data;
+
+    const SceneChangesData *d = (const SceneChangesData *)instance_data;
+
+    if (activation_reason == arInitial) {
+        vsapi->requestFrameFilter(n, d->node, frame_ctx);
+    } else if (activation_reason == arAllFramesReady) {
+        const VSFrame *frame = vsapi->getFrameFilter(n, d->node, frame_ctx);
+
+        int blocks_x = vsapi->getFrameWidth(frame, 0) / scene_change_block_size;
+        int blocks_y = vsapi->getFrameHeight(frame, 0) / scene_change_block_size;
+
+        std::vector<uint8_t> luma(blocks_x * blocks_y);
+        getDownscaledLuma(frame, d->vi.format, blocks_x, blocks_y, luma.data(), vsapi);
+
+        VSFrame *dst = vsapi->copyFrame(frame, core);
+        vsapi->freeFrame(frame);
+
+        VSMap *props = vsapi->getFramePropertiesRW(dst);
+        vsapi->mapSetData(props, scene_change_luma_key, (const char *)luma.data(), (int)luma.size(), dtBinary, maReplace);
+
+        return dst;
+    }
+
+    return nullptr;
+}
+
+
+static const VSFrame *VS_CC sceneChangesGetFrame(int n, int activation_reason, void *instance_data, void **frame_data, VSFrameContext *frame_ctx, VSCore *core, const VSAPI *vsapi) {
+    (void)frame_data;
+
+    const SceneChangesData *d = (const SceneChangesData *)instance_data;
+
+    if (activation_reason == arInitial) {
+        if (n > 0)
+            vsapi->requestFrameFilter(n - 1, d->node, frame_ctx);
+        vsapi->requestFrameFilter(n, d->node, frame_ctx);
+    } else if (activation_reason == arAllFramesReady) {
+        const VSFrame *frame = vsapi->getFrameFilter(n, d->node, frame_ctx);
+
+        // Like Scxvid, the first frame always starts a scene.
+        double score = 1;
+
+        if (n > 0) {
+            const VSFrame *previous = vsapi->getFrameFilter(n - 1, d->node, frame_ctx);
+
+            const VSMap *props = vsapi->getFramePropertiesRO(frame);
+            const VSMap *previous_props = vsapi->getFramePropertiesRO(previous);
+
+            const uint8_t *luma = (const uint8_t *)vsapi->mapGetData(props, scene_change_luma_key, 0, nullptr);
+            const uint8_t *previous_luma = (const uint8_t *)vsapi->mapGetData(previous_props, scene_change_luma_key, 0, nullptr);
+            int blocks = vsapi->mapGetDataSize(props, scene_change_luma_key, 0, nullptr);
+
+            score = getSceneChangeScore(previous_luma, luma, blocks);
+
+            vsapi->freeFrame(previous);
+        }
+
+        VSFrame *dst = vsapi->copyFrame(frame, core);
+        vsapi->freeFrame(frame);
+
+        VSMap *props = vsapi->getFramePropertiesRW(dst);
+        vsapi->mapDeleteKey(props, scene_change_luma_key);
+        vsapi->mapSetInt(props, "_SceneChangePrev", score > d->threshold, maReplace);
+        vsapi->mapSetFloat(props, "WobblySceneChangeScore", score, maReplace);
+
+        return dst;
+    }
+
+    return nullptr;
+}
+
+
+static void VS_CC sceneChangesFree(void *instance_data, VSCore *core, const VSAPI *vsapi) {
+    (void)core;
+
+    SceneChangesData *d = (SceneChangesData *)instance_data;
+
+    vsapi->freeNode(d->node);
+
+    delete d;
+}
+
+
+static void VS_CC sceneChangesCreate(const VSMap *in, VSMap *out, void *user_data, VSCore *core, const VSAPI *vsapi) {
+    (void)user_data;
+
+    std::unique_ptr<SceneChangesData> d(new SceneChangesData);
+
+    d->node = vsapi->mapGetNode(in, "clip", 0, nullptr);
+    d->vi = *vsapi->getVideoInfo(d->node);
+
+    int err;
+
+    d->threshold = vsapi->mapGetFloat(in, "threshold", 0, &err);
+    if (err)
+        d->threshold = 0.15;
+
+    try {
+        if (d->vi.format.colorFamily == cfUndefined || !d->vi.width || !d->vi.height)
+            throw WobblyException("The clip must have constant format and dimensions.");
+
+        if (d->vi.format.colorFamily != cfYUV && d->vi.format.colorFamily != cfGray)
+            throw WobblyException("The clip must be YUV or Gray.");
+
+        if (d->vi.format.sampleType != stInteger || d->vi.format.bitsPerSample > 16)
+            throw WobblyException("The clip must have 8 to 16 bits per sample, integer.");
+
+        if (d->threshold < 0 || d->threshold > 1)
+            throw WobblyException("threshold must be between 0 and 1.");
+    } catch (WobblyException &e) {
+        vsapi->mapSetError(out, (std::string("SceneChanges: ") + e.what()).c_str());
+        vsapi->freeNode(d->node);
+        return;
+    }
+
+    // The first filter owns the clip, and the second one owns the first filter.
+    std::unique_ptr<SceneChangesData> luma_d(new SceneChangesData(*d));
+
+    VSFilterDependency luma_deps[] = { { luma_d->node, rpStrictSpatial } };
+
+    d->node = vsapi->createVideoFilter2("SceneChangesLuma", &luma_d->vi, sceneChangesLumaGetFrame, sceneChangesFree, fmParallel, luma_deps, 1, luma_d.get(), core);
+    luma_d.release();
+
+    // Every frame is requested twice, once as frame n and once as frame n-1.
+    vsapi->setCacheMode(d->node, cmForceEnable);
+
+    VSFilterDependency deps[] = { { d->node, rpGeneral } };
+
+    vsapi->createVideoFilter(out, "SceneChanges", &d->vi, sceneChangesGetFrame, sceneChangesFree, fmParallel, deps, 1, d.get(), core);
+
+    d.release();
+}
+
+
+VS_EXTERNAL_API(void) VapourSynthPluginInit2(VSPlugin *plugin, const VSPLUGINAPI *vspapi) {
+    vspapi->configPlugin("com.jaded-encoding-thaumaturgy.wobbly", "wobbly", "Applies Wobbly projects", VS_MAKE_VERSION(8, 0), VAPOURSYNTH_API_VERSION, 0, plugin);
+
+    vspapi->registerFunction("Apply",
+                             "clip:vnode;"
+                             "project:data;"
+                             "match:int:opt;"
+                             "freeze:int:opt;"
+                             "decimate:int:opt;",
+                             "clip:vnode;",
+                             applyCreate, nullptr, plugin);
+
+    vspapi->registerFunction("Route",
+                             "clips:vnode[];"
+                             "starts:int[];"
+                             "indices:int[];",
+                             "clip:vnode;",
+                             routeCreate, nullptr, plugin);
+
+    vspapi->registerFunction("SceneChanges",
+                             "clip:vnode;"
+                             "threshold:float:opt;",
+                             "clip:vnode;",
+                             sceneChangesCreate, nullptr, plugin);
+}
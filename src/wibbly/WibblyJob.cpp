@@ -61,6 +61,8 @@ WibblyJob::WibblyJob()
             }
     }
     , fades_threshold(0.4 / 255)
+    , scene_change_detector(SceneChangeDetectorScxvid)
+    , scene_change_threshold(0.15)
 {
 
 }
@@ -86,6 +88,18 @@ void WibblyJob::setSourceFilter(const std::string &filter) {
 }
 
 
+std::string WibblyJob::getSourceFilterForFile(const std::string &path) {
+    std::string extension = path.substr(path.rfind('.') + 1);
+
+    if (extension == "dgi")
+        return "dgdecodenv.DGSource";
+    else if (extension == "d2v")
+        return "d2v.Source";
+    else
+        return "bs.VideoSource";
+}
+
+
 std::string WibblyJob::getOutputFile() const {
     return output_file;
 }
@@ -157,6 +171,11 @@ void WibblyJob::setDMetrics(bool enabled, int nt) {
 }
 
 
+const VIVTCParameters &WibblyJob::getVFMParameters() const {
+    return vfm;
+}
+
+
 int WibblyJob::getVFMParameterInt(const std::string &name) const {
     return vfm.int_params.at(name);
 }
@@ -187,6 +206,11 @@ void WibblyJob::setVFMParameter(const std::string &name, bool value) {
 }
 
 
+const VIVTCParameters &WibblyJob::getVDecimateParameters() const {
+    return vdecimate;
+}
+
+
 int WibblyJob::getVDecimateParameterInt(const std::string &name) const {
     return vdecimate.int_params.at(name);
 }
@@ -227,6 +251,32 @@ void WibblyJob::setFadesThreshold(double threshold) {
 }
 
 
+int WibblyJob::getSceneChangeDetector() const {
+    return scene_change_detector;
+}
+
+
+void WibblyJob::setSceneChangeDetector(int detector) {
+    if (detector != SceneChangeDetectorScxvid && detector != SceneChangeDetectorWobbly)
+        throw WobblyException("Can't use scene change detector " + std::to_string(detector) + ": no such detector.");
+
+    scene_change_detector = detector;
+}
+
+
+double WibblyJob::getSceneChangeThreshold() const {
+    return scene_change_threshold;
+}
+
+
+void WibblyJob::setSceneChangeThreshold(double threshold) {
+    if (threshold < 0 || threshold > 1)
+        throw WobblyException("Can't use scene change threshold " + std::to_string(threshold) + ": it must be between 0 and 1.");
+
+    scene_change_threshold = threshold;
+}
+
+
 void WibblyJob::headerToScript(std::string &script) const {
     script +=
             "import vapoursynth as vs\n"
@@ -379,7 +429,10 @@ void WibblyJob::decimationToScript(std::string &script) const {
 
 
 void WibblyJob::sceneChangesToScript(std::string &script) const {
-    script += "src = c.scxvid.Scxvid(clip=src, use_slices=True)\n\n";
+    if (scene_change_detector == SceneChangeDetectorWobbly)
+        script += std::format("src = c.wobbly.SceneChanges(clip=src, threshold={})\n\n", scene_change_threshold);
+    else
+        script += "src = c.scxvid.Scxvid(clip=src, use_slices=True)\n\n";
 }
 
 
@@ -388,6 +441,17 @@ void WibblyJob::setOutputToScript(std::string &script) const {
 }
 
 
+std::string WibblyJob::generateSourceScript() const {
+    std::string script;
+
+    headerToScript(script);
+
+    sourceToScript(script);
+
+    return script;
+}
+
+
 std::string WibblyJob::generateFinalScript() const {
     std::string script;
 
@@ -446,3 +510,55 @@ std::string WibblyJob::generateDisplayScript() const {
     return script;
 }
 
+
+
+static void paramsToKey(std::string &key, const VIVTCParameters &params) {
+    // Sorted, so the key doesn't depend on the order of the unordered_maps.
+    std::map<std::string, std::string> sorted;
+
+    for (auto it = params.int_params.cbegin(); it != params.int_params.cend(); it++)
+        sorted[it->first] = std::to_string(it->second);
+    for (auto it = params.double_params.cbegin(); it != params.double_params.cend(); it++)
+        sorted[it->first] = std::format("{}", it->second);
+    for (auto it = params.bool_params.cbegin(); it != params.bool_params.cend(); it++)
+        sorted[it->first] = std::to_string((int)it->second);
+
+    for (auto it = sorted.cbegin(); it != sorted.cend(); it++)
+        key += " " + it->first + "=" + it->second;
+    key += "\n";
+}
+
+
+std::string WibblyJob::getMetricsKey(int step) const {
+    std::string key = std::format("step={}\nsource={}{}\n", step, source_filter, getArgsForSourceFilter());
+
+    if (steps & StepTrim && trims.size()) {
+        key += "trims=";
+        for (auto it = trims.cbegin(); it != trims.cend(); it++)
+            key += std::format(" {},{}", it->second.first, it->second.last);
+        key += "\n";
+    }
+
+    if (steps & StepCrop)
+        key += std::format("crop={},{},{},{}\n", crop.left, crop.top, crop.right, crop.bottom);
+
+    // The later steps look at the field matched clip. The fades step and the
+    // dry run of VDecimate don't modify the frames, so they don't matter here.
+    if (steps & StepFieldMatch || step == StepFieldMatch) {
+        key += "vfm=";
+        paramsToKey(key, vfm);
+
+        if (step == StepFieldMatch && dmetrics.enabled)
+            key += std::format("dmetrics=nt={}\n", dmetrics.nt);
+    }
+
+    if (step == StepDecimation) {
+        key += "vdecimate=";
+        paramsToKey(key, vdecimate);
+    }
+
+    if (step == StepSceneChanges && scene_change_detector == SceneChangeDetectorWobbly)
+        key += std::format("scenechanges=wobbly threshold={}\n", scene_change_threshold);
+
+    return key;
+}
@@ -39,6 +39,12 @@ enum MetricsGatheringSteps {
 };
 
 
+enum SceneChangeDetector {
+    SceneChangeDetectorScxvid = 0,
+    SceneChangeDetectorWobbly       // wobbly.SceneChanges, from the Wobbly plugin.
+};
+
+
 struct VIVTCParameters {
     std::unordered_map<std::string, int> int_params;
     std::unordered_map<std::string, double> double_params;
@@ -67,6 +73,10 @@ class WibblyJob {
 
     double fades_threshold;
 
+    int scene_change_detector;
+
+    double scene_change_threshold;
+
     const char *getArgsForSourceFilter() const;
 
     void headerToScript(std::string &script) const;
@@ -91,6 +101,9 @@ public:
     std::string getSourceFilter() const;
     void setSourceFilter(const std::string &filter);
 
+    // Picks the source filter from the file's extension.
+    static std::string getSourceFilterForFile(const std::string &path);
+
 
     std::string getOutputFile() const;
     void setOutputFile(const std::string &path);
@@ -112,6 +125,7 @@ public:
     void setDMetrics(bool enabled, int nt);
 
 
+    const VIVTCParameters &getVFMParameters() const;
     int getVFMParameterInt(const std::string &name) const;
     double getVFMParameterDouble(const std::string &name) const;
     bool getVFMParameterBool(const std::string &name) const;
@@ -120,6 +134,7 @@ public:
     void setVFMParameter(const std::string &name, bool value);
 
 
+    const VIVTCParameters &getVDecimateParameters() const;
     int getVDecimateParameterInt(const std::string &name) const;
     double getVDecimateParameterDouble(const std::string &name) const;
     bool getVDecimateParameterBool(const std::string &name) const;
@@ -132,8 +147,21 @@ public:
     void setFadesThreshold(double threshold);
 
 
+    int getSceneChangeDetector() const;
+    void setSceneChangeDetector(int detector);
+
+    double getSceneChangeThreshold() const;
+    void setSceneChangeThreshold(double threshold);
+
+
+    // Only opens the source, which makes the source filter index the file.
+    std::string generateSourceScript() const;
     std::string generateFinalScript() const;
     std::string generateDisplayScript() const;
+
+    // Describes everything that affects the metrics gathered by one step,
+    // excluding the input file itself.
+    std::string getMetricsKey(int step) const;
 };
 
 #endif // WIBBLYJOB_H
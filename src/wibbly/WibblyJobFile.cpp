@@ -0,0 +1,441 @@
+/*
+
+Copyright (c) 2015, John Smith
+
+Permission to use, copy, modify, and/or distribute this software for
+any purpose with or without fee is hereby granted, provided that the
+above copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+SOFTWARE.
+
+*/
+
+
+
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#define RAPIDJSON_NAMESPACE rj
+#define RAPIDJSON_HAS_STDSTRING 1
+#include "rapidjson/document.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+#include "rapidjson/error/en.h"
+
+#include "WibblyJobFile.h"
+#include "WobblyException.h"
+
+
+#define JOB_FILE_FORMAT_VERSION 1
+
+
+namespace Keys {
+    const char job_file_format_version[] = "job file format version";
+    const char parameter_sets[] = "parameter sets";
+    const char jobs[] = "jobs";
+
+    const char vfm[] = "vfm";
+    const char vdecimate[] = "vdecimate";
+
+    const char input_file[] = "input file";
+    const char source_filter[] = "source filter";
+    const char output_file[] = "output file";
+    const char steps[] = "steps";
+    const char crop[] = "crop";
+    const char trims[] = "trims";
+    const char parameter_set[] = "parameter set";
+    const char dmetrics[] = "dmetrics";
+    const char fades_threshold[] = "fades threshold";
+    const char scene_change_detector[] = "scene change detector";
+    const char scene_change_threshold[] = "scene change threshold";
+}
+
+
+QString WibblyJobFile::getJobFilePath(const QString &settings_file) {
+    // Next to the settings, so that every portable copy keeps its own queue.
+    return QFileInfo(settings_file).absolutePath() + "/wibbly_jobs.json";
+}
+
+
+template <typename Writer>
+static void writeParameters(Writer &writer, const VIVTCParameters &params) {
+    // Sorted, so that identical parameters are written identically.
+    std::map<std::string, int> int_params(params.int_params.cbegin(), params.int_params.cend());
+    std::map<std::string, double> double_params(params.double_params.cbegin(), params.double_params.cend());
+    std::map<std::string, bool> bool_params(params.bool_params.cbegin(), params.bool_params.cend());
+
+    writer.StartObject();
+
+    for (auto it = int_params.cbegin(); it != int_params.cend(); it++) {
+        writer.Key(it->first);
+        writer.Int(it->second);
+    }
+
+    for (auto it = double_params.cbegin(); it != double_params.cend(); it++) {
+        writer.Key(it->first);
+        writer.Double(it->second);
+    }
+
+    for (auto it = bool_params.cbegin(); it != bool_params.cend(); it++) {
+        writer.Key(it->first);
+        writer.Bool(it->second);
+    }
+
+    writer.EndObject();
+}
+
+
+void WibblyJobFile::writeJobs(const QString &path, const std::vector<WibblyJob> &jobs) {
+    // Every distinct combination of VFM and VDecimate parameters, as JSON.
+    std::vector<std::string> parameter_sets;
+    std::unordered_map<std::string, int> parameter_set_indices;
+    std::vector<int> job_parameter_sets;
+    job_parameter_sets.reserve(jobs.size());
+
+    for (auto job = jobs.cbegin(); job != jobs.cend(); job++) {
+        rj::StringBuffer buffer;
+        rj::Writer<rj::StringBuffer> writer(buffer);
+
+        writer.StartObject();
+        writer.Key(Keys::vfm);
+        writeParameters(writer, job->getVFMParameters());
+        writer.Key(Keys::vdecimate);
+        writeParameters(writer, job->getVDecimateParameters());
+        writer.EndObject();
+
+        std::string parameter_set(buffer.GetString(), buffer.GetSize());
+
+        auto inserted = parameter_set_indices.insert({ parameter_set, (int)parameter_sets.size() });
+        if (inserted.second)
+            parameter_sets.push_back(parameter_set);
+
+        job_parameter_sets.push_back(inserted.first->second);
+    }
+
+    rj::StringBuffer buffer;
+    rj::Writer<rj::StringBuffer> writer(buffer);
+
+    writer.StartObject();
+
+    writer.Key(Keys::job_file_format_version);
+    writer.Int(JOB_FILE_FORMAT_VERSION);
+
+    writer.Key(Keys::parameter_sets);
+    writer.StartArray();
+    for (size_t i = 0; i < parameter_sets.size(); i++)
+        writer.RawValue(parameter_sets[i].c_str(), parameter_sets[i].size(), rj::kObjectType);
+    writer.EndArray();
+
+    writer.Key(Keys::jobs);
+    writer.StartArray();
+    for (size_t i = 0; i < jobs.size(); i++) {
+        const WibblyJob &job = jobs[i];
+
+        writer.StartObject();
+
+        writer.Key(Keys::input_file);
+        writer.String(job.getInputFile());
+
+        writer.Key(Keys::source_filter);
+        writer.String(job.getSourceFilter());
+
+        writer.Key(Keys::output_file);
+        writer.String(job.getOutputFile());
+
+        writer.Key(Keys::steps);
+        writer.Int(job.getSteps());
+
+        const Crop &crop = job.getCrop();
+        writer.Key(Keys::crop);
+        writer.StartArray();
+        writer.Int(crop.left);
+        writer.Int(crop.top);
+        writer.Int(crop.right);
+        writer.Int(crop.bottom);
+        writer.EndArray();
+
+        const auto &trims = job.getTrims();
+        if (trims.size()) {
+            writer.Key(Keys::trims);
+            writer.StartArray();
+            for (auto it = trims.cbegin(); it != trims.cend(); it++) {
+                writer.Int(it->second.first);
+                writer.Int(it->second.last);
+            }
+            writer.EndArray();
+        }
+
+        writer.Key(Keys::parameter_set);
+        writer.Int(job_parameter_sets[i]);
+
+        writer.Key(Keys::dmetrics);
+        writer.StartArray();
+        writer.Bool(job.getDMetrics().enabled);
+        writer.Int(job.getDMetrics().nt);
+        writer.EndArray();
+
+        writer.Key(Keys::fades_threshold);
+        writer.Double(job.getFadesThreshold());
+
+        writer.Key(Keys::scene_change_detector);
+        writer.Int(job.getSceneChangeDetector());
+
+        writer.Key(Keys::scene_change_threshold);
+        writer.Double(job.getSceneChangeThreshold());
+
+        writer.EndObject();
+    }
+    writer.EndArray();
+
+    writer.EndObject();
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    QSaveFile file(path);
+
+    if (!file.open(QIODevice::WriteOnly))
+        throw WobblyException("Couldn't open job file '" + path.toStdString() + "'. Error message: " + file.errorString().toStdString());
+
+    if (file.write(buffer.GetString(), (qint64)buffer.GetSize()) != (qint64)buffer.GetSize() || !file.commit())
+        throw WobblyException("Couldn't write job file '" + path.toStdString() + "'. Error message: " + file.errorString().toStdString());
+}
+
+
+static void readParameters(const rj::Value &json_params, const std::string &path, VIVTCParameters &params) {
+    if (!json_params.IsObject())
+        throw WobblyException(path + ": the filter parameters must be objects.");
+
+    for (auto it = json_params.MemberBegin(); it != json_params.MemberEnd(); it++) {
+        std::string name = it->name.GetString();
+
+        if (it->value.IsBool())
+            params.bool_params[name] = it->value.GetBool();
+        else if (it->value.IsInt())
+            params.int_params[name] = it->value.GetInt();
+        else if (it->value.IsNumber())
+            params.double_params[name] = it->value.GetDouble();
+        else
+            throw WobblyException(path + ": filter parameter '" + name + "' must be a number or a boolean.");
+    }
+}
+
+
+std::vector<WibblyJob> WibblyJobFile::readJobs(const QString &qpath) {
+    std::string path = qpath.toStdString();
+
+    QFile file(qpath);
+
+    if (!file.open(QIODevice::ReadOnly))
+        throw WobblyException("Couldn't open job file '" + path + "'. Error message: " + file.errorString().toStdString());
+
+    QByteArray file_contents = file.readAll();
+
+    file.close();
+
+    rj::Document json_file;
+    json_file.ParseInsitu(file_contents.data());
+
+    if (json_file.HasParseError())
+        throw WobblyException("Failed to parse job file '" + path + "' at byte " + std::to_string(json_file.GetErrorOffset()) + ": " + rj::GetParseError_En(json_file.GetParseError()));
+
+    if (!json_file.IsObject())
+        throw WobblyException("File '" + path + "' is not a valid job file: JSON document root is not an object.");
+
+    auto it = json_file.FindMember(Keys::job_file_format_version);
+    if (it == json_file.MemberEnd() || !it->value.IsInt())
+        throw WobblyException(path + ": JSON key '" + Keys::job_file_format_version + "' is missing or not an integer.");
+
+    if (it->value.GetInt() > JOB_FILE_FORMAT_VERSION)
+        throw WobblyException(path + ": the job file's format version is " + std::to_string(it->value.GetInt()) + ", but this software only understands format version " + std::to_string(JOB_FILE_FORMAT_VERSION) + " and older.");
+
+    std::vector<std::pair<VIVTCParameters, VIVTCParameters>> parameter_sets;
+
+    it = json_file.FindMember(Keys::parameter_sets);
+    if (it != json_file.MemberEnd()) {
+        if (!it->value.IsArray())
+            throw WobblyException(path + ": JSON key '" + Keys::parameter_sets + "' must be an array.");
+
+        parameter_sets.resize(it->value.Size());
+
+        for (rj::SizeType i = 0; i < it->value.Size(); i++) {
+            const rj::Value &json_set = it->value[i];
+
+            if (!json_set.IsObject() || !json_set.HasMember(Keys::vfm) || !json_set.HasMember(Keys::vdecimate))
+                throw WobblyException(path + ": parameter set number " + std::to_string(i) + " must be an object with the keys '" + Keys::vfm + "' and '" + Keys::vdecimate + "'.");
+
+            readParameters(json_set[Keys::vfm], path, parameter_sets[i].first);
+            readParameters(json_set[Keys::vdecimate], path, parameter_sets[i].second);
+        }
+    }
+
+    std::vector<WibblyJob> jobs;
+
+    it = json_file.FindMember(Keys::jobs);
+    if (it == json_file.MemberEnd())
+        return jobs;
+
+    if (!it->value.IsArray())
+        throw WobblyException(path + ": JSON key '" + Keys::jobs + "' must be an array.");
+
+    const rj::Value &json_jobs = it->value;
+
+    jobs.resize(json_jobs.Size());
+
+    for (rj::SizeType i = 0; i < json_jobs.Size(); i++) {
+        const rj::Value &json_job = json_jobs[i];
+        WibblyJob &job = jobs[i];
+
+        std::string job_name = path + ": job number " + std::to_string(i + 1);
+
+        if (!json_job.IsObject())
+            throw WobblyException(job_name + " must be an object.");
+
+        auto getString = [&] (const char *key) {
+            auto member = json_job.FindMember(key);
+            if (member == json_job.MemberEnd() || !member->value.IsString())
+                throw WobblyException(job_name + ": JSON key '" + key + "' is missing or not a string.");
+            return std::string(member->value.GetString(), member->value.GetStringLength());
+        };
+
+        auto getValue = [&] (const char *key) -> const rj::Value * {
+            auto member = json_job.FindMember(key);
+            if (member == json_job.MemberEnd())
+                return nullptr;
+            return &member->value;
+        };
+
+        job.setInputFile(getString(Keys::input_file));
+        job.setSourceFilter(getString(Keys::source_filter));
+        job.setOutputFile(getString(Keys::output_file));
+
+        const rj::Value *value = getValue(Keys::steps);
+        if (value) {
+            if (!value->IsInt())
+                throw WobblyException(job_name + ": JSON key '" + Keys::steps + "' must be an integer.");
+            job.setSteps(value->GetInt());
+        }
+
+        value = getValue(Keys::crop);
+        if (value) {
+            if (!value->IsArray() || value->Size() != 4 || !(*value)[0].IsInt() || !(*value)[1].IsInt() || !(*value)[2].IsInt() || !(*value)[3].IsInt())
+                throw WobblyException(job_name + ": JSON key '" + Keys::crop + "' must be an array of four integers.");
+            job.setCrop((*value)[0].GetInt(), (*value)[1].GetInt(), (*value)[2].GetInt(), (*value)[3].GetInt());
+        }
+
+        value = getValue(Keys::trims);
+        if (value) {
+            if (!value->IsArray() || value->Size() % 2)
+                throw WobblyException(job_name + ": JSON key '" + Keys::trims + "' must be an array with an even number of integers.");
+            for (rj::SizeType j = 0; j < value->Size(); j += 2) {
+                if (!(*value)[j].IsInt() || !(*value)[j + 1].IsInt())
+                    throw WobblyException(job_name + ": JSON key '" + Keys::trims + "' must be an array with an even number of integers.");
+                job.addTrim((*value)[j].GetInt(), (*value)[j + 1].GetInt());
+            }
+        }
+
+        value = getValue(Keys::parameter_set);
+        if (value) {
+            if (!value->IsInt() || value->GetInt() < 0 || value->GetInt() >= (int)parameter_sets.size())
+                throw WobblyException(job_name + ": JSON key '" + Keys::parameter_set + "' must be the index of a parameter set.");
+
+            const auto &parameter_set = parameter_sets[value->GetInt()];
+
+            for (auto param = parameter_set.first.int_params.cbegin(); param != parameter_set.first.int_params.cend(); param++)
+                job.setVFMParameter(param->first, param->second);
+            for (auto param = parameter_set.first.double_params.cbegin(); param != parameter_set.first.double_params.cend(); param++)
+                job.setVFMParameter(param->first, param->second);
+            for (auto param = parameter_set.first.bool_params.cbegin(); param != parameter_set.first.bool_params.cend(); param++)
+                job.setVFMParameter(param->first, param->second);
+
+            for (auto param = parameter_set.second.int_params.cbegin(); param != parameter_set.second.int_params.cend(); param++)
+                job.setVDecimateParameter(param->first, param->second);
+            for (auto param = parameter_set.second.double_params.cbegin(); param != parameter_set.second.double_params.cend(); param++)
+                job.setVDecimateParameter(param->first, param->second);
+            for (auto param = parameter_set.second.bool_params.cbegin(); param != parameter_set.second.bool_params.cend(); param++)
+                job.setVDecimateParameter(param->first, param->second);
+        }
+
+        value = getValue(Keys::dmetrics);
+        if (value) {
+            if (!value->IsArray() || value->Size() != 2 || !(*value)[0].IsBool() || !(*value)[1].IsInt())
+                throw WobblyException(job_name + ": JSON key '" + Keys::dmetrics + "' must be an array of a boolean and an integer.");
+            job.setDMetrics((*value)[0].GetBool(), (*value)[1].GetInt());
+        }
+
+        value = getValue(Keys::fades_threshold);
+        if (value) {
+            if (!value->IsNumber())
+                throw WobblyException(job_name + ": JSON key '" + Keys::fades_threshold + "' must be a number.");
+            job.setFadesThreshold(value->GetDouble());
+        }
+
+        value = getValue(Keys::scene_change_detector);
+        if (value) {
+            if (!value->IsInt())
+                throw WobblyException(job_name + ": JSON key '" + Keys::scene_change_detector + "' must be an integer.");
+            job.setSceneChangeDetector(value->GetInt());
+        }
+
+        value = getValue(Keys::scene_change_threshold);
+        if (value) {
+            if (!value->IsNumber())
+                throw WobblyException(job_name + ": JSON key '" + Keys::scene_change_threshold + "' must be a number.");
+            job.setSceneChangeThreshold(value->GetDouble());
+        }
+    }
+
+    return jobs;
+}
+
+
+bool WibblyJobFile::isVideoFile(const QString &path) {
+    static const QStringList extensions = {
+        "avi", "d2v", "dgi", "flv", "m2t", "m2ts", "m2v", "m4v", "mkv", "mov", "mp4",
+        "mpeg", "mpg", "mts", "ogv", "ts", "vob", "webm", "wmv", "y4m"
+    };
+
+    return extensions.contains(QFileInfo(path).suffix(), Qt::CaseInsensitive);
+}
+
+
+std::vector<WibblyJob> WibblyJobFile::createJobsFromDirectory(const WibblyJob &job_template, const QString &directory, bool recursive) {
+    QStringList paths;
+
+    QDirIterator it(directory, QDir::Files | QDir::Readable, recursive ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags);
+    while (it.hasNext()) {
+        QString path = it.next();
+
+        if (isVideoFile(path))
+            paths.push_back(path);
+    }
+
+    paths.sort();
+
+    WibblyJob base = job_template;
+    while (base.getTrims().size())
+        base.deleteTrim(base.getTrims().cbegin()->first);
+
+    std::vector<WibblyJob> jobs(paths.size(), base);
+
+    for (int i = 0; i < paths.size(); i++) {
+        jobs[i].setInputFile(paths[i].toStdString());
+        jobs[i].setSourceFilter(WibblyJob::getSourceFilterForFile(paths[i].toStdString()));
+        jobs[i].setOutputFile(QStringLiteral("%1.wob").arg(paths[i]).toStdString());
+    }
+
+    return jobs;
+}
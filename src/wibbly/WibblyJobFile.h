@@ -0,0 +1,53 @@
+/*
+
+Copyright (c) 2015, John Smith
+
+Permission to use, copy, modify, and/or distribute this software for
+any purpose with or without fee is hereby granted, provided that the
+above copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+SOFTWARE.
+
+*/
+
+
+
+#ifndef WIBBLYJOBFILE_H
+#define WIBBLYJOBFILE_H
+
+#include <string>
+#include <vector>
+
+#include <QString>
+
+#include "WibblyJob.h"
+
+
+// The job queue, kept in a single JSON file that is read and written in one go.
+// Jobs with the same VFM and VDecimate parameters share one copy of them,
+// so a long queue of similar jobs stays small.
+class WibblyJobFile {
+public:
+    static QString getJobFilePath(const QString &settings_file);
+
+    static std::vector<WibblyJob> readJobs(const QString &path);
+
+    // The file is replaced only once it's completely written.
+    static void writeJobs(const QString &path, const std::vector<WibblyJob> &jobs);
+
+    static bool isVideoFile(const QString &path);
+
+    // Creates a job for every video in the directory, sorted by path, with the
+    // template's settings. The template's trims are left out, because they only
+    // make sense for its own video.
+    static std::vector<WibblyJob> createJobsFromDirectory(const WibblyJob &job_template, const QString &directory, bool recursive);
+};
+
+#endif // WIBBLYJOBFILE_H
@@ -0,0 +1,273 @@
+/*
+
+Copyright (c) 2015, John Smith
+
+Permission to use, copy, modify, and/or distribute this software for
+any purpose with or without fee is hereby granted, provided that the
+above copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+SOFTWARE.
+
+*/
+
+
+#include <cstring>
+#include <type_traits>
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include "WibblyMetricsCache.h"
+#include "WobblyException.h"
+
+
+static const char cache_magic[8] = { 'W', 'I', 'B', 'M', 'T', 'R', 'C', '\0' };
+static const uint32_t cache_version = 1;
+
+
+struct CacheFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    int32_t num_frames;
+};
+
+
+WibblyMetricsCache::WibblyMetricsCache(const WibblyJob &job, bool use_disk)
+    : steps(job.getSteps() & (StepFieldMatch | StepInterlacedFades | StepDecimation | StepSceneChanges))
+{
+    QFileInfo info(QString::fromStdString(job.getInputFile()));
+
+    // Without a file to look at there is nothing to tell whether it changed.
+    if (use_disk && info.isFile())
+        fingerprint = QStringLiteral("%1\n%2\n%3\n")
+                .arg(info.absoluteFilePath())
+                .arg(info.size())
+                .arg(info.lastModified().toMSecsSinceEpoch())
+                .toStdString();
+
+    int step_list[] = { StepFieldMatch, StepInterlacedFades, StepDecimation, StepSceneChanges };
+
+    for (int step : step_list) {
+        if (!(steps & step))
+            continue;
+
+        std::string key = fingerprint + job.getMetricsKey(step);
+        key = QCryptographicHash::hash(QByteArray::fromStdString(key), QCryptographicHash::Sha1).toHex().toStdString();
+
+        if (step == StepFieldMatch) {
+            field_match.key = key;
+            loadColumn(field_match);
+        } else if (step == StepInterlacedFades) {
+            interlaced_fades.key = key;
+            loadColumn(interlaced_fades);
+        } else if (step == StepDecimation) {
+            decimation.key = key;
+            loadColumn(decimation);
+        } else if (step == StepSceneChanges) {
+            scene_changes.key = key;
+            loadColumn(scene_changes);
+        }
+    }
+}
+
+
+template <typename T>
+void WibblyMetricsCache::loadColumn(MetricsColumn<T> &column) {
+    static_assert(std::is_trivially_copyable_v<T>);
+
+    if (fingerprint.empty())
+        return;
+
+    QFile file(getCacheDirectory() + "/" + QString::fromStdString(column.key));
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+
+    // A broken or outdated file is simply ignored. It will be overwritten later.
+    CacheFileHeader header;
+    if (file.read((char *)&header, sizeof(header)) != sizeof(header) ||
+        memcmp(header.magic, cache_magic, sizeof(cache_magic)) ||
+        header.version != cache_version ||
+        header.record_size != sizeof(T) ||
+        header.num_frames <= 0 ||
+        (num_frames && header.num_frames != num_frames))
+        return;
+
+    MetricsColumn<T> loaded;
+    loaded.resize(header.num_frames);
+
+    qint64 values_size = (qint64)sizeof(T) * header.num_frames;
+    if (file.read((char *)loaded.values.data(), values_size) != values_size ||
+        file.read((char *)loaded.valid.data(), header.num_frames) != header.num_frames)
+        return;
+
+    column.values = std::move(loaded.values);
+    column.valid = std::move(loaded.valid);
+    column.modified = false;
+
+    num_frames = header.num_frames;
+}
+
+
+template <typename T>
+void WibblyMetricsCache::saveColumn(const MetricsColumn<T> &column) const {
+    if (!column.modified || column.values.empty())
+        return;
+
+    QString path = getCacheDirectory() + "/" + QString::fromStdString(column.key);
+
+    if (!QDir().mkpath(getCacheDirectory()))
+        throw WobblyException("Can't save metrics cache file '" + path.toStdString() + "': failed to create the directory.");
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+        throw WobblyException("Can't save metrics cache file '" + path.toStdString() + "': " + file.errorString().toStdString());
+
+    CacheFileHeader header = {};
+    memcpy(header.magic, cache_magic, sizeof(cache_magic));
+    header.version = cache_version;
+    header.record_size = sizeof(T);
+    header.num_frames = (int32_t)column.values.size();
+
+    file.write((const char *)&header, sizeof(header));
+    file.write((const char *)column.values.data(), (qint64)sizeof(T) * column.values.size());
+    file.write((const char *)column.valid.data(), column.valid.size());
+
+    if (!file.commit())
+        throw WobblyException("Can't save metrics cache file '" + path.toStdString() + "': " + file.errorString().toStdString());
+}
+
+
+int WibblyMetricsCache::getNumFrames() const {
+    return num_frames;
+}
+
+
+void WibblyMetricsCache::setNumFrames(int frames) {
+    num_frames = frames;
+
+    // Columns that weren't in the cache start out empty. Columns with
+    // a different number of frames were made for a different video.
+    if (steps & StepFieldMatch && (int)field_match.values.size() != frames)
+        field_match.resize(frames);
+    if (steps & StepInterlacedFades && (int)interlaced_fades.values.size() != frames)
+        interlaced_fades.resize(frames);
+    if (steps & StepDecimation && (int)decimation.values.size() != frames)
+        decimation.resize(frames);
+    if (steps & StepSceneChanges && (int)scene_changes.values.size() != frames)
+        scene_changes.resize(frames);
+}
+
+
+int WibblyMetricsCache::getCompleteSteps() const {
+    int complete = StepNone;
+
+    if (field_match.isComplete())
+        complete |= StepFieldMatch;
+    if (interlaced_fades.isComplete())
+        complete |= StepInterlacedFades;
+    if (decimation.isComplete())
+        complete |= StepDecimation;
+    if (scene_changes.isComplete())
+        complete |= StepSceneChanges;
+
+    return complete;
+}
+
+
+bool WibblyMetricsCache::isFrameComplete(int frame, int wanted_steps) const {
+    if (wanted_steps & StepFieldMatch && !field_match.valid[frame])
+        return false;
+    if (wanted_steps & StepInterlacedFades && !interlaced_fades.valid[frame])
+        return false;
+    if (wanted_steps & StepDecimation && !decimation.valid[frame])
+        return false;
+    if (wanted_steps & StepSceneChanges && !scene_changes.valid[frame])
+        return false;
+
+    return true;
+}
+
+
+void WibblyMetricsCache::applyToProject(WobblyProject *project, double fades_threshold) const {
+    const char match_chars[] = { 'p', 'c', 'n', 'b', 'u' };
+
+    for (int n = 0; n < num_frames; n++) {
+        if (steps & StepFieldMatch && field_match.valid[n]) {
+            const FieldMatchMetrics &m = field_match.values[n];
+
+            if (m.match >= 0)
+                project->setOriginalMatch(n, match_chars[(int)m.match]);
+
+            if (m.combed)
+                project->addCombedFrame(n);
+
+            if (m.has_mics)
+                project->setMics(n, m.mics[0], m.mics[1], m.mics[2], m.mics[3], m.mics[4]);
+
+            if (m.has_dmetrics)
+                project->setDMetrics(n, m.mmetrics[0], m.mmetrics[1], m.vmetrics[0], m.vmetrics[1]);
+        }
+
+        if (steps & StepSceneChanges && scene_changes.valid[n] && scene_changes.values[n].scene_change)
+            project->addSection(n);
+
+        if (steps & StepDecimation && decimation.valid[n]) {
+            const DecimationMetrics &m = decimation.values[n];
+
+            if (m.has_max_block_diff)
+                project->setDecimateMetric(n, m.max_block_diff);
+
+            if (m.drop) {
+                project->addOriginalDecimatedFrame(n);
+                project->addDecimatedFrame(n);
+            }
+        }
+
+        if (steps & StepInterlacedFades && interlaced_fades.valid[n]) {
+            double field_difference = interlaced_fades.values[n].field_difference;
+            if (field_difference > fades_threshold)
+                project->addInterlacedFade(n, field_difference);
+        }
+    }
+}
+
+
+void WibblyMetricsCache::save() const {
+    if (fingerprint.empty())
+        return;
+
+    if (steps & StepFieldMatch)
+        saveColumn(field_match);
+    if (steps & StepInterlacedFades)
+        saveColumn(interlaced_fades);
+    if (steps & StepDecimation)
+        saveColumn(decimation);
+    if (steps & StepSceneChanges)
+        saveColumn(scene_changes);
+}
+
+
+QString WibblyMetricsCache::getCacheDirectory() {
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/metrics";
+}
+
+
+void WibblyMetricsCache::clear() {
+    QDir dir(getCacheDirectory());
+
+    if (dir.exists() && !dir.removeRecursively())
+        throw WobblyException("Can't clear the metrics cache: failed to remove '" + dir.absolutePath().toStdString() + "'.");
+}
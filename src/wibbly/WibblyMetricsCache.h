@@ -0,0 +1,134 @@
+/*
+
+Copyright (c) 2015, John Smith
+
+Permission to use, copy, modify, and/or distribute this software for
+any purpose with or without fee is hereby granted, provided that the
+above copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+SOFTWARE.
+
+*/
+
+
+#ifndef WIBBLYMETRICSCACHE_H
+#define WIBBLYMETRICSCACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <QString>
+
+#include "WibblyJob.h"
+#include "WobblyProject.h"
+
+
+// The records are written to disk as they are, so they must stay trivially copyable.
+// Bump the cache version when changing any of them.
+
+struct FieldMatchMetrics {
+    int8_t match;           // -1 if VFM didn't return one
+    uint8_t combed;
+    uint8_t has_mics;
+    uint8_t has_dmetrics;
+    int16_t mics[5];
+    int32_t mmetrics[2];
+    int32_t vmetrics[2];
+};
+
+
+struct InterlacedFadesMetrics {
+    double field_difference;
+};
+
+
+struct DecimationMetrics {
+    uint8_t drop;
+    uint8_t has_max_block_diff;
+    int32_t max_block_diff;
+};
+
+
+struct SceneChangeMetrics {
+    uint8_t scene_change;
+};
+
+
+// The metrics of one step, for every frame, with a flag telling which frames are known.
+template <typename T>
+struct MetricsColumn {
+    std::string key;
+    std::vector<T> values;
+    std::vector<uint8_t> valid;
+    bool modified = false;
+
+    void resize(int num_frames) {
+        values.assign(num_frames, T{});
+        valid.assign(num_frames, 0);
+    }
+
+    bool isComplete() const {
+        for (size_t i = 0; i < valid.size(); i++)
+            if (!valid[i])
+                return false;
+
+        return valid.size() > 0;
+    }
+
+    void set(int frame, const T &value) {
+        values[frame] = value;
+        valid[frame] = 1;
+        modified = true;
+    }
+};
+
+
+class WibblyMetricsCache {
+    std::string fingerprint;
+
+    int steps = StepNone;
+
+    int num_frames = 0;
+
+    template <typename T>
+    void loadColumn(MetricsColumn<T> &column);
+
+    template <typename T>
+    void saveColumn(const MetricsColumn<T> &column) const;
+
+public:
+    MetricsColumn<FieldMatchMetrics> field_match;
+    MetricsColumn<InterlacedFadesMetrics> interlaced_fades;
+    MetricsColumn<DecimationMetrics> decimation;
+    MetricsColumn<SceneChangeMetrics> scene_changes;
+
+    // Only the steps in job's metrics gathering steps are considered.
+    // With use_disk == false nothing is read or written.
+    WibblyMetricsCache(const WibblyJob &job, bool use_disk);
+
+    // Reading happens in two stages, because the number of frames isn't known until the
+    // script was evaluated, and what the script contains depends on what's in the cache.
+    int getNumFrames() const;
+    void setNumFrames(int frames);
+
+    // Returns the steps whose metrics are known for every frame.
+    int getCompleteSteps() const;
+    bool isFrameComplete(int frame, int wanted_steps) const;
+
+    void applyToProject(WobblyProject *project, double fades_threshold) const;
+
+    void save() const;
+
+    static QString getCacheDirectory();
+    static void clear();
+};
+
+#endif // WIBBLYMETRICSCACHE_H
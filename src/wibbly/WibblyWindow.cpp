@@ -19,6 +19,7 @@ SOFTWARE.
 */
 
 
+#include <algorithm>
 #include <condition_variable>
 #include <mutex>
 
@@ -26,6 +27,7 @@ SOFTWARE.
 #include <QButtonGroup>
 #include <QFile>
 #include <QFileDialog>
+#include <QFileInfo>
 #include <QLabel>
 #include <QMenuBar>
 #include <QMessageBox>
@@ -41,6 +43,7 @@ SOFTWARE.
 #include <QVBoxLayout>
 
 #include "ScrollArea.h"
+#include "WibblyJobFile.h"
 #include "WibblyWindow.h"
 #include "WobblyException.h"
 #include "WobblyShared.h"
@@ -55,8 +58,15 @@ SOFTWARE.
 #define KEY_LAST_CROP                       QStringLiteral("user_interface/last_crop")
 
 #define KEY_COMPACT_PROJECT_FILES           QStringLiteral("projects/compact_project_files")
+#define KEY_COMPRESS_PROJECT_FILES          QStringLiteral("projects/compress_project_files")
 #define KEY_USE_RELATIVE_PATHS              QStringLiteral("projects/use_relative_paths")
 
+#define KEY_CONCURRENT_JOBS                 QStringLiteral("processing/concurrent_jobs")
+#define KEY_THREADS_PER_JOB                 QStringLiteral("processing/threads_per_job")
+#define KEY_USE_METRICS_CACHE               QStringLiteral("processing/use_metrics_cache")
+#define KEY_PREPARED_SOURCES                QStringLiteral("processing/prepared_sources")
+
+// Only read, to bring the jobs over from older versions. The jobs are kept in the job file now.
 #define KEY_JOBS                            QStringLiteral("jobs")
 #define KEY_COUNT                           QStringLiteral("jobs/count")
 #define KEY_JOB                             QStringLiteral("jobs/job%1")
@@ -69,6 +79,8 @@ SOFTWARE.
 #define KEY_VFM                             QStringLiteral("vfm/")
 #define KEY_VDECIMATE                       QStringLiteral("vdecimate/")
 #define KEY_FADES_THRESHOLD                 QStringLiteral("fades_threshold")
+#define KEY_SCENE_CHANGE_DETECTOR           QStringLiteral("scene_changes/detector")
+#define KEY_SCENE_CHANGE_THRESHOLD          QStringLiteral("scene_changes/threshold")
 
 #define KEY_DMETRICS_ENABLED                QStringLiteral("dmetrics/enabled")
 #define KEY_DMETRICS_NT                     QStringLiteral("dmetrics/nt")
@@ -80,7 +92,6 @@ static std::condition_variable requests_condition;
 
 WibblyWindow::WibblyWindow()
     : QMainWindow()
-    , request_count(0)
 #ifdef _WIN32
     , settings(QApplication::applicationDirPath() + "/wibbly.ini", QSettings::IniFormat)
 #endif
@@ -189,6 +200,14 @@ void WibblyWindow::closeEvent(QCloseEvent *event) {
 
     writeSettings();
 
+    // Nothing may still be using VapourSynth or the jobs once the window is gone.
+    abortJobs();
+
+    for (size_t i = 0; i < writers.size(); i++)
+        writers[i]->writer_thread.join();
+
+    writers.clear();
+
     cleanUpVapourSynth();
 
     event->accept();
@@ -213,8 +232,12 @@ void WibblyWindow::dropEvent(QDropEvent *event) {
 
     paths.sort();
 
-    for (int i = 0; i < paths.size(); i++)
-        realOpenVideo(paths[i]);
+    for (int i = 0; i < paths.size(); i++) {
+        if (QFileInfo(paths[i]).isDir())
+            enqueueDirectory(paths[i]);
+        else
+            realOpenVideo(paths[i]);
+    }
 
     event->acceptProposedAction();
 }
@@ -232,6 +255,7 @@ void WibblyWindow::createUI() {
     createVDecimateWindow();
     createTrimWindow();
     createInterlacedFadesWindow();
+    createSceneChangesWindow();
     createSettingsWindow();
 }
 
@@ -333,6 +357,8 @@ void WibblyWindow::createMainWindow() {
     QPushButton *main_autonumber_button = new QPushButton("Autonumber");
 
     QPushButton *main_add_jobs_button = new QPushButton("Add jobs");
+    QPushButton *main_add_directory_button = new QPushButton("Add folder");
+    main_add_directory_button->setToolTip(QStringLiteral("Add a job for every video in a folder and its subfolders,\nwith the settings of the current job."));
     QPushButton *main_remove_jobs_button = new QPushButton("Remove jobs");
     QPushButton *main_copy_jobs_button = new QPushButton("Copy jobs");
     QPushButton *main_move_jobs_up_button = new QPushButton("Move up");
@@ -394,6 +420,14 @@ void WibblyWindow::createMainWindow() {
             fades_threshold_spin->setValue(job.getFadesThreshold());
         }
 
+        {
+            QSignalBlocker block1(scene_changes_detector_combo);
+            QSignalBlocker block2(scene_changes_threshold_spin);
+            scene_changes_detector_combo->setCurrentIndex(scene_changes_detector_combo->findData(job.getSceneChangeDetector()));
+            scene_changes_threshold_spin->setValue(job.getSceneChangeThreshold());
+            scene_changes_threshold_spin->setEnabled(job.getSceneChangeDetector() == SceneChangeDetectorWobbly);
+        }
+
         for (size_t i = 0; i < vfm_params.size(); i++) {
             if (vfm_params[i].type == VIVTCParamInt) {
                 QSpinBox *spin = reinterpret_cast<QSpinBox *>(vfm_params[i].widget);
@@ -478,6 +512,16 @@ void WibblyWindow::createMainWindow() {
         }
     });
 
+    connect(main_add_directory_button, &QPushButton::clicked, [this] () {
+        QString path = QFileDialog::getExistingDirectory(this, QStringLiteral("Open folder"), settings.value(KEY_LAST_DIR).toString());
+
+        if (!path.isNull()) {
+            settings.setValue(KEY_LAST_DIR, path);
+
+            enqueueDirectory(path);
+        }
+    });
+
     connect(main_remove_jobs_button, &QPushButton::clicked, [this] () {
         auto selection = main_jobs_list->selectedItems();
 
@@ -582,8 +626,15 @@ void WibblyWindow::createMainWindow() {
                 file.close();
             }
 
+            // Evaluating the scripts here would open and index every source up front,
+            // on the GUI thread. The jobs evaluate them later, from the prepared sources.
+            QString input_path = QString::fromStdString(job->getInputFile());
+            QFileInfo input_info(input_path);
+            if (!input_info.isFile() || !input_info.isReadable())
+                errors += QStringLiteral("The input file for job number %1 (%2) doesn't exist or can't be read.\n\n").arg(index).arg(input_path);
+
             try {
-                evaluateFinalScript(index - 1);
+                job->generateFinalScript();
             } catch (WobblyException &e) {
                 errors += e.what();
                 errors += "\n\n";
@@ -608,23 +659,33 @@ void WibblyWindow::createMainWindow() {
             return;
         }
 
+        next_job = 0;
+        next_prepared_job = 0;
+        jobs_finished = 0;
+        jobs_aborted = false;
+        total_frames_done = 0;
+
+        main_progress_dialog->setLabelText(QString());
+        main_progress_dialog->setMinimum(0);
+        main_progress_dialog->setMaximum((int)jobs.size() * 1000);
+        main_progress_dialog->setValue(0);
+
+        elapsed_timer.start();
+        progress_timer->start();
+
         startNextJob();
     });
 
     connect(main_progress_dialog, &ProgressDialog::canceled, [this] () {
-        aborted = true;
-
-        delete current_project;
-        current_project = nullptr;
+        abortJobs();
 
-        current_job = -1;
+        startNextJob();
+    });
 
-        int current_row = main_jobs_list->currentRow();
-        main_jobs_list->setCurrentRow(-1, QItemSelectionModel::NoUpdate);
-        main_jobs_list->setCurrentRow(current_row, QItemSelectionModel::NoUpdate);
+    progress_timer = new QTimer(this);
+    progress_timer->setInterval(1000);
 
-        setEnabled(true);
-    });
+    connect(progress_timer, &QTimer::timeout, this, &WibblyWindow::updateJobProgress);
 
     connect(main_progress_dialog, &ProgressDialog::minimiseChanged, [this] (bool minimised) {
         if (minimised)
@@ -648,6 +709,7 @@ void WibblyWindow::createMainWindow() {
 
     QVBoxLayout *vbox2 = new QVBoxLayout;
     vbox2->addWidget(main_add_jobs_button);
+    vbox2->addWidget(main_add_directory_button);
     vbox2->addWidget(main_remove_jobs_button);
     vbox2->addWidget(main_copy_jobs_button);
     vbox2->addWidget(main_move_jobs_up_button);
@@ -1069,6 +1131,74 @@ void WibblyWindow::createInterlacedFadesWindow() {
 }
 
 
+void WibblyWindow::createSceneChangesWindow() {
+    scene_changes_detector_combo = new QComboBox;
+    scene_changes_detector_combo->addItem(QStringLiteral("Scxvid"), SceneChangeDetectorScxvid);
+    scene_changes_detector_combo->addItem(QStringLiteral("Wobbly plugin"), SceneChangeDetectorWobbly);
+    scene_changes_detector_combo->setToolTip(QStringLiteral("Scxvid runs Xvid's motion estimation on every frame.\nThe Wobbly plugin compares the brightness of each frame with the previous one,\nwhich is much faster and doesn't need to see the frames in order."));
+
+    scene_changes_threshold_spin = new QDoubleSpinBox;
+    scene_changes_threshold_spin->setPrefix(QStringLiteral("Threshold: "));
+    scene_changes_threshold_spin->setMaximum(1);
+    scene_changes_threshold_spin->setDecimals(3);
+    scene_changes_threshold_spin->setSingleStep(0.01);
+    scene_changes_threshold_spin->setValue(0.15);
+    scene_changes_threshold_spin->setEnabled(false);
+    scene_changes_threshold_spin->setToolTip(QStringLiteral("Only used by the Wobbly plugin. Lower values find more scene changes."));
+
+
+    connect(scene_changes_detector_combo, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), [this] (int index) {
+        int detector = scene_changes_detector_combo->itemData(index).toInt();
+
+        scene_changes_threshold_spin->setEnabled(detector == SceneChangeDetectorWobbly);
+
+        auto selection = main_jobs_list->selectedItems();
+
+        for (int i = 0; i < selection.size(); i++) {
+            int row = main_jobs_list->row(selection[i]);
+
+            jobs[row].setSceneChangeDetector(detector);
+        }
+    });
+
+    connect(scene_changes_threshold_spin, static_cast<void (QDoubleSpinBox::*)(double)>(&QDoubleSpinBox::valueChanged), [this] (double value) {
+        auto selection = main_jobs_list->selectedItems();
+
+        for (int i = 0; i < selection.size(); i++) {
+            int row = main_jobs_list->row(selection[i]);
+
+            jobs[row].setSceneChangeThreshold(value);
+        }
+    });
+
+
+    QHBoxLayout *hbox = new QHBoxLayout;
+    hbox->addWidget(new QLabel(QStringLiteral("Detector:")));
+    hbox->addWidget(scene_changes_detector_combo);
+    hbox->addWidget(scene_changes_threshold_spin);
+    hbox->addStretch(1);
+
+    QVBoxLayout *vbox = new QVBoxLayout;
+    vbox->addLayout(hbox);
+    vbox->addStretch(1);
+
+
+    QWidget *scene_changes_widget = new QWidget;
+    scene_changes_widget->setLayout(vbox);
+
+
+    scene_changes_dock = new DockWidget("Scene changes", this);
+    scene_changes_dock->setObjectName("scene changes window");
+    scene_changes_dock->setVisible(false);
+    scene_changes_dock->setFloating(true);
+    scene_changes_dock->setWidget(scene_changes_widget);
+    addDockWidget(Qt::RightDockWidgetArea, scene_changes_dock);
+    QList<QAction *> actions = menu_menu->actions();
+    menu_menu->insertAction(actions[actions.size() - 2], scene_changes_dock->toggleViewAction());
+    connect(scene_changes_dock, &DockWidget::visibilityChanged, scene_changes_dock, &DockWidget::setEnabled);
+}
+
+
 void WibblyWindow::createSettingsWindow() {
     settings_font_spin = new QSpinBox;
     settings_font_spin->setRange(4, 99);
@@ -1076,6 +1206,9 @@ void WibblyWindow::createSettingsWindow() {
 
     settings_compact_projects_check = new QCheckBox("Create compact project files");
 
+    settings_compress_projects_check = new QCheckBox(QStringLiteral("Compress project files"));
+    settings_compress_projects_check->setToolTip(QStringLiteral("Write the project files with gzip. They take a fraction of the space and\nare opened like any other project, also by the VapourSynth plugin."));
+
     settings_use_relative_paths_check = new QCheckBox(QStringLiteral("Use relative paths in project files"));
 
     settings_cache_spin = new QSpinBox;
@@ -1083,6 +1216,32 @@ void WibblyWindow::createSettingsWindow() {
     settings_cache_spin->setValue(4096);
     settings_cache_spin->setPrefix(QStringLiteral("Maximum cache size: "));
     settings_cache_spin->setSuffix(QStringLiteral(" MiB"));
+    settings_cache_spin->setToolTip(QStringLiteral("When running several jobs at once, this is split evenly between them."));
+
+    settings_concurrent_jobs_spin = new QSpinBox;
+    settings_concurrent_jobs_spin->setRange(1, 64);
+    settings_concurrent_jobs_spin->setValue(1);
+    settings_concurrent_jobs_spin->setPrefix(QStringLiteral("Concurrent jobs: "));
+    settings_concurrent_jobs_spin->setToolTip(QStringLiteral("Number of jobs to process at the same time, each with its own VapourSynth core."));
+
+    settings_threads_per_job_spin = new QSpinBox;
+    settings_threads_per_job_spin->setRange(0, 256);
+    settings_threads_per_job_spin->setValue(0);
+    settings_threads_per_job_spin->setPrefix(QStringLiteral("Threads per job: "));
+    settings_threads_per_job_spin->setSpecialValueText(QStringLiteral("Threads per job: automatic"));
+    settings_threads_per_job_spin->setToolTip(QStringLiteral("Automatic divides the available CPU threads between the concurrent jobs."));
+
+    settings_prepared_sources_spin = new QSpinBox;
+    settings_prepared_sources_spin->setRange(0, 16);
+    settings_prepared_sources_spin->setValue(1);
+    settings_prepared_sources_spin->setPrefix(QStringLiteral("Sources to open ahead: "));
+    settings_prepared_sources_spin->setToolTip(QStringLiteral("Number of upcoming jobs whose source is opened (and indexed) in the background while the current jobs are running."));
+
+    settings_metrics_cache_check = new QCheckBox(QStringLiteral("Cache metrics"));
+    settings_metrics_cache_check->setChecked(true);
+    settings_metrics_cache_check->setToolTip(QStringLiteral("Remember the metrics gathered from each video, so running a job again with the same video and parameters only collects what changed."));
+
+    QPushButton *settings_clear_metrics_cache_button = new QPushButton(QStringLiteral("Clear metrics cache"));
 
 
     connect(settings_font_spin, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), [this] (int value) {
@@ -1097,6 +1256,10 @@ void WibblyWindow::createSettingsWindow() {
         settings.setValue(KEY_COMPACT_PROJECT_FILES, checked);
     });
 
+    connect(settings_compress_projects_check, &QCheckBox::clicked, [this] (bool checked) {
+        settings.setValue(KEY_COMPRESS_PROJECT_FILES, checked);
+    });
+
     connect(settings_use_relative_paths_check, &QCheckBox::clicked, [this] (bool checked) {
         settings.setValue(KEY_USE_RELATIVE_PATHS, checked);
     });
@@ -1105,6 +1268,30 @@ void WibblyWindow::createSettingsWindow() {
         settings.setValue(KEY_MAXIMUM_CACHE_SIZE, value);
     });
 
+    connect(settings_concurrent_jobs_spin, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), [this] (int value) {
+        settings.setValue(KEY_CONCURRENT_JOBS, value);
+    });
+
+    connect(settings_threads_per_job_spin, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), [this] (int value) {
+        settings.setValue(KEY_THREADS_PER_JOB, value);
+    });
+
+    connect(settings_prepared_sources_spin, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), [this] (int value) {
+        settings.setValue(KEY_PREPARED_SOURCES, value);
+    });
+
+    connect(settings_metrics_cache_check, &QCheckBox::clicked, [this] (bool checked) {
+        settings.setValue(KEY_USE_METRICS_CACHE, checked);
+    });
+
+    connect(settings_clear_metrics_cache_button, &QPushButton::clicked, [this] () {
+        try {
+            WibblyMetricsCache::clear();
+        } catch (WobblyException &e) {
+            errorPopup(e.what());
+        }
+    });
+
 
     QVBoxLayout *vbox = new QVBoxLayout;
 
@@ -1115,6 +1302,7 @@ void WibblyWindow::createSettingsWindow() {
 
     hbox = new QHBoxLayout;
     hbox->addWidget(settings_compact_projects_check);
+    hbox->addWidget(settings_compress_projects_check);
     hbox->addStretch(1);
     vbox->addLayout(hbox);
 
@@ -1123,6 +1311,27 @@ void WibblyWindow::createSettingsWindow() {
     hbox->addStretch(1);
     vbox->addLayout(hbox);
 
+    hbox = new QHBoxLayout;
+    hbox->addWidget(settings_concurrent_jobs_spin);
+    hbox->addStretch(1);
+    vbox->addLayout(hbox);
+
+    hbox = new QHBoxLayout;
+    hbox->addWidget(settings_threads_per_job_spin);
+    hbox->addStretch(1);
+    vbox->addLayout(hbox);
+
+    hbox = new QHBoxLayout;
+    hbox->addWidget(settings_prepared_sources_spin);
+    hbox->addStretch(1);
+    vbox->addLayout(hbox);
+
+    hbox = new QHBoxLayout;
+    hbox->addWidget(settings_metrics_cache_check);
+    hbox->addWidget(settings_clear_metrics_cache_button);
+    hbox->addStretch(1);
+    vbox->addLayout(hbox);
+
     vbox->addStretch(1);
 
 
@@ -1143,17 +1352,6 @@ void WibblyWindow::createSettingsWindow() {
 
 
 void WibblyWindow::realOpenVideo(const QString &path) {
-    QString source_filter;
-
-    QString extension = path.mid(path.lastIndexOf('.') + 1);
-
-    if (extension == "dgi")
-        source_filter = "dgdecodenv.DGSource";
-    else if (extension == "d2v")
-        source_filter = "d2v.Source";
-    else
-        source_filter = "bs.VideoSource";
-
     jobs.emplace_back();
 
     WibblyJob &job = jobs.back();
@@ -1161,28 +1359,73 @@ void WibblyWindow::realOpenVideo(const QString &path) {
     job.setCrop(settings_last_crop[0], settings_last_crop[1], settings_last_crop[2], settings_last_crop[3]);
 
     job.setInputFile(path.toStdString());
-    job.setSourceFilter(source_filter.toStdString());
+    job.setSourceFilter(WibblyJob::getSourceFilterForFile(path.toStdString()));
     job.setOutputFile(QStringLiteral("%1.wob").arg(path).toStdString());
 
     main_jobs_list->addItem(path);
 }
 
 
+// Adds the jobs to the end of the list all at once.
+void WibblyWindow::enqueueJobs(std::vector<WibblyJob> &&new_jobs) {
+    QStringList items;
+    items.reserve((int)new_jobs.size());
+
+    for (size_t i = 0; i < new_jobs.size(); i++)
+        items.push_back(QString::fromStdString(new_jobs[i].getInputFile()));
+
+    jobs.insert(jobs.end(), std::make_move_iterator(new_jobs.begin()), std::make_move_iterator(new_jobs.end()));
+
+    main_jobs_list->addItems(items);
+}
+
+
+// The current job is the template for the new ones. Without one, they get the default settings.
+void WibblyWindow::enqueueDirectory(const QString &path) {
+    WibblyJob job_template;
+
+    int current_row = main_jobs_list->currentRow();
+    if (current_row > -1)
+        job_template = jobs[current_row];
+    else
+        job_template.setCrop(settings_last_crop[0], settings_last_crop[1], settings_last_crop[2], settings_last_crop[3]);
+
+    std::vector<WibblyJob> new_jobs = WibblyJobFile::createJobsFromDirectory(job_template, path, true);
+
+    if (new_jobs.empty()) {
+        errorPopup(QStringLiteral("No video files found in '%1'.").arg(path));
+        return;
+    }
+
+    enqueueJobs(std::move(new_jobs));
+}
+
+
 void WibblyWindow::errorPopup(const QString &msg) {
     QMessageBox::information(this, QStringLiteral("Error"), msg);
 }
 
 
-void WibblyWindow::evaluateFinalScript(int job_index) {
-    const WibblyJob &job = jobs[job_index];
+VSNode *WibblyWindow::evaluateFinalScript(int job_index, VSScript *script, int steps) {
+    WibblyJob job = jobs[job_index];
+    job.setSteps(steps);
 
-    std::string script;
+    std::string text;
 
-    script = job.generateFinalScript();
+    text = job.generateFinalScript();
 
-    vssapi->evalSetWorkingDir(vsscript, 1);
-    if (vssapi->evaluateBuffer(vsscript, script.c_str(), job.getInputFile().c_str())) {
-        std::string error = vssapi->getError(vsscript);
+    // Jobs get a fresh script environment, where the source filter's
+    // caching variable doesn't exist yet, unless the source was prepared.
+    VSMap *m = vsapi->createMap();
+    if (vssapi->getVariable(script, "wibbly_last_input_file", m)) {
+        vsapi->mapSetData(m, "wibbly_last_input_file", "", -1, dtUtf8, maReplace);
+        vssapi->setVariables(script, m);
+    }
+    vsapi->freeMap(m);
+
+    vssapi->evalSetWorkingDir(script, 1);
+    if (vssapi->evaluateBuffer(script, text.c_str(), job.getInputFile().c_str())) {
+        std::string error = vssapi->getError(script);
         // The traceback is mostly unnecessary noise.
         size_t traceback = error.find("Traceback");
         if (traceback != std::string::npos)
@@ -1191,15 +1434,11 @@ void WibblyWindow::evaluateFinalScript(int job_index) {
         throw WobblyException("Failed to evaluate final script for job number " + std::to_string(job_index + 1) + ". Error message:\n" + error);
     }
 
-    vsapi->freeNode(vsnode);
-
-    vsnode = vssapi->getOutputNode(vsscript, 0);
-    if (!vsnode)
+    VSNode *node = vssapi->getOutputNode(script, 0);
+    if (!node)
         throw WobblyException("Final script for job number " + std::to_string(job_index + 1) + " evaluated successfully, but no node found at output index 0.");
 
-    vsvi = vsapi->getVideoInfo(vsnode);
-
-    video_frame_label->setPixmap(QPixmap());
+    return node;
 }
 
 
@@ -1247,11 +1486,6 @@ void WibblyWindow::evaluateDisplayScript() {
         throw WobblyException("Failed to evaluate display script. Error message:\n" + error);
     }
 
-    // Wait until all requests are done before freeing the node.
-    std::unique_lock<std::mutex> lock(requests_mutex);
-    while (request_count)
-        requests_condition.wait(lock);
-
     vsapi->freeNode(vsnode);
 
     vsnode = vssapi->getOutputNode(vsscript, 0);
@@ -1337,68 +1571,214 @@ void WibblyWindow::displayFrame(int n) {
 
 
 void VS_CC frameDoneCallback(void *userData, const VSFrame *f, int n, VSNode *, const char *errorMsg) {
-    WibblyWindow *window = (WibblyWindow *)userData;
+    JobRunner *runner = (JobRunner *)userData;
 
     // Qt::DirectConnection = frameDone runs in the worker threads
     // Qt::QueuedConnection = frameDone runs in the GUI thread
-    QMetaObject::invokeMethod(window, "frameDone", Qt::DirectConnection, Q_ARG(void *, (void *)f), Q_ARG(int, n), Q_ARG(QString, QString(errorMsg)));
+    QMetaObject::invokeMethod(runner->window, "frameDone", Qt::DirectConnection, Q_ARG(void *, (void *)runner), Q_ARG(void *, (void *)f), Q_ARG(int, n), Q_ARG(QString, QString(errorMsg)));
+}
+
+
+void WibblyWindow::setJobStatus(int job_index, const QString &status) {
+    QString text = QString::fromStdString(jobs[job_index].getInputFile());
+    if (!status.isEmpty())
+        text += QStringLiteral("  [%1]").arg(status);
+
+    main_jobs_list->item(job_index)->setText(text);
+}
+
+
+int WibblyWindow::getThreadsPerJob() {
+    int threads = settings_threads_per_job_spin->value();
+    if (!threads)
+        threads = std::max(1, QThread::idealThreadCount() / settings_concurrent_jobs_spin->value());
+
+    return threads;
+}
+
+
+int64_t WibblyWindow::getCacheSizePerJob() {
+    return (int64_t)settings_cache_spin->value() * 1024 * 1024 / settings_concurrent_jobs_spin->value();
+}
+
+
+VSScript *WibblyWindow::createJobScript(int job_index, int threads, int64_t cache_size) {
+    // Each job gets its own core so that one slow decoder doesn't hold up the others.
+    VSCore *core = vsapi->createCore(0);
+    if (!core)
+        throw WobblyException("Job number " + std::to_string(job_index + 1) + ": failed to create VapourSynth core object.");
+
+    vsapi->setThreadCount(threads, core);
+    vsapi->setMaxCacheSize(cache_size, core);
+    vsapi->addLogHandler(messageHandler, nullptr, (void *)this, core);
+
+    VSScript *script = vssapi->createScript(core);
+    if (!script)
+        throw WobblyException("Job number " + std::to_string(job_index + 1) + ": failed to create VSScript object.");
+
+    return script;
 }
 
 
 // Always runs in the GUI thread.
-void WibblyWindow::startNextJob() {
-    current_job++;
+// Opens the sources of the next few jobs in their own script environments.
+// Opening a source needs little, so their cores stay small until the jobs start,
+// and don't eat into what the running jobs were given.
+void WibblyWindow::prepareSources() {
+    int sources_ahead = settings_prepared_sources_spin->value();
 
-    if (current_job == (int)jobs.size()) {
-        // No more jobs.
-        current_job = -1;
+    next_prepared_job = std::max(next_prepared_job, next_job);
 
-        int current_row = main_jobs_list->currentRow();
-        main_jobs_list->setCurrentRow(-1, QItemSelectionModel::NoUpdate);
-        main_jobs_list->setCurrentRow(current_row, QItemSelectionModel::NoUpdate);
+    while (!jobs_aborted && (int)prepared_sources.size() < sources_ahead && next_prepared_job < (int)jobs.size()) {
+        int job_index = next_prepared_job++;
 
-        QApplication::alert(this, 0);
+        auto prepared = std::make_unique<PreparedSource>();
+        prepared->job = job_index;
 
-        // Re-enable the user interface.
-        setEnabled(true);
+        try {
+            prepared->vsscript = createJobScript(job_index, PreparedSource::threads, PreparedSource::cache_size);
+        } catch (WobblyException &) {
+            // startJob will try again and report the error.
+            continue;
+        }
 
-        return;
+        VSMap *m = vsapi->createMap();
+        vsapi->mapSetData(m, "wibbly_last_input_file", "", -1, dtUtf8, maReplace);
+        vssapi->setVariables(prepared->vsscript, m);
+        vsapi->freeMap(m);
+
+        std::string script = jobs[job_index].generateSourceScript();
+        std::string script_name = jobs[job_index].getInputFile();
+
+        VSScript *vsscript = prepared->vsscript;
+
+        prepared->thread = std::thread([this, vsscript, script, script_name] () {
+            // Any error will come up again when the job's final script is evaluated.
+            vssapi->evalSetWorkingDir(vsscript, 1);
+            vssapi->evaluateBuffer(vsscript, script.c_str(), script_name.c_str());
+        });
+
+        prepared_sources.push_back(std::move(prepared));
+    }
+}
+
+
+// Always runs in the GUI thread.
+// Returns the job's script environment with the source already open, or nullptr if it wasn't prepared.
+VSScript *WibblyWindow::takePreparedSource(int job_index) {
+    while (prepared_sources.size() && prepared_sources.front()->job <= job_index) {
+        std::unique_ptr<PreparedSource> prepared = std::move(prepared_sources.front());
+        prepared_sources.pop_front();
+
+        // Usually the indexing is long done by now.
+        prepared->thread.join();
+
+        if (prepared->job == job_index) {
+            VSCore *core = vssapi->getCore(prepared->vsscript);
+            vsapi->setThreadCount(getThreadsPerJob(), core);
+            vsapi->setMaxCacheSize(getCacheSizePerJob(), core);
+
+            return prepared->vsscript;
+        }
+
+        vssapi->freeScript(prepared->vsscript);
+    }
+
+    return nullptr;
+}
+
+
+// Always runs in the GUI thread.
+void WibblyWindow::freePreparedSources() {
+    // The source filters can't be interrupted, so this waits for them.
+    for (size_t i = 0; i < prepared_sources.size(); i++) {
+        prepared_sources[i]->thread.join();
+
+        vssapi->freeScript(prepared_sources[i]->vsscript);
     }
 
-    setEnabled(false);
+    prepared_sources.clear();
+}
+
+
+// Returns true if the job is now running, false if it only has to write the project.
+bool WibblyWindow::startJob(int job_index) {
+    const WibblyJob &job = jobs[job_index];
+
+    int threads = getThreadsPerJob();
+
+    auto runner = std::make_unique<JobRunner>();
+    runner->window = this;
+    runner->job = job_index;
+    runner->compact_project = settings_compact_projects_check->isChecked();
+    runner->compress_project = settings_compress_projects_check->isChecked();
+
+    runner->vsscript = takePreparedSource(job_index);
+    if (!runner->vsscript)
+        runner->vsscript = createJobScript(job_index, threads, getCacheSizePerJob());
+
+    int steps = job.getSteps();
+    int metrics_steps = steps & (StepFieldMatch | StepInterlacedFades | StepDecimation | StepSceneChanges);
+
+    runner->metrics = std::make_unique<WibblyMetricsCache>(job, settings_metrics_cache_check->isChecked());
+
+    // Steps whose metrics are all in the cache are left out of the script,
+    // unless a later step needs their output.
+    auto getScriptSteps = [steps] (int compute_steps) {
+        int script_steps = (steps & (StepTrim | StepCrop)) | compute_steps;
+        if (compute_steps & (StepInterlacedFades | StepDecimation | StepSceneChanges))
+            script_steps |= steps & StepFieldMatch;
+        return script_steps;
+    };
 
-    const WibblyJob &job = jobs[current_job];
+    int cached_frames = runner->metrics->getNumFrames();
+    runner->compute_steps = metrics_steps & ~runner->metrics->getCompleteSteps();
 
     try {
-        evaluateFinalScript(current_job);
-    } catch (WobblyException &e) {
-        errorPopup(e.what());
-        return;
+        runner->vsnode = evaluateFinalScript(job_index, runner->vsscript, getScriptSteps(runner->compute_steps));
+
+        runner->vsvi = vsapi->getVideoInfo(runner->vsnode);
+
+        runner->metrics->setNumFrames(runner->vsvi->numFrames);
+
+        if (cached_frames && cached_frames != runner->vsvi->numFrames) {
+            // The cache belongs to some other video after all, so start over without it.
+            runner->compute_steps = metrics_steps;
+
+            vsapi->freeNode(runner->vsnode);
+            runner->vsnode = nullptr;
+            runner->vsnode = evaluateFinalScript(job_index, runner->vsscript, getScriptSteps(runner->compute_steps));
+            runner->vsvi = vsapi->getVideoInfo(runner->vsnode);
+        }
+    } catch (WobblyException &) {
+        freeJobRunner(runner.get());
+        throw;
     }
 
+    const VSVideoInfo *vi = runner->vsvi;
+
     QString input_file = QString::fromStdString(job.getInputFile());
     if (settings_use_relative_paths_check->isChecked())
         input_file = QFileInfo(input_file).fileName();
 
-    current_project = new WobblyProject(false, input_file.toStdString(), job.getSourceFilter(), vsvi->fpsNum, vsvi->fpsDen, vsvi->width, vsvi->height, vsvi->numFrames);
+    runner->project = std::make_unique<WobblyProject>(false, input_file.toStdString(), job.getSourceFilter(), vi->fpsNum, vi->fpsDen, vi->width, vi->height, vi->numFrames);
+    WobblyProject *project = runner->project.get();
 
     auto trims = job.getTrims();
     for (auto it = trims.cbegin(); it != trims.cend(); it++)
-        current_project->addTrim(it->second.first, it->second.last);
+        project->addTrim(it->second.first, it->second.last);
 
     if (!trims.size())
-        current_project->addTrim(0, vsvi->numFrames - 1);
-
-    int steps = job.getSteps();
+        project->addTrim(0, vi->numFrames - 1);
 
     if (steps & StepFieldMatch) {
         for (size_t i = 0; i < vfm_params.size(); i++) {
             if (vfm_params[i].type == VIVTCParamInt) {
-                current_project->setVFMParameter(vfm_params[i].name.toStdString(), job.getVFMParameterInt(vfm_params[i].name.toStdString()));
+                project->setVFMParameter(vfm_params[i].name.toStdString(), job.getVFMParameterInt(vfm_params[i].name.toStdString()));
             } else if (vfm_params[i].type == VIVTCParamDouble) {
-                current_project->setVFMParameter(vfm_params[i].name.toStdString(), job.getVFMParameterDouble(vfm_params[i].name.toStdString()));
+                project->setVFMParameter(vfm_params[i].name.toStdString(), job.getVFMParameterDouble(vfm_params[i].name.toStdString()));
             } else if (vfm_params[i].type == VIVTCParamBool) {
-                current_project->setVFMParameter(vfm_params[i].name.toStdString(), job.getVFMParameterBool(vfm_params[i].name.toStdString()));
+                project->setVFMParameter(vfm_params[i].name.toStdString(), job.getVFMParameterBool(vfm_params[i].name.toStdString()));
             }
         }
     }
@@ -1406,188 +1786,396 @@ void WibblyWindow::startNextJob() {
     if (steps & StepDecimation) {
         for (size_t i = 0; i < vdecimate_params.size(); i++) {
             if (vdecimate_params[i].type == VIVTCParamInt) {
-                current_project->setVDecimateParameter(vdecimate_params[i].name.toStdString(), job.getVDecimateParameterInt(vdecimate_params[i].name.toStdString()));
+                project->setVDecimateParameter(vdecimate_params[i].name.toStdString(), job.getVDecimateParameterInt(vdecimate_params[i].name.toStdString()));
             } else if (vdecimate_params[i].type == VIVTCParamDouble) {
-                current_project->setVDecimateParameter(vdecimate_params[i].name.toStdString(), job.getVDecimateParameterDouble(vdecimate_params[i].name.toStdString()));
+                project->setVDecimateParameter(vdecimate_params[i].name.toStdString(), job.getVDecimateParameterDouble(vdecimate_params[i].name.toStdString()));
             } else if (vdecimate_params[i].type == VIVTCParamBool) {
-                current_project->setVDecimateParameter(vdecimate_params[i].name.toStdString(), job.getVDecimateParameterBool(vdecimate_params[i].name.toStdString()));
+                project->setVDecimateParameter(vdecimate_params[i].name.toStdString(), job.getVDecimateParameterBool(vdecimate_params[i].name.toStdString()));
             }
         }
     }
 
-    if (!(steps & StepFieldMatch || steps & StepInterlacedFades || steps & StepDecimation || steps & StepSceneChanges)) {
-        // No metrics to collect. Just create the project file and move on.
+    // Scxvid remembers the previous frame, so it must see all of them in order.
+    if (runner->compute_steps & StepSceneChanges && job.getSceneChangeDetector() == SceneChangeDetectorScxvid) {
+        runner->frames.resize(vi->numFrames);
+        for (int i = 0; i < vi->numFrames; i++)
+            runner->frames[i] = i;
+    } else if (runner->compute_steps) {
+        for (int i = 0; i < vi->numFrames; i++)
+            if (!runner->metrics->isFrameComplete(i, runner->compute_steps))
+                runner->frames.push_back(i);
+    }
+
+    if (runner->frames.empty()) {
+        // No metrics to collect, or they were all in the cache. Just create the project file and move on.
+        freeJobRunner(runner.get());
+
+        startWritingProject(std::move(runner));
+
+        return false;
+    }
+
+    int requests = std::min(threads, (int)runner->frames.size());
+
+    runner->frames_left = (int)runner->frames.size();
+    runner->next_frame = 0;
+    runner->elapsed_timer.start();
+
+    JobRunner *r = runner.get();
+    runners.push_back(std::move(runner));
+
+    for (int i = 0; i < requests; i++) {
+        ++r->request_count;
+        vsapi->getFrameAsync(r->frames[r->next_frame], r->vsnode, frameDoneCallback, (void *)r);
+        r->next_frame++;
+    }
+
+    return true;
+}
+
+
+// Runs in a writer thread, once all the metrics are in.
+// The job's node and script are already freed.
+void WibblyWindow::finishJob(JobRunner *runner) {
+    WobblyProject *project = runner->project.get();
+
+    runner->metrics->applyToProject(project, jobs[runner->job].getFadesThreshold());
+
+    project->resetRangeMatches(0, runner->metrics->getNumFrames() - 1);
+
+    // If the project was successfully saved earlier, this will probably work.
+    project->writeProject(jobs[runner->job].getOutputFile(), runner->compact_project, runner->compress_project);
+
+    try {
+        runner->metrics->save();
+    } catch (WobblyException &) {
+        // The cache is only an optimisation. Not being able to write it doesn't make the job fail.
+    }
+}
+
+
+// Always runs in the GUI thread.
+// The job's slot is free as soon as this is called, so the next job can start while the project is written.
+void WibblyWindow::startWritingProject(std::unique_ptr<JobRunner> runner) {
+    JobRunner *r = runner.get();
+    writers.push_back(std::move(runner));
+
+    r->writer_thread = std::thread([this, r] () {
         try {
-            current_project->writeProject(job.getOutputFile(), settings_compact_projects_check->isChecked());
+            finishJob(r);
+        } catch (WobblyException &e) {
+            r->failed = true;
+
+            QMetaObject::invokeMethod(this, "errorPopup", Qt::QueuedConnection, Q_ARG(QString, QString(e.what())));
+        }
+
+        QMetaObject::invokeMethod(this, "projectWritten", Qt::QueuedConnection, Q_ARG(int, r->job));
+    });
+}
+
 
-            delete current_project;
-            current_project = nullptr;
+// Always runs in the GUI thread.
+void WibblyWindow::freeJobRunner(JobRunner *runner) {
+    {
+        // Wait until all requests are done before freeing the node.
+        std::unique_lock<std::mutex> lock(requests_mutex);
+        while (runner->request_count)
+            requests_condition.wait(lock);
+    }
+
+    // Keep what was collected before the job was interrupted.
+    if (runner->aborted && runner->metrics) {
+        try {
+            runner->metrics->save();
+        } catch (WobblyException &) {
+        }
+    }
+
+    vsapi->freeNode(runner->vsnode);
+    runner->vsnode = nullptr;
+
+    // The script owns the core.
+    vssapi->freeScript(runner->vsscript);
+    runner->vsscript = nullptr;
+    runner->vsvi = nullptr;
+}
+
+
+// Always runs in the GUI thread.
+void WibblyWindow::abortJobs() {
+    jobs_aborted = true;
+
+    for (size_t i = 0; i < runners.size(); i++)
+        runners[i]->aborted = true;
+
+    for (size_t i = 0; i < runners.size(); i++)
+        freeJobRunner(runners[i].get());
+
+    runners.clear();
+
+    freePreparedSources();
+
+    // The projects being written are left alone, so they don't end up half written.
+}
+
+
+// Always runs in the GUI thread.
+// Fills every free slot with a job, and finishes up when there is nothing left to do.
+void WibblyWindow::startNextJob() {
+    int concurrent_jobs = settings_concurrent_jobs_spin->value();
+
+    // Jobs whose metrics are all cached only write their project,
+    // so they are limited by the number of writers instead.
+    while (!jobs_aborted && (int)runners.size() < concurrent_jobs && (int)writers.size() < concurrent_jobs && next_job < (int)jobs.size()) {
+        int job_index = next_job++;
+
+        try {
+            if (startJob(job_index))
+                setJobStatus(job_index, QStringLiteral("0%"));
+            else
+                setJobStatus(job_index, QStringLiteral("writing"));
         } catch (WobblyException &e) {
             errorPopup(e.what());
 
-            delete current_project;
-            current_project = nullptr;
+            abortJobs();
         }
+    }
 
-        QApplication::processEvents();
+    prepareSources();
 
-        // A little recursion, but surely there won't be enough jobs to make it a problem.
-        startNextJob();
+    if (runners.size() || writers.size())
+        return;
+
+    // No more jobs.
+    progress_timer->stop();
+    main_progress_dialog->reset();
+
+    for (int i = 0; i < (int)jobs.size(); i++)
+        setJobStatus(i, QString());
+
+    int current_row = main_jobs_list->currentRow();
+    main_jobs_list->setCurrentRow(-1, QItemSelectionModel::NoUpdate);
+    main_jobs_list->setCurrentRow(current_row, QItemSelectionModel::NoUpdate);
+
+    QApplication::alert(this, 0);
+
+    // Re-enable the user interface.
+    setEnabled(true);
+}
+
+
+// Always runs in the GUI thread.
+void WibblyWindow::jobFinished(int job_index) {
+    auto it = std::find_if(runners.begin(), runners.end(), [job_index] (const std::unique_ptr<JobRunner> &runner) {
+        return runner->job == job_index;
+    });
 
+    // Already cleaned up by abortJobs.
+    if (it == runners.end())
         return;
+
+    JobRunner *runner = it->get();
+
+    freeJobRunner(runner);
+
+    total_frames_done += runner->frames_done;
+
+    if (runner->failed) {
+        jobs_finished++;
+
+        setJobStatus(job_index, QStringLiteral("failed"));
+
+        runners.erase(it);
+
+        abortJobs();
+    } else {
+        setJobStatus(job_index, QStringLiteral("writing"));
+
+        std::unique_ptr<JobRunner> finished = std::move(*it);
+        runners.erase(it);
+
+        startWritingProject(std::move(finished));
     }
 
-    progress_dialog_label_text = QStringLiteral("Job %1/%2:\n%3").arg(current_job + 1).arg(jobs.size()).arg(QString::fromStdString(job.getOutputFile()));
+    startNextJob();
+}
+
 
-    main_progress_dialog->setLabelText(progress_dialog_label_text + "\n\n");
-    main_progress_dialog->setMinimum(0);
-    main_progress_dialog->setMaximum(vsvi->numFrames);
-    main_progress_dialog->setValue(0);
+// Always runs in the GUI thread.
+void WibblyWindow::projectWritten(int job_index) {
+    auto it = std::find_if(writers.begin(), writers.end(), [job_index] (const std::unique_ptr<JobRunner> &runner) {
+        return runner->job == job_index;
+    });
 
-    VSCoreInfo core_info;
-    vsapi->getCoreInfo(vscore, &core_info);
-    int requests = std::min(core_info.numThreads, vsvi->numFrames);
+    // Already joined by closeEvent.
+    if (it == writers.end())
+        return;
 
-    aborted = false;
+    JobRunner *runner = it->get();
 
-    frames_left = vsvi->numFrames;
+    runner->writer_thread.join();
 
-    next_frame = 0;
-    elapsed_timer.start();
-    update_timer.start();
-    for (int i = 0; i < requests; i++) {
-        ++request_count;
-        vsapi->getFrameAsync(next_frame, vsnode, frameDoneCallback, (void *)this);
-        next_frame++;
+    jobs_finished++;
+
+    bool failed = runner->failed;
+
+    setJobStatus(job_index, failed ? QStringLiteral("failed") : QStringLiteral("done"));
+
+    writers.erase(it);
+
+    if (failed)
+        abortJobs();
+
+    startNextJob();
+}
+
+
+// Always runs in the GUI thread.
+void WibblyWindow::updateJobProgress() {
+    int64_t frames_done = total_frames_done;
+    double jobs_done = jobs_finished;
+
+    for (size_t i = 0; i < runners.size(); i++) {
+        const JobRunner *runner = runners[i].get();
+
+        int done = runner->frames_done;
+        int num_frames = (int)runner->frames.size();
+
+        frames_done += done;
+        jobs_done += (double)done / num_frames;
+
+        qint64 elapsed_milliseconds = runner->elapsed_timer.elapsed();
+        double frames_per_second = elapsed_milliseconds ? (double)done * 1000 / elapsed_milliseconds : 0.0;
+
+        QString status = QStringLiteral("%1%, %2 fps").arg(done * 100 / num_frames).arg(frames_per_second, 0, 'f', 2);
+
+        if (frames_per_second > 0) {
+            int seconds_left = (int)((num_frames - done) / frames_per_second);
+            int minutes_left = seconds_left / 60;
+            seconds_left = seconds_left % 60;
+            int hours_left = minutes_left / 60;
+            minutes_left = minutes_left % 60;
+
+            status += QStringLiteral(", %1:%2:%3 left")
+                    .arg(hours_left, 2, 10, QLatin1Char('0'))
+                    .arg(minutes_left, 2, 10, QLatin1Char('0'))
+                    .arg(seconds_left, 2, 10, QLatin1Char('0'));
+        }
+
+        setJobStatus(runner->job, status);
     }
+
+    qint64 elapsed_milliseconds = elapsed_timer.elapsed();
+    double frames_per_second = elapsed_milliseconds ? (double)frames_done * 1000 / elapsed_milliseconds : 0.0;
+
+    main_progress_dialog->setLabelText(QStringLiteral("%1 jobs running, %2/%3 finished\n\n%4 fps overall")
+                                       .arg(runners.size())
+                                       .arg(jobs_finished)
+                                       .arg(jobs.size())
+                                       .arg(frames_per_second, 0, 'f', 2));
+
+    // Don't let the dialog reach the maximum, because it closes itself then.
+    main_progress_dialog->setValue(std::min((int)(jobs_done * 1000), main_progress_dialog->maximum() - 1));
 }
 
 
 // Runs in the worker threads, so don't touch the GUI directly.
-// The worker threads are queued up inside VapourSynth, so they run one at a time.
-void WibblyWindow::frameDone(void *frame_v, int n, const QString &error_msg) {
+// The worker threads of one core are queued up inside VapourSynth, so they run one at a time
+// for any given job. Different jobs run in parallel and share nothing but the job list.
+void WibblyWindow::frameDone(void *runner_v, void *frame_v, int n, const QString &error_msg) {
+    JobRunner *runner = (JobRunner *)runner_v;
     const VSFrame *frame = (const VSFrame *)frame_v;
 
-    if (aborted) {
+    if (runner->aborted) {
         vsapi->freeFrame(frame);
     } else {
         if (frame) {
             const VSMap *props = vsapi->getFramePropertiesRO(frame);
 
-            int err;
-
-            const char match_chars[] = { 'p', 'c', 'n', 'b', 'u' };
-            int64_t match = vsapi->mapGetInt(props, "VFMMatch", 0, &err);
-            if (!err)
-                current_project->setOriginalMatch(n, match_chars[match]);
-
-            if (vsapi->mapGetInt(props, "_Combed", 0, &err))
-                current_project->addCombedFrame(n);
+            WibblyMetricsCache *metrics = runner->metrics.get();
 
-            if (vsapi->mapNumElements(props, "VFMMics") == 5) {
-                const int64_t *mics = vsapi->mapGetIntArray(props, "VFMMics", &err);
-                current_project->setMics(n, mics[0], mics[1], mics[2], mics[3], mics[4]);
-            }
-
-            if (vsapi->mapNumElements(props, "MMetrics") == 2 && vsapi->mapNumElements(props, "VMetrics") == 2) {
-                const int64_t *mmetrics = vsapi->mapGetIntArray(props, "MMetrics", &err);
-                const int64_t *vmetrics = vsapi->mapGetIntArray(props, "VMetrics", &err);
-                current_project->setDMetrics(n, mmetrics[0], mmetrics[1], vmetrics[0], vmetrics[1]);
-            }
+            int err;
 
-            if (vsapi->mapGetInt(props, "_SceneChangePrev", 0, &err))
-                current_project->addSection(n);
+            if (runner->compute_steps & StepFieldMatch) {
+                FieldMatchMetrics m = {};
 
-            int64_t decimate_metric = vsapi->mapGetInt(props, "VDecimateMaxBlockDiff", 0, &err);
-            if (!err)
-                current_project->setDecimateMetric(n, decimate_metric);
+                m.match = (int8_t)vsapi->mapGetInt(props, "VFMMatch", 0, &err);
+                if (err)
+                    m.match = -1;
 
-            if (vsapi->mapGetInt(props, "VDecimateDrop", 0, &err))
-                current_project->addDecimatedFrame(n);
+                m.combed = !!vsapi->mapGetInt(props, "_Combed", 0, &err);
 
-            double field_difference = vsapi->mapGetFloat(props, "WibblyFieldDifference", 0, &err);
-            if (field_difference > jobs[current_job].getFadesThreshold())
-                current_project->addInterlacedFade(n, field_difference);
+                if (vsapi->mapNumElements(props, "VFMMics") == 5) {
+                    const int64_t *mics = vsapi->mapGetIntArray(props, "VFMMics", &err);
+                    for (int i = 0; i < 5; i++)
+                        m.mics[i] = (int16_t)mics[i];
+                    m.has_mics = 1;
+                }
 
-            vsapi->freeFrame(frame);
+                if (vsapi->mapNumElements(props, "MMetrics") == 2 && vsapi->mapNumElements(props, "VMetrics") == 2) {
+                    const int64_t *mmetrics = vsapi->mapGetIntArray(props, "MMetrics", &err);
+                    const int64_t *vmetrics = vsapi->mapGetIntArray(props, "VMetrics", &err);
+                    for (int i = 0; i < 2; i++) {
+                        m.mmetrics[i] = (int32_t)mmetrics[i];
+                        m.vmetrics[i] = (int32_t)vmetrics[i];
+                    }
+                    m.has_dmetrics = 1;
+                }
 
-            if (next_frame < vsvi->numFrames) {
-                ++request_count;
-                vsapi->getFrameAsync(next_frame, vsnode, frameDoneCallback, (void *)this);
-                next_frame++;
+                metrics->field_match.set(n, m);
             }
 
-            frames_left--;
-
-            // Speed and time remaining updated every five seconds,
-            // or as long as it takes to process a frames, whichever is larger.
-            if (update_timer.elapsed() >= 5000) {
-                update_timer.start();
-
-                qint64 elapsed_milliseconds = elapsed_timer.elapsed();
-                double frames_per_second = (double)(vsvi->numFrames - frames_left) * 1000 / elapsed_milliseconds;
-                int seconds_left = (int)(frames_left / frames_per_second);
-                int minutes_left = seconds_left / 60;
-                seconds_left = seconds_left % 60;
-                int hours_left = minutes_left / 60;
-                minutes_left = minutes_left % 60;
-
-                QMetaObject::invokeMethod(
-                            main_progress_dialog,
-                            "setLabelText",
-                            Qt::QueuedConnection,
-                            Q_ARG(QString, QStringLiteral("%1\n\n%2 fps, %3:%4:%5 to finish this job")
-                                  .arg(progress_dialog_label_text)
-                                  .arg(frames_per_second, 0, 'f', 2)
-                                  .arg(hours_left, 2, 10, QLatin1Char('0'))
-                                  .arg(minutes_left, 2, 10, QLatin1Char('0'))
-                                  .arg(seconds_left, 2, 10, QLatin1Char('0'))));
+            if (runner->compute_steps & StepSceneChanges) {
+                SceneChangeMetrics m = {};
+                m.scene_change = !!vsapi->mapGetInt(props, "_SceneChangePrev", 0, &err);
+                metrics->scene_changes.set(n, m);
             }
 
-            QMetaObject::invokeMethod(
-                        main_progress_dialog,
-                        "setValue",
-                        Qt::QueuedConnection,
-                        Q_ARG(int, vsvi->numFrames - frames_left));
+            if (runner->compute_steps & StepDecimation) {
+                DecimationMetrics m = {};
 
-            if (frames_left == 0) {
-                try {
-                    current_project->resetRangeMatches(0, vsvi->numFrames - 1);
+                m.max_block_diff = (int32_t)vsapi->mapGetInt(props, "VDecimateMaxBlockDiff", 0, &err);
+                m.has_max_block_diff = !err;
 
-                    // If the project was successfully saved earlier, this will probably work.
-                    current_project->writeProject(jobs[current_job].getOutputFile(), settings_compact_projects_check->isChecked());
+                m.drop = !!vsapi->mapGetInt(props, "VDecimateDrop", 0, &err);
 
-                    delete current_project;
-                    current_project = nullptr;
+                metrics->decimation.set(n, m);
+            }
 
-                    QMetaObject::invokeMethod(this, "startNextJob", Qt::QueuedConnection);
-                } catch (WobblyException &e) {
-                    QMetaObject::invokeMethod(this, "errorPopup", Qt::QueuedConnection, Q_ARG(QString, QString(e.what())));
+            if (runner->compute_steps & StepInterlacedFades) {
+                InterlacedFadesMetrics m = {};
+                m.field_difference = vsapi->mapGetFloat(props, "WibblyFieldDifference", 0, &err);
+                metrics->interlaced_fades.set(n, m);
+            }
 
-                    aborted = true;
-                    current_job = -1;
-                    QMetaObject::invokeMethod(this, "setEnabled", Qt::QueuedConnection, Q_ARG(bool, true));
+            vsapi->freeFrame(frame);
 
-                    delete current_project;
-                    current_project = nullptr;
-                }
+            if (runner->next_frame < (int)runner->frames.size()) {
+                ++runner->request_count;
+                vsapi->getFrameAsync(runner->frames[runner->next_frame], runner->vsnode, frameDoneCallback, (void *)runner);
+                runner->next_frame++;
             }
+
+            runner->frames_left--;
+            ++runner->frames_done;
+
+            // The project is written after the job's core is freed.
+            if (runner->frames_left == 0)
+                QMetaObject::invokeMethod(this, "jobFinished", Qt::QueuedConnection, Q_ARG(int, runner->job));
         } else {
-            aborted = true;
+            runner->aborted = true;
+            runner->failed = true;
 
-            delete current_project;
-            current_project = nullptr;
+            QMetaObject::invokeMethod(this, "errorPopup", Qt::QueuedConnection, Q_ARG(QString, QStringLiteral("Job number %1: failed to retrieve frame number %2. Error message:\n\n%3").arg(runner->job + 1).arg(n).arg(error_msg)));
 
-            QMetaObject::invokeMethod(this, "errorPopup", Qt::QueuedConnection, Q_ARG(QString, QStringLiteral("Job number %1: failed to retrieve frame number %2. Error message:\n\n%3").arg(current_job).arg(n).arg(error_msg)));
+            QMetaObject::invokeMethod(this, "jobFinished", Qt::QueuedConnection, Q_ARG(int, runner->job));
         }
     }
 
-    --request_count;
+    std::lock_guard<std::mutex> lock(requests_mutex);
 
-    if (request_count == 0) {
-        std::lock_guard<std::mutex> lock(requests_mutex);
-        requests_condition.notify_one();
-    }
+    if (--runner->request_count == 0)
+        requests_condition.notify_all();
 }
 
 
@@ -1602,11 +2190,24 @@ void WibblyWindow::readSettings() {
 
     settings_compact_projects_check->setChecked(settings.value(KEY_COMPACT_PROJECT_FILES, false).toBool());
 
+    settings_compress_projects_check->setChecked(settings.value(KEY_COMPRESS_PROJECT_FILES, false).toBool());
+
     settings_use_relative_paths_check->setChecked(settings.value(KEY_USE_RELATIVE_PATHS, false).toBool());
 
     if (settings.contains(KEY_MAXIMUM_CACHE_SIZE))
         settings_cache_spin->setValue(settings.value(KEY_MAXIMUM_CACHE_SIZE).toInt());
 
+    if (settings.contains(KEY_CONCURRENT_JOBS))
+        settings_concurrent_jobs_spin->setValue(settings.value(KEY_CONCURRENT_JOBS).toInt());
+
+    if (settings.contains(KEY_THREADS_PER_JOB))
+        settings_threads_per_job_spin->setValue(settings.value(KEY_THREADS_PER_JOB).toInt());
+
+    if (settings.contains(KEY_PREPARED_SOURCES))
+        settings_prepared_sources_spin->setValue(settings.value(KEY_PREPARED_SOURCES).toInt());
+
+    settings_metrics_cache_check->setChecked(settings.value(KEY_USE_METRICS_CACHE, true).toBool());
+
     if (settings.contains(KEY_LAST_CROP)) {
         QList<QVariant> crop_list = settings.value(KEY_LAST_CROP).toList();
         for (int i = 0; i < crop_list.size(); i++)
@@ -1622,7 +2223,8 @@ void WibblyWindow::writeSettings() {
 }
 
 
-void WibblyWindow::readJobs() {
+// The way the jobs were stored before the job file.
+void WibblyWindow::readLegacyJobs() {
     int job_count = settings.value(KEY_COUNT, 0).toInt();
 
     if (!job_count)
@@ -1673,70 +2275,58 @@ void WibblyWindow::readJobs() {
 
         job->setFadesThreshold(settings.value(key + KEY_FADES_THRESHOLD).toDouble());
 
-        main_jobs_list->addItem(QString::fromStdString(job->getInputFile()));
+        try {
+            job->setSceneChangeDetector(settings.value(key + KEY_SCENE_CHANGE_DETECTOR, SceneChangeDetectorScxvid).toInt());
+            job->setSceneChangeThreshold(settings.value(key + KEY_SCENE_CHANGE_THRESHOLD, 0.15).toDouble());
+        } catch (WobblyException &) {
+            // Leave the defaults alone.
+        }
     }
-
-    main_jobs_list->setCurrentRow(0);
 }
 
 
-void WibblyWindow::writeJobs() {
-    settings.remove(KEY_JOBS);
-
-    if (!jobs.size())
-        return;
-
-    settings.setValue(KEY_COUNT, (int)jobs.size());
-
-    int field_width = QString::number(jobs.size() - 1).size();
-
-    for (auto job = jobs.cbegin(); job != jobs.cend(); job++) {
-        QString key = KEY_JOB.arg(std::distance(jobs.cbegin(), job), field_width, 10, QLatin1Char('0'));
+void WibblyWindow::readJobs() {
+    QString path = WibblyJobFile::getJobFilePath(settings.fileName());
 
-        settings.setValue(key + KEY_INPUT_FILE, QString::fromStdString(job->getInputFile()));
+    std::vector<WibblyJob> loaded_jobs;
 
-        settings.setValue(key + KEY_SOURCE_FILTER, QString::fromStdString(job->getSourceFilter()));
+    if (QFileInfo::exists(path)) {
+        try {
+            loaded_jobs = WibblyJobFile::readJobs(path);
+        } catch (WobblyException &e) {
+            // Keep it around, because it will be replaced when Wibbly closes.
+            QFile::remove(path + ".broken");
+            QFile::rename(path, path + ".broken");
 
-        settings.setValue(key + KEY_OUTPUT_FILE, QString::fromStdString(job->getOutputFile()));
+            errorPopup(QStringLiteral("%1\n\nThe job file was renamed to '%2.broken'.").arg(e.what()).arg(path));
+        }
+    } else {
+        readLegacyJobs();
 
-        settings.setValue(key + KEY_STEPS, job->getSteps());
+        loaded_jobs = std::move(jobs);
+        jobs.clear();
+    }
 
-        const Crop &crop = job->getCrop();
-        QList<QVariant> crop_list = { crop.left, crop.top, crop.right, crop.bottom };
-        settings.setValue(key + KEY_CROP, crop_list);
+    if (loaded_jobs.empty())
+        return;
 
-        const auto &trims = job->getTrims();
-        QList<QVariant> trim_list;
-        trim_list.reserve(trims.size() * 2);
-        for (auto it = trims.cbegin(); it != trims.cend(); it++) {
-            trim_list.push_back(it->second.first);
-            trim_list.push_back(it->second.last);
-        }
-        settings.setValue(key + KEY_TRIMS, trim_list);
+    enqueueJobs(std::move(loaded_jobs));
 
-        for (auto param = vfm_params.cbegin(); param != vfm_params.cend(); param++) {
-            if (param->type == VIVTCParamInt)
-                settings.setValue(key + KEY_VFM + param->name, job->getVFMParameterInt(param->name.toStdString()));
-            else if (param->type == VIVTCParamDouble)
-                settings.setValue(key + KEY_VFM + param->name, job->getVFMParameterDouble(param->name.toStdString()));
-            else if (param->type == VIVTCParamBool)
-                settings.setValue(key + KEY_VFM + param->name, job->getVFMParameterBool(param->name.toStdString()));
-        }
+    main_jobs_list->setCurrentRow(0);
+}
 
-        for (auto param = vdecimate_params.cbegin(); param != vdecimate_params.cend(); param++) {
-            if (param->type == VIVTCParamInt)
-                settings.setValue(key + KEY_VDECIMATE + param->name, job->getVDecimateParameterInt(param->name.toStdString()));
-            else if (param->type == VIVTCParamDouble)
-                settings.setValue(key + KEY_VDECIMATE + param->name, job->getVDecimateParameterDouble(param->name.toStdString()));
-            else if (param->type == VIVTCParamBool)
-                settings.setValue(key + KEY_VDECIMATE + param->name, job->getVDecimateParameterBool(param->name.toStdString()));
-        }
 
-        settings.setValue(key + KEY_DMETRICS_ENABLED, job->getDMetrics().enabled);
-        settings.setValue(key + KEY_DMETRICS_NT, job->getDMetrics().nt);
+void WibblyWindow::writeJobs() {
+    try {
+        WibblyJobFile::writeJobs(WibblyJobFile::getJobFilePath(settings.fileName()), jobs);
+    } catch (WobblyException &e) {
+        errorPopup(e.what());
 
-        settings.setValue(key + KEY_FADES_THRESHOLD, job->getFadesThreshold());
+        return;
     }
+
+    // Left over from older versions. Only removed once the job file holds the jobs.
+    settings.remove(KEY_JOBS);
 }
 
 
@@ -22,9 +22,13 @@ SOFTWARE.
 #define WIBBLYWINDOW_H
 
 #include <atomic>
+#include <deque>
+#include <memory>
+#include <thread>
 
 #include <QCheckBox>
 #include <QCloseEvent>
+#include <QComboBox>
 #include <QDoubleSpinBox>
 #include <QElapsedTimer>
 #include <QLabel>
@@ -34,6 +38,7 @@ SOFTWARE.
 #include <QSlider>
 #include <QSpinBox>
 #include <QTimeEdit>
+#include <QTimer>
 
 #include <VSScript4.h>
 
@@ -42,6 +47,7 @@ SOFTWARE.
 #include "ProgressDialog.h"
 
 #include "WibblyJob.h"
+#include "WibblyMetricsCache.h"
 
 
 enum VIVTCParameterTypes {
@@ -60,6 +66,56 @@ struct VIVTCParameter {
 };
 
 
+class WibblyWindow;
+
+
+// One job being processed, with its own core and script environment.
+struct JobRunner {
+    WibblyWindow *window = nullptr;
+    int job = -1;
+
+    VSScript *vsscript = nullptr;
+    VSNode *vsnode = nullptr;
+    const VSVideoInfo *vsvi = nullptr;
+
+    std::unique_ptr<WobblyProject> project;
+    bool compact_project = false;
+    bool compress_project = false;
+
+    // Holds the metrics as they arrive, and whatever was found in the cache.
+    std::unique_ptr<WibblyMetricsCache> metrics;
+    int compute_steps = StepNone;
+
+    // The frames that must be requested, because they aren't in the cache.
+    std::vector<int> frames;
+
+    int next_frame = 0;
+    int frames_left = 0;
+    bool failed = false;
+    std::atomic<bool> aborted{false};
+    std::atomic<int> frames_done{0};
+    std::atomic<int> request_count{0};
+
+    QElapsedTimer elapsed_timer;
+
+    // Writes the project once all the metrics are in.
+    std::thread writer_thread;
+};
+
+
+// The script environment of a job that hasn't started yet, where a worker
+// thread opens the source, so the source filter indexes the file while
+// the jobs before it are still running.
+struct PreparedSource {
+    static constexpr int threads = 1;
+    static constexpr int64_t cache_size = 64 * 1024 * 1024;
+
+    int job = -1;
+    VSScript *vsscript = nullptr;
+    std::thread thread;
+};
+
+
 class WibblyWindow : public QMainWindow
 {
     Q_OBJECT
@@ -98,11 +154,20 @@ class WibblyWindow : public QMainWindow
     DockWidget *fades_dock;
     QDoubleSpinBox *fades_threshold_spin;
 
+    DockWidget *scene_changes_dock;
+    QComboBox *scene_changes_detector_combo;
+    QDoubleSpinBox *scene_changes_threshold_spin;
+
     DockWidget *settings_dock;
     QSpinBox *settings_font_spin;
     QCheckBox *settings_compact_projects_check;
+    QCheckBox *settings_compress_projects_check;
     QCheckBox *settings_use_relative_paths_check;
     QSpinBox *settings_cache_spin;
+    QSpinBox *settings_concurrent_jobs_spin;
+    QSpinBox *settings_threads_per_job_spin;
+    QSpinBox *settings_prepared_sources_spin;
+    QCheckBox *settings_metrics_cache_check;
     int settings_last_crop[4] = {};
 
 
@@ -123,16 +188,17 @@ class WibblyWindow : public QMainWindow
     int trim_start = -1;
     int trim_end = -1;
 
-    WobblyProject *current_project = nullptr;
-    int current_job = -1;
-    int next_frame = 0;
-    int frames_left = 0;
-    bool aborted = false;
-    std::atomic<int> request_count;
+    std::vector<std::unique_ptr<JobRunner>> runners;
+    std::vector<std::unique_ptr<JobRunner>> writers;
+    std::deque<std::unique_ptr<PreparedSource>> prepared_sources;
+    int next_job = 0;
+    int next_prepared_job = 0;
+    int jobs_finished = 0;
+    bool jobs_aborted = false;
+    int64_t total_frames_done = 0;
 
-    QString progress_dialog_label_text;
     QElapsedTimer elapsed_timer;
-    QElapsedTimer update_timer;
+    QTimer *progress_timer;
 
     QSettings settings;
 
@@ -155,20 +221,38 @@ class WibblyWindow : public QMainWindow
     void createVDecimateWindow();
     void createTrimWindow();
     void createInterlacedFadesWindow();
+    void createSceneChangesWindow();
     void createSettingsWindow();
 
     void realOpenVideo(const QString &path);
+    void enqueueJobs(std::vector<WibblyJob> &&new_jobs);
+    void enqueueDirectory(const QString &path);
 
-    void evaluateFinalScript(int job_index);
+    VSNode *evaluateFinalScript(int job_index, VSScript *script, int steps);
     void evaluateDisplayScript();
     void displayFrame(int n);
 
     void readSettings();
     void writeSettings();
 
+    void readLegacyJobs();
     void readJobs();
     void writeJobs();
 
+    int getThreadsPerJob();
+    int64_t getCacheSizePerJob();
+    VSScript *createJobScript(int job_index, int threads, int64_t cache_size);
+    void prepareSources();
+    VSScript *takePreparedSource(int job_index);
+    void freePreparedSources();
+
+    bool startJob(int job_index);
+    void finishJob(JobRunner *runner);
+    void startWritingProject(std::unique_ptr<JobRunner> runner);
+    void freeJobRunner(JobRunner *runner);
+    void abortJobs();
+    void setJobStatus(int job_index, const QString &status);
+
     void jumpRelative(int offset);
     void jump1Backward();
     void jump1Forward();
@@ -191,9 +275,12 @@ public:
 
 public slots:
     void vsLogPopup(int msgType, const QString &msg);
-    void frameDone(void *frame_v, int n, const QString &error_msg);
+    void frameDone(void *runner_v, void *frame_v, int n, const QString &error_msg);
 
     void startNextJob();
+    void jobFinished(int job_index);
+    void projectWritten(int job_index);
+    void updateJobProgress();
 
     void errorPopup(const QString &msg);
 };
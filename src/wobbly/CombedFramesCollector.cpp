@@ -18,6 +18,8 @@ SOFTWARE.
 */
 
 
+#include <algorithm>
+
 #include "CombedFramesCollector.h"
 
 
@@ -26,12 +28,15 @@ CombedFramesCollector::CombedFramesCollector(const VSSCRIPTAPI *_vssapi, const V
     , vsapi(_vsapi)
     , vscore(_vscore)
     , vsscript(_vsscript)
+    , vsnode(nullptr)
+    , requester(_vsapi)
+    , num_frames(0)
 {
 
 }
 
 
-void CombedFramesCollector::start(std::string script, const char *script_name) {
+void CombedFramesCollector::start(std::string script, const char *script_name, const std::vector<int> &_frames) {
     script +=
             "src = vs.get_output(index=0)\n"
 
@@ -62,111 +67,104 @@ void CombedFramesCollector::start(std::string script, const char *script_name) {
         return;
     }
 
-    num_frames = vsapi->getVideoInfo(vsnode)->numFrames;
+    frames = _frames;
+
+    num_frames = frames.size() ? (int)frames.size() : vsapi->getVideoInfo(vsnode)->numFrames;
+
+    combed_frames.assign(num_frames, 0);
 
     VSCoreInfo core_info;
     vsapi->getCoreInfo(vscore, &core_info);
 
-    int requests = std::min(core_info.numThreads, num_frames);
+    FrameRequester::Callbacks callbacks;
 
-    aborted = false;
-    frames_left = num_frames;
-    next_frame = 0;
-    request_count = 0;
-    elapsed_timer.start();
-    update_timer.start();
+    callbacks.frame_at = [this] (int index) {
+        return frameAt(index);
+    };
 
-    for (int i = 0; i < requests; i++) {
-        request_count++;
-        vsapi->getFrameAsync(next_frame, vsnode, CombedFramesCollector::frameDoneCallback, (void *)this);
-        next_frame++;
-    }
-}
+    // Runs in the worker threads, so nothing in here may touch the GUI.
+    callbacks.frame_done = [this] (const VSFrame *frame, int n) {
+        const VSMap *props = vsapi->getFramePropertiesRO(frame);
 
+        int err;
 
-void CombedFramesCollector::stop() {
-    aborted = true;
-}
+        if (vsapi->mapGetInt(props, "_Combed", 0, &err))
+            combed_frames[indexOf(n)] = 1;
+    };
 
+    // Only the throttled progress reports and the final results go through the event loop.
+    callbacks.progress = [this] (int done) {
+        QMetaObject::invokeMethod(this, "reportProgress", Qt::QueuedConnection, Q_ARG(int, done));
+    };
 
-void VS_CC CombedFramesCollector::frameDoneCallback(void *userData, const VSFrame *f, int n, VSNode *, const char *errorMsg) {
-    CombedFramesCollector *collector = (CombedFramesCollector *)userData;
+    callbacks.finished = [this] () {
+        QMetaObject::invokeMethod(this, "finish", Qt::QueuedConnection);
+    };
 
-    // Qt::DirectConnection = frameDone runs in the worker threads
-    // Qt::QueuedConnection = frameDone runs in the GUI thread
-    QMetaObject::invokeMethod(collector,
-                              "frameDone",
-                              Qt::QueuedConnection,
-                              Q_ARG(void *, (void *)f),
-                              Q_ARG(int, n),
-                              Q_ARG(QString, QString(errorMsg)));
+    requester.start(vsnode, num_frames, core_info.numThreads, callbacks);
 }
 
 
-void CombedFramesCollector::frameDone(void *frame_v, int n, const QString &error_msg) {
-    const VSFrame *frame = (const VSFrame *)frame_v;
-
-    if (aborted) {
-        vsapi->freeFrame(frame);
-    } else {
-        if (frame) {
-            // Extract the _Combed property
-            const VSMap *props = vsapi->getFramePropertiesRO(frame);
-
-            int err;
+int CombedFramesCollector::frameAt(int index) const {
+    return frames.size() ? frames[index] : index;
+}
 
-            if (vsapi->mapGetInt(props, "_Combed", 0, &err))
-                combed_frames.insert(n);
 
-            vsapi->freeFrame(frame);
+int CombedFramesCollector::indexOf(int frame) const {
+    if (!frames.size())
+        return frame;
 
-            // Request another frame
-            if (next_frame < num_frames) {
-                request_count++;
-                vsapi->getFrameAsync(next_frame, vsnode, CombedFramesCollector::frameDoneCallback, (void *)this);
-                next_frame++;
-            }
+    return (int)(std::lower_bound(frames.cbegin(), frames.cend(), frame) - frames.cbegin());
+}
 
-            frames_left--;
 
-            // Send progress updates
-            if (update_timer.elapsed() >= 5000) {
-                update_timer.start();
+void CombedFramesCollector::stop() {
+    requester.stop();
+}
 
-                qint64 elapsed_milliseconds = elapsed_timer.elapsed();
-                double frames_per_second = (double)(num_frames - frames_left) * 1000 / elapsed_milliseconds;
-                int seconds_left = (int)(frames_left / frames_per_second);
-                int minutes_left = seconds_left / 60;
-                seconds_left = seconds_left % 60;
-                int hours_left = minutes_left / 60;
-                minutes_left = minutes_left % 60;
 
-                emit speedUpdate(frames_per_second,
-                                 QStringLiteral("%1:%2:%3")
-                                 .arg(hours_left, 2, 10, QLatin1Char('0'))
-                                 .arg(minutes_left, 2, 10, QLatin1Char('0'))
-                                 .arg(seconds_left, 2, 10, QLatin1Char('0')));
+// Runs in the GUI thread.
+void CombedFramesCollector::reportProgress(int frames) {
+    qint64 elapsed_milliseconds = requester.getElapsedTimer().elapsed();
+    if (!elapsed_milliseconds)
+        return;
 
-                emit progressUpdate(num_frames - frames_left);
-            }
+    int frames_left = num_frames - frames;
+    double frames_per_second = (double)frames * 1000 / elapsed_milliseconds;
+    int seconds_left = (int)(frames_left / frames_per_second);
+    int minutes_left = seconds_left / 60;
+    seconds_left = seconds_left % 60;
+    int hours_left = minutes_left / 60;
+    minutes_left = minutes_left % 60;
+
+    emit speedUpdate(frames_per_second,
+                     QStringLiteral("%1:%2:%3")
+                     .arg(hours_left, 2, 10, QLatin1Char('0'))
+                     .arg(minutes_left, 2, 10, QLatin1Char('0'))
+                     .arg(seconds_left, 2, 10, QLatin1Char('0')));
+
+    emit progressUpdate(frames);
+}
 
-            // Send the final results
-            if (frames_left == 0)
-                emit combedFramesCollected(combed_frames);
-        } else {
-            aborted = true;
 
-            emit errorMessage(QStringLiteral("Combed frames collector: failed to retrieve frame number %1. Error message:\n\n%2").arg(n).arg(error_msg).toUtf8().constData());
-        }
-    }
+// Runs in the GUI thread, after the last request has returned.
+void CombedFramesCollector::finish() {
+    vsapi->freeNode(vsnode);
+    vsnode = nullptr;
 
-    request_count--;
+    if (requester.getFailedFrame() != -1) {
+        QString error = QStringLiteral("Combed frames collector: failed to retrieve frame number %1. Error message:\n\n%2").arg(requester.getFailedFrame()).arg(QString::fromStdString(requester.getError()));
+        emit errorMessage(error.toUtf8().constData());
+    } else if (requester.isComplete()) {
+        // Send the final results
+        std::vector<int> combed;
 
-    // All frames processed, or there was an error.
-    // Either way we're done. This function isn't getting called again.
-    if (request_count == 0) {
-        vsapi->freeNode(vsnode);
+        for (int i = 0; i < num_frames; i++)
+            if (combed_frames[i])
+                combed.push_back(frameAt(i));
 
-        emit workFinished();
+        emit combedFramesCollected(combed);
     }
+
+    emit workFinished();
 }
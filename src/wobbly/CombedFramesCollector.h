@@ -21,14 +21,16 @@ SOFTWARE.
 #ifndef COMBEDFRAMESCOLLECTOR_H
 #define COMBEDFRAMESCOLLECTOR_H
 
-#include <set>
+#include <cstdint>
+#include <vector>
 
 #include <VapourSynth4.h>
 #include <VSScript4.h>
 
-#include <QElapsedTimer>
 #include <QObject>
 
+#include "FrameRequester.h"
+
 class CombedFramesCollector : public QObject {
     Q_OBJECT
 
@@ -38,33 +40,33 @@ class CombedFramesCollector : public QObject {
     VSScript *vsscript;
     VSNode *vsnode;
 
-    bool aborted;
-    int request_count;
-    int next_frame;
+    FrameRequester requester;
     int num_frames;
-    int frames_left;
 
-    QElapsedTimer update_timer;
-    QElapsedTimer elapsed_timer;
+    // The frames to check, or all of them if empty.
+    std::vector<int> frames;
 
-    std::set<int> combed_frames;
+    // One element per requested frame, so the worker threads never write to the same place.
+    std::vector<uint8_t> combed_frames;
 
-    static void VS_CC frameDoneCallback(void *userData, const VSFrame *f, int n, VSNode *, const char *errorMsg);
+    int frameAt(int index) const;
+    int indexOf(int frame) const;
 
 private slots:
-    void frameDone(void *frame_v, int n, const QString &error_msg);
+    void reportProgress(int frames);
+    void finish();
 
 public:
     CombedFramesCollector(const VSSCRIPTAPI *_vssapi, const VSAPI *_vsapi, VSCore *_vscore, VSScript *_vsscript);
 
-    void start(std::string script, const char *script_name);
+    void start(std::string script, const char *script_name, const std::vector<int> &_frames = std::vector<int>());
 
 signals:
     void workFinished();
     void progressUpdate(int frame);
     void speedUpdate(double fps, QString time_left);
     void errorMessage(const char *text);
-    void combedFramesCollected(const std::set<int> &frames);
+    void combedFramesCollected(const std::vector<int> &frames);
 
 public slots:
     void stop();
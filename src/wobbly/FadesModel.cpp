@@ -0,0 +1,69 @@
+/*
+
+Copyright (c) 2015, John Smith
+
+Permission to use, copy, modify, and/or distribute this software for
+any purpose with or without fee is hereby granted, provided that the
+above copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+SOFTWARE.
+
+*/
+
+
+#include "FadesModel.h"
+
+FadesModel::FadesModel(QObject *parent)
+    : RangeVectorModel(parent)
+{
+
+}
+
+
+int FadesModel::columnCount(const QModelIndex &parent) const {
+    if (parent.isValid())
+        return 0;
+
+    return ColumnCount;
+}
+
+
+QVariant FadesModel::data(const QModelIndex &index, int role) const {
+    if (role == Qt::DisplayRole) {
+        const FrameRange &range = rows[index.row()];
+
+        if (index.column() == StartColumn)
+            return QVariant(range.first);
+        else if (index.column() == EndColumn)
+            return QVariant(range.last);
+    } else if (role == Qt::TextAlignmentRole) {
+        return QVariant(int(Qt::AlignRight | Qt::AlignVCenter));
+    }
+
+    return QVariant();
+}
+
+
+QVariant FadesModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    const char *column_headers[ColumnCount] = {
+        "Start",
+        "End"
+    };
+
+    if (role == Qt::DisplayRole) {
+        if (orientation == Qt::Horizontal) {
+            return QVariant(QString(column_headers[section]));
+        } else if (orientation == Qt::Vertical) {
+            return QVariant(section + 1);
+        }
+    }
+
+    return QVariant();
+}
@@ -18,14 +18,110 @@ SOFTWARE.
 */
 
 
+#include <QPainter>
+#include <QPaintEvent>
+#include <QStyle>
+
 #include "FrameLabel.h"
 
 void FrameLabel::setPixmap(const QPixmap &new_pixmap) {
-    QLabel::setPixmap(new_pixmap);
+    m_pixmap = new_pixmap;
+
+    updateDisplayedSize();
+
+    update();
+}
+
 
-    if (m_pixmap_size != new_pixmap.size()) {
-        m_pixmap_size = new_pixmap.size();
+const QPixmap &FrameLabel::getPixmap() const {
+    return m_pixmap;
+}
+
+
+void FrameLabel::setZoom(int zoom) {
+    if (m_zoom == zoom)
+        return;
+
+    m_zoom = zoom;
+
+    updateDisplayedSize();
+
+    update();
+}
+
+
+void FrameLabel::updateDisplayedSize() {
+    QSize new_size = m_pixmap.size() * m_zoom;
+
+    if (m_pixmap_size != new_size) {
+        m_pixmap_size = new_size;
+
+        updateGeometry();
 
         emit pixmapSizeChanged(m_pixmap_size);
     }
 }
+
+
+QSize FrameLabel::sizeHint() const {
+    QMargins margins = contentsMargins();
+
+    return m_pixmap_size + QSize(margins.left() + margins.right(), margins.top() + margins.bottom());
+}
+
+
+QSize FrameLabel::minimumSizeHint() const {
+    return sizeHint();
+}
+
+
+void FrameLabel::setCropOverlay(bool enabled, const QMargins &crop) {
+    if (m_crop_enabled == enabled && m_crop == crop)
+        return;
+
+    m_crop_enabled = enabled;
+    m_crop = crop;
+
+    update();
+}
+
+
+void FrameLabel::paintEvent(QPaintEvent *event) {
+    if (m_pixmap.isNull())
+        return;
+
+    QRect frame_rect = QStyle::alignedRect(layoutDirection(), alignment(), m_pixmap_size, contentsRect());
+
+    QPainter painter(this);
+    painter.setClipRect(event->rect());
+
+    // Only the exposed part of the frame is drawn. The source rectangle is rounded
+    // outwards to whole frame pixels, so every pixel ends up as a zoom x zoom block.
+    QRect exposed = event->rect().intersected(frame_rect).translated(-frame_rect.topLeft());
+    if (!exposed.isEmpty()) {
+        QRect source(exposed.left() / m_zoom,
+                     exposed.top() / m_zoom,
+                     exposed.right() / m_zoom - exposed.left() / m_zoom + 1,
+                     exposed.bottom() / m_zoom - exposed.top() / m_zoom + 1);
+        QRect target(source.topLeft() * m_zoom + frame_rect.topLeft(), source.size() * m_zoom);
+
+        painter.drawPixmap(target, m_pixmap, source);
+    }
+
+    if (!m_crop_enabled)
+        return;
+
+    QRect inside = frame_rect.marginsRemoved(m_crop * m_zoom);
+
+    QColor colour(224, 81, 255);
+
+    if (inside.width() <= 0 || inside.height() <= 0) {
+        painter.fillRect(frame_rect, colour);
+        return;
+    }
+
+    painter.fillRect(QRect(frame_rect.left(), frame_rect.top(), frame_rect.width(), inside.top() - frame_rect.top()), colour);
+    painter.fillRect(QRect(frame_rect.left(), inside.bottom() + 1, frame_rect.width(), frame_rect.bottom() - inside.bottom()), colour);
+    painter.fillRect(QRect(frame_rect.left(), inside.top(), inside.left() - frame_rect.left(), inside.height()), colour);
+    painter.fillRect(QRect(inside.right() + 1, inside.top(), frame_rect.right() - inside.right(), inside.height()), colour);
+}
@@ -22,6 +22,7 @@ SOFTWARE.
 #define FRAMELABEL_H
 
 #include <QLabel>
+#include <QMargins>
 
 
 class FrameLabel : public QLabel {
@@ -30,13 +31,32 @@ class FrameLabel : public QLabel {
 public:
     using QLabel::QLabel;
 
+    // The pixmap is kept at its original size and scaled while painting.
     void setPixmap(const QPixmap &new_pixmap);
+    const QPixmap &getPixmap() const;
+
+    void setZoom(int zoom);
+
+    // Paints over the parts of the frame that would be cropped. In frame pixels.
+    void setCropOverlay(bool enabled, const QMargins &crop);
+
+    QSize sizeHint() const;
+    QSize minimumSizeHint() const;
 
 signals:
+    // The size of the frame on screen, i.e. after zooming.
     void pixmapSizeChanged(QSize new_size);
 
 private:
+    void paintEvent(QPaintEvent *event);
+
+    void updateDisplayedSize();
+
+    QPixmap m_pixmap;
     QSize m_pixmap_size;
+    int m_zoom = 1;
+    bool m_crop_enabled = false;
+    QMargins m_crop;
 };
 
 #endif // FRAMELABEL_H
@@ -0,0 +1,48 @@
+/*
+
+Copyright (c) 2015, John Smith
+
+Permission to use, copy, modify, and/or distribute this software for
+any purpose with or without fee is hereby granted, provided that the
+above copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+SOFTWARE.
+
+*/
+
+
+#include "FrameRatesModel.h"
+#include "FrameRatesProxyModel.h"
+
+FrameRatesProxyModel::FrameRatesProxyModel(QObject *parent)
+    : QSortFilterProxyModel(parent)
+    , shown_rates{}
+{
+
+}
+
+
+bool FrameRatesProxyModel::filterAcceptsRow(int source_row, const QModelIndex &source_parent) const {
+    bool ok;
+    int num_dropped = sourceModel()->data(sourceModel()->index(source_row, FrameRatesModel::FrameRateColumn, source_parent), FrameRatesModel::NumDroppedRole).toInt(&ok);
+    if (!ok || num_dropped < 0 || num_dropped >= (int)shown_rates.size())
+        return true;
+
+    return shown_rates[num_dropped];
+}
+
+
+void FrameRatesProxyModel::setShownRates(const std::array<bool, 5> &rates) {
+    if (rates != shown_rates) {
+        shown_rates = rates;
+
+        invalidateFilter();
+    }
+}
@@ -0,0 +1,44 @@
+/*
+
+Copyright (c) 2015, John Smith
+
+Permission to use, copy, modify, and/or distribute this software for
+any purpose with or without fee is hereby granted, provided that the
+above copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+SOFTWARE.
+
+*/
+
+
+#ifndef FRAMERATESPROXYMODEL_H
+#define FRAMERATESPROXYMODEL_H
+
+#include <array>
+
+#include <QSortFilterProxyModel>
+
+
+// Hides the frame rates that weren't checked.
+class FrameRatesProxyModel : public QSortFilterProxyModel {
+    Q_OBJECT
+
+    std::array<bool, 5> shown_rates;
+
+protected:
+    bool filterAcceptsRow(int source_row, const QModelIndex &source_parent) const;
+
+public:
+    FrameRatesProxyModel(QObject *parent = Q_NULLPTR);
+
+    void setShownRates(const std::array<bool, 5> &rates);
+};
+
+#endif // FRAMERATESPROXYMODEL_H
@@ -0,0 +1,144 @@
+/*
+
+Copyright (c) 2015, John Smith
+
+Permission to use, copy, modify, and/or distribute this software for
+any purpose with or without fee is hereby granted, provided that the
+above copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+SOFTWARE.
+
+*/
+
+
+
+#include <algorithm>
+
+#include "FrameRequester.h"
+
+
+FrameRequester::FrameRequester(const VSAPI *_vsapi)
+    : vsapi(_vsapi)
+    , vsnode(nullptr)
+    , aborted(false)
+    , request_count(0)
+    , next_frame(0)
+    , frames_done(0)
+    , last_update(0)
+    , num_frames(0)
+    , failed_frame(-1)
+{
+
+}
+
+
+void FrameRequester::start(VSNode *node, int _num_frames, int max_requests, const Callbacks &_callbacks) {
+    vsnode = node;
+    num_frames = _num_frames;
+    callbacks = _callbacks;
+
+    int requests = std::min(max_requests, num_frames);
+
+    aborted = false;
+    frames_done = 0;
+    next_frame = requests;
+    last_update = 0;
+    failed_frame = -1;
+    error.clear();
+    elapsed_timer.start();
+
+    if (requests < 1) {
+        callbacks.finished();
+        return;
+    }
+
+    // Count them all first, so the first frames to come back can't see a request count of 0.
+    request_count = requests;
+
+    for (int i = 0; i < requests; i++)
+        vsapi->getFrameAsync(callbacks.frame_at(i), vsnode, FrameRequester::frameDoneCallback, (void *)this);
+}
+
+
+void FrameRequester::stop() {
+    aborted = true;
+}
+
+
+void VS_CC FrameRequester::frameDoneCallback(void *userData, const VSFrame *f, int n, VSNode *, const char *errorMsg) {
+    FrameRequester *requester = (FrameRequester *)userData;
+
+    requester->frameDone(f, n, errorMsg);
+}
+
+
+// Runs in the worker threads.
+void FrameRequester::frameDone(const VSFrame *frame, int n, const char *error_msg) {
+    if (aborted) {
+        vsapi->freeFrame(frame);
+    } else {
+        if (frame) {
+            callbacks.frame_done(frame, n);
+
+            vsapi->freeFrame(frame);
+
+            int next = next_frame++;
+            if (next < num_frames) {
+                ++request_count;
+                vsapi->getFrameAsync(callbacks.frame_at(next), vsnode, FrameRequester::frameDoneCallback, (void *)this);
+            }
+
+            int done = ++frames_done;
+
+            int64_t now = elapsed_timer.elapsed();
+            int64_t previous = last_update;
+            if (now - previous >= progress_interval && last_update.compare_exchange_strong(previous, now) && callbacks.progress)
+                callbacks.progress(done);
+        } else if (!aborted.exchange(true)) {
+            failed_frame = n;
+            error = error_msg ? error_msg : "";
+        }
+    }
+
+    // Whether all the frames were processed or there was an error,
+    // this was the last request still in flight.
+    if (--request_count == 0)
+        callbacks.finished();
+}
+
+
+int FrameRequester::getNumFrames() const {
+    return num_frames;
+}
+
+
+int FrameRequester::getFramesDone() const {
+    return frames_done;
+}
+
+
+bool FrameRequester::isComplete() const {
+    return frames_done == num_frames;
+}
+
+
+int FrameRequester::getFailedFrame() const {
+    return failed_frame;
+}
+
+
+const std::string &FrameRequester::getError() const {
+    return error;
+}
+
+
+const QElapsedTimer &FrameRequester::getElapsedTimer() const {
+    return elapsed_timer;
+}
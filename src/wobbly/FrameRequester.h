@@ -0,0 +1,96 @@
+/*
+
+Copyright (c) 2015, John Smith
+
+Permission to use, copy, modify, and/or distribute this software for
+any purpose with or without fee is hereby granted, provided that the
+above copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+SOFTWARE.
+
+*/
+
+
+
+#ifndef FRAMEREQUESTER_H
+#define FRAMEREQUESTER_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include <VapourSynth4.h>
+
+#include <QElapsedTimer>
+
+
+// Requests a list of frames from a node, keeping as many requests in flight
+// as the core has threads, and hands every frame to the owner as it arrives.
+// The callbacks run in the worker threads.
+class FrameRequester {
+public:
+    struct Callbacks {
+        // Index of the request to frame number.
+        std::function<int (int index)> frame_at;
+        // Gets every frame before it's freed.
+        std::function<void (const VSFrame *frame, int n)> frame_done;
+        // Called at most every progress_interval milliseconds.
+        std::function<void (int frames_done)> progress;
+        // Called once, after the last request has returned. Also when nothing was requested.
+        std::function<void ()> finished;
+    };
+
+private:
+    const VSAPI *vsapi;
+    VSNode *vsnode;
+
+    Callbacks callbacks;
+
+    // Touched by the worker threads.
+    std::atomic<bool> aborted;
+    std::atomic<int> request_count;
+    std::atomic<int> next_frame;
+    std::atomic<int> frames_done;
+    std::atomic<int64_t> last_update;
+    int num_frames;
+
+    // Written once, by the first request that fails.
+    int failed_frame;
+    std::string error;
+
+    QElapsedTimer elapsed_timer;
+
+    static void VS_CC frameDoneCallback(void *userData, const VSFrame *f, int n, VSNode *, const char *errorMsg);
+
+    void frameDone(const VSFrame *frame, int n, const char *error_msg);
+
+public:
+    static const int progress_interval = 250;
+
+    explicit FrameRequester(const VSAPI *_vsapi);
+
+    // The node is not freed here.
+    void start(VSNode *node, int _num_frames, int max_requests, const Callbacks &_callbacks);
+
+    void stop();
+
+    int getNumFrames() const;
+    int getFramesDone() const;
+    bool isComplete() const;
+
+    // -1 if every request succeeded.
+    int getFailedFrame() const;
+    const std::string &getError() const;
+
+    const QElapsedTimer &getElapsedTimer() const;
+};
+
+#endif // FRAMEREQUESTER_H
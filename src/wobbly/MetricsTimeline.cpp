@@ -0,0 +1,361 @@
+/*
+
+Copyright (c) 2018, John Smith
+
+Permission to use, copy, modify, and/or distribute this software for
+any purpose with or without fee is hereby granted, provided that the
+above copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+SOFTWARE.
+
+*/
+
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+#include <QMouseEvent>
+#include <QPainter>
+#include <QPaintEvent>
+#include <QTimer>
+#include <QWheelEvent>
+
+#include "MetricsTimeline.h"
+
+
+#define ROW_HEIGHT 8
+
+
+static void mergeSummary(FrameSummary &a, const FrameSummary &b) {
+    a.min = std::min(a.min, b.min);
+    a.max = std::max(a.max, b.max);
+    a.count += b.count;
+}
+
+
+void SummaryPyramid::resize(int frames) {
+    m_levels.clear();
+    m_levels.emplace_back(frames, FrameSummary{ 0, 0, 0 });
+
+    while (m_levels.back().size() > 1) {
+        size_t blocks = (m_levels.back().size() + 3) / 4;
+        m_levels.emplace_back(blocks, FrameSummary{ 0, 0, 0 });
+    }
+}
+
+
+int SummaryPyramid::size() const {
+    return m_levels.size() ? (int)m_levels[0].size() : 0;
+}
+
+
+void SummaryPyramid::set(int frame, int16_t value) {
+    m_levels[0][frame] = { value, value, value != 0 };
+}
+
+
+void SummaryPyramid::rebuild(int first, int last) {
+    for (size_t level = 1; level < m_levels.size(); level++) {
+        first /= 4;
+        last /= 4;
+
+        const std::vector<FrameSummary> &children = m_levels[level - 1];
+        std::vector<FrameSummary> &blocks = m_levels[level];
+
+        for (int i = first; i <= last; i++) {
+            size_t child = (size_t)i * 4;
+            size_t end = std::min(child + 4, children.size());
+
+            FrameSummary summary = children[child];
+            for (child++; child < end; child++)
+                mergeSummary(summary, children[child]);
+
+            blocks[i] = summary;
+        }
+    }
+}
+
+
+FrameSummary SummaryPyramid::query(int first, int last) const {
+    if (first > last || !size())
+        return { 0, 0, 0 };
+
+    FrameSummary result = { INT16_MAX, INT16_MIN, 0 };
+
+    // Take the unaligned blocks at both ends, then go up a level with the rest.
+    for (size_t level = 0; level < m_levels.size() && first <= last; level++) {
+        const std::vector<FrameSummary> &blocks = m_levels[level];
+
+        if (level == m_levels.size() - 1) {
+            for (int i = first; i <= last; i++)
+                mergeSummary(result, blocks[i]);
+            break;
+        }
+
+        while (first <= last && first % 4)
+            mergeSummary(result, blocks[first++]);
+
+        while (first <= last && (last + 1) % 4 && last != (int)blocks.size() - 1)
+            mergeSummary(result, blocks[last--]);
+
+        if (first > last)
+            break;
+
+        first /= 4;
+        last /= 4;
+    }
+
+    return result;
+}
+
+
+MetricsTimeline::MetricsTimeline(QWidget *parent)
+    : QWidget(parent)
+{
+    setMouseTracking(false);
+    setFocusPolicy(Qt::NoFocus);
+    setToolTip(QStringLiteral("From the top: mics of the current matches, combed frames, frame rate, orphan fields, section starts.\nClick to jump, scroll to zoom."));
+}
+
+
+void MetricsTimeline::setProject(WobblyProject *project) {
+    m_project = project;
+
+    int frames = project ? project->getNumFrames(PostSource) : 0;
+
+    for (int i = 0; i < NumRows; i++)
+        m_rows[i].resize(frames);
+
+    m_dirty.clear();
+    m_view_first = 0;
+    m_view_frames = frames;
+    m_current_frame = 0;
+
+    if (project) {
+        connect(project, &WobblyProject::framesChanged, this, &MetricsTimeline::framesChanged, Qt::UniqueConnection);
+
+        readFrames(0, frames - 1);
+    }
+
+    update();
+}
+
+
+void MetricsTimeline::setCurrentFrame(int frame) {
+    m_current_frame = frame;
+
+    // When zoomed in, keep the current frame in view.
+    if (frame < m_view_first || frame >= m_view_first + m_view_frames)
+        setView(frame - m_view_frames / 2, m_view_frames);
+
+    update();
+}
+
+
+void MetricsTimeline::framesChanged(int first, int last) {
+    if (m_dirty.empty())
+        QTimer::singleShot(0, this, &MetricsTimeline::rebuildDirtyFrames);
+
+    m_dirty.push_back({ first, last });
+}
+
+
+void MetricsTimeline::rebuildDirtyFrames() {
+    if (!m_project) {
+        m_dirty.clear();
+        return;
+    }
+
+    std::sort(m_dirty.begin(), m_dirty.end());
+
+    // Edits usually come in bunches of single frames, often next to each other.
+    int first = m_dirty[0].first;
+    int last = m_dirty[0].second;
+
+    for (size_t i = 1; i < m_dirty.size(); i++) {
+        if (m_dirty[i].first <= last + 1) {
+            last = std::max(last, m_dirty[i].second);
+        } else {
+            readFrames(first, last);
+
+            first = m_dirty[i].first;
+            last = m_dirty[i].second;
+        }
+    }
+
+    readFrames(first, last);
+
+    m_dirty.clear();
+
+    update();
+}
+
+
+void MetricsTimeline::readFrames(int first, int last) {
+    int frames = m_rows[0].size();
+
+    first = std::max(first, 0);
+    last = std::min(last, frames - 1);
+
+    if (first > last)
+        return;
+
+    const char match_chars[] = { 'p', 'c', 'n', 'b', 'u' };
+
+    for (int n = first; n <= last; n++) {
+        char match = m_project->getMatch(n);
+        int match_index = (int)(std::find(match_chars, match_chars + 5, match) - match_chars);
+
+        m_rows[MicsRow].set(n, match_index < 5 ? m_project->getMics(n)[match_index] : 0);
+        m_rows[DecimationRow].set(n, m_project->isDecimatedFrame(n));
+        m_rows[CombedRow].set(n, 0);
+        m_rows[OrphanRow].set(n, 0);
+        m_rows[SectionsRow].set(n, 0);
+    }
+
+    const CombedFramesModel *combed = m_project->getCombedFramesModel();
+    for (auto it = combed->lower_bound(first); it != combed->cend() && *it <= last; it++)
+        m_rows[CombedRow].set(*it, 1);
+
+    const OrphanFieldsModel *orphans = m_project->getOrphanFieldsModel();
+    for (auto it = orphans->lower_bound(first); it != orphans->cend() && it->first <= last; it++)
+        m_rows[OrphanRow].set(it->first, 1);
+
+    const SectionsModel *sections = m_project->getSectionsModel();
+    for (auto it = sections->upper_bound(first - 1); it != sections->cend() && it->first <= last; it++)
+        m_rows[SectionsRow].set(it->first, 1);
+
+    for (int i = 0; i < NumRows; i++)
+        m_rows[i].rebuild(first, last);
+}
+
+
+int MetricsTimeline::frameAt(int x) const {
+    int frame = m_view_first + (int)((int64_t)x * m_view_frames / std::max(1, width()));
+
+    return std::max(0, std::min(frame, m_rows[0].size() - 1));
+}
+
+
+void MetricsTimeline::setView(int first, int frames) {
+    int total = m_rows[0].size();
+
+    // At most one frame per pixel.
+    frames = std::max(std::min(total, width()), std::min(frames, total));
+    first = std::max(0, std::min(first, total - frames));
+
+    m_view_first = first;
+    m_view_frames = frames;
+
+    update();
+}
+
+
+QSize MetricsTimeline::sizeHint() const {
+    return QSize(400, NumRows * ROW_HEIGHT);
+}
+
+
+QSize MetricsTimeline::minimumSizeHint() const {
+    return QSize(50, NumRows * ROW_HEIGHT);
+}
+
+
+void MetricsTimeline::paintEvent(QPaintEvent *event) {
+    QPainter painter(this);
+
+    painter.fillRect(event->rect(), palette().color(QPalette::Base));
+
+    int total = m_rows[0].size();
+    if (!total || !m_view_frames)
+        return;
+
+    int mics_max = std::max<int>(1, m_rows[MicsRow].query(0, total - 1).max);
+
+    QColor mics_colour(74, 163, 223);
+    QColor combed_colour(230, 60, 60);
+    QColor slower_colour(170, 90, 220);
+    QColor faster_colour(80, 200, 120);
+    QColor orphan_colour(240, 200, 60);
+    QColor section_colour(palette().color(QPalette::Text));
+
+    // Every column is a single query per row, whatever the zoom.
+    for (int x = event->rect().left(); x <= event->rect().right(); x++) {
+        int first = frameAt(x);
+        int last = std::max(first, frameAt(x + 1) - 1);
+        if (x + 1 >= width())
+            last = std::min(m_view_first + m_view_frames, total) - 1;
+
+        int frames = last - first + 1;
+
+        FrameSummary mics = m_rows[MicsRow].query(first, last);
+        int height = mics.max * (ROW_HEIGHT - 1) / mics_max;
+        if (height > 0)
+            painter.fillRect(x, MicsRow * ROW_HEIGHT + ROW_HEIGHT - 1 - height, 1, height, mics_colour);
+
+        if (m_rows[CombedRow].query(first, last).count)
+            painter.fillRect(x, CombedRow * ROW_HEIGHT, 1, ROW_HEIGHT - 1, combed_colour);
+
+        // One dropped frame per cycle is 24 fps, which is normal, so only the other rates are shown.
+        double dropped_per_cycle = m_rows[DecimationRow].query(first, last).count * 5.0 / frames;
+        double difference = dropped_per_cycle - 1.0;
+        if (std::abs(difference) > 0.01) {
+            QColor colour = difference > 0 ? slower_colour : faster_colour;
+            colour.setAlphaF(std::min(1.0, std::abs(difference)));
+            painter.fillRect(x, DecimationRow * ROW_HEIGHT, 1, ROW_HEIGHT - 1, colour);
+        }
+
+        if (m_rows[OrphanRow].query(first, last).count)
+            painter.fillRect(x, OrphanRow * ROW_HEIGHT, 1, ROW_HEIGHT - 1, orphan_colour);
+
+        if (m_rows[SectionsRow].query(first, last).count)
+            painter.fillRect(x, SectionsRow * ROW_HEIGHT, 1, ROW_HEIGHT - 1, section_colour);
+    }
+
+    if (m_current_frame >= m_view_first && m_current_frame < m_view_first + m_view_frames) {
+        int x = (int)((int64_t)(m_current_frame - m_view_first) * width() / m_view_frames);
+
+        painter.fillRect(x, 0, 1, height(), palette().color(QPalette::Highlight));
+    }
+}
+
+
+void MetricsTimeline::mousePressEvent(QMouseEvent *event) {
+    if (event->button() == Qt::LeftButton && m_rows[0].size())
+        emit frameClicked(frameAt(event->pos().x()));
+}
+
+
+void MetricsTimeline::mouseMoveEvent(QMouseEvent *event) {
+    if (event->buttons() & Qt::LeftButton && m_rows[0].size())
+        emit frameClicked(frameAt(event->pos().x()));
+}
+
+
+void MetricsTimeline::wheelEvent(QWheelEvent *event) {
+    if (!m_rows[0].size())
+        return;
+
+    int delta = event->angleDelta().y();
+    if (!delta)
+        return;
+
+    // Zoom around the frame under the mouse.
+    int x = (int)event->position().x();
+    int frame = frameAt(x);
+
+    int frames = delta > 0 ? m_view_frames / 2 : m_view_frames * 2;
+    frames = std::max(frames, 1);
+
+    setView(frame - (int)((int64_t)x * frames / std::max(1, width())), frames);
+
+    event->accept();
+}
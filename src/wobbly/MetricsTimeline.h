@@ -0,0 +1,118 @@
+/*
+
+Copyright (c) 2018, John Smith
+
+Permission to use, copy, modify, and/or distribute this software for
+any purpose with or without fee is hereby granted, provided that the
+above copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+SOFTWARE.
+
+*/
+
+
+#ifndef METRICSTIMELINE_H
+#define METRICSTIMELINE_H
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <QPointer>
+#include <QWidget>
+
+#include "WobblyProject.h"
+
+
+struct FrameSummary {
+    int16_t min;
+    int16_t max;
+    int32_t count;  // Frames with a value other than 0.
+};
+
+
+// One value per frame, plus the summaries of blocks of 4, 16, 64... frames,
+// so the summary of any range only needs a few nodes from each level.
+class SummaryPyramid {
+    std::vector<std::vector<FrameSummary> > m_levels;
+
+public:
+    void resize(int frames);
+    int size() const;
+
+    // Only changes the frame. Call rebuild afterwards.
+    void set(int frame, int16_t value);
+
+    // Recomputes the blocks containing these frames.
+    void rebuild(int first, int last);
+
+    FrameSummary query(int first, int last) const;
+};
+
+
+// Shows where the interesting frames are in the whole video, one row per kind:
+// mics of the current matches, combed frames, decimation, orphan fields, and section starts.
+class MetricsTimeline : public QWidget {
+    Q_OBJECT
+
+public:
+    explicit MetricsTimeline(QWidget *parent = nullptr);
+
+    void setProject(WobblyProject *project);
+
+    void setCurrentFrame(int frame);
+
+    QSize sizeHint() const;
+    QSize minimumSizeHint() const;
+
+signals:
+    void frameClicked(int frame);
+
+public slots:
+    void framesChanged(int first, int last);
+
+private slots:
+    void rebuildDirtyFrames();
+
+private:
+    enum Row {
+        MicsRow,
+        CombedRow,
+        DecimationRow,
+        OrphanRow,
+        SectionsRow,
+        NumRows
+    };
+
+    void paintEvent(QPaintEvent *event);
+    void mousePressEvent(QMouseEvent *event);
+    void mouseMoveEvent(QMouseEvent *event);
+    void wheelEvent(QWheelEvent *event);
+
+    void readFrames(int first, int last);
+
+    int frameAt(int x) const;
+    void setView(int first, int frames);
+
+    QPointer<WobblyProject> m_project;
+
+    SummaryPyramid m_rows[NumRows];
+
+    // Ranges of frames to read again from the project, in no particular order.
+    std::vector<std::pair<int, int> > m_dirty;
+
+    int m_current_frame = 0;
+
+    // The frames shown, from all of them down to one per pixel.
+    int m_view_first = 0;
+    int m_view_frames = 0;
+};
+
+#endif // METRICSTIMELINE_H
@@ -0,0 +1,128 @@
+/*
+
+Copyright (c) 2015, John Smith
+
+Permission to use, copy, modify, and/or distribute this software for
+any purpose with or without fee is hereby granted, provided that the
+above copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+SOFTWARE.
+
+*/
+
+
+#include "ProjectLoader.h"
+
+
+ProjectLoader::ProjectLoader(const VSSCRIPTAPI *_vssapi, VSScript *_vsscript, const std::string &_path)
+    : vssapi(_vssapi)
+    , vsscript(_vsscript)
+    , path(_path)
+    , project(new WobblyProject(true))
+    , aborted(false)
+    , running_threads(0)
+{
+
+}
+
+
+ProjectLoader::~ProjectLoader() {
+    if (read_thread.joinable())
+        read_thread.join();
+
+    if (source_thread.joinable())
+        source_thread.join();
+
+    delete project;
+}
+
+
+void ProjectLoader::start() {
+    // The previous project's source must not be picked up by the new project.
+    vssapi->evaluateBuffer(vsscript, "vs.clear_output(1)", "wobbly.cleanup");
+
+    running_threads = 1;
+
+    read_thread = std::thread([this] () {
+        ReadProjectCallbacks callbacks;
+
+        // Runs in read_thread, which doesn't touch these fields again.
+        callbacks.header_read = [this] () {
+            std::string script = project->generateSourceScript();
+
+            ++running_threads;
+
+            source_thread = std::thread([this, script] () {
+                // Any error will come up again when the main display script is evaluated.
+                vssapi->evalSetWorkingDir(vsscript, 1);
+                vssapi->evaluateBuffer(vsscript, script.c_str(), path.c_str());
+
+                threadFinished();
+            });
+        };
+
+        callbacks.progress = [this] (int step, int steps) {
+            QMetaObject::invokeMethod(this, "reportProgress", Qt::QueuedConnection, Q_ARG(int, step), Q_ARG(int, steps));
+
+            return !aborted;
+        };
+
+        try {
+            project->readProject(path, callbacks);
+        } catch (WobblyException &e) {
+            if (!aborted)
+                error = e.what();
+        }
+
+        threadFinished();
+    });
+}
+
+
+void ProjectLoader::stop() {
+    aborted = true;
+}
+
+
+// Runs in the worker threads.
+void ProjectLoader::threadFinished() {
+    if (--running_threads == 0)
+        QMetaObject::invokeMethod(this, "finish", Qt::QueuedConnection);
+}
+
+
+// Runs in the GUI thread.
+void ProjectLoader::reportProgress(int step, int steps) {
+    emit progressUpdate(step, steps);
+}
+
+
+// Runs in the GUI thread, after both threads are done.
+void ProjectLoader::finish() {
+    read_thread.join();
+
+    if (source_thread.joinable())
+        source_thread.join();
+
+    if (aborted || !error.isEmpty()) {
+        // The source at output index 1 belongs to the project that wasn't loaded.
+        vssapi->evaluateBuffer(vsscript, "vs.clear_output(1)", "wobbly.cleanup");
+
+        if (!error.isEmpty())
+            emit errorMessage(error.toUtf8().constData());
+    } else {
+        WobblyProject *loaded = project;
+        project = nullptr;
+
+        emit projectLoaded(loaded);
+    }
+
+    emit workFinished();
+}
@@ -0,0 +1,83 @@
+/*
+
+Copyright (c) 2015, John Smith
+
+Permission to use, copy, modify, and/or distribute this software for
+any purpose with or without fee is hereby granted, provided that the
+above copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+SOFTWARE.
+
+*/
+
+
+#ifndef PROJECTLOADER_H
+#define PROJECTLOADER_H
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include <VapourSynth4.h>
+#include <VSScript4.h>
+
+#include <QObject>
+
+#include "WobblyProject.h"
+
+
+// Reads a project in a worker thread. As soon as the project's source is known,
+// a second thread opens it in the script's core, so the source filter's indexing
+// happens while the rest of the project is still being parsed.
+class ProjectLoader : public QObject {
+    Q_OBJECT
+
+    const VSSCRIPTAPI *vssapi;
+    VSScript *vsscript;
+
+    std::string path;
+
+    // Detached from the user interface until it's fully read.
+    WobblyProject *project;
+
+    std::thread read_thread;
+    std::thread source_thread;
+
+    // Touched by the worker threads.
+    std::atomic<bool> aborted;
+    std::atomic<int> running_threads;
+
+    QString error;
+
+    void threadFinished();
+
+private slots:
+    void reportProgress(int step, int steps);
+    void finish();
+
+public:
+    // Nothing else may use the script until workFinished is emitted.
+    ProjectLoader(const VSSCRIPTAPI *_vssapi, VSScript *_vsscript, const std::string &_path);
+    ~ProjectLoader();
+
+    void start();
+
+signals:
+    void workFinished();
+    void progressUpdate(int step, int steps);
+    void errorMessage(const char *text);
+    // The receiver takes ownership of the project.
+    void projectLoaded(WobblyProject *project);
+
+public slots:
+    void stop();
+};
+
+#endif // PROJECTLOADER_H
@@ -0,0 +1,319 @@
+/*
+
+Copyright (c) 2015, John Smith
+
+Permission to use, copy, modify, and/or distribute this software for
+any purpose with or without fee is hereby granted, provided that the
+above copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+SOFTWARE.
+
+*/
+
+
+// The node dependencies and filter times are only declared with this.
+// It must come before the first inclusion of VapourSynth4.h.
+#define VS_GRAPH_API
+
+#include <algorithm>
+#include <format>
+#include <unordered_set>
+
+#include "rapidjson/prettywriter.h"
+#include "rapidjson/stringbuffer.h"
+
+#include "ScriptProfiler.h"
+
+
+ScriptProfiler::ScriptProfiler(const VSSCRIPTAPI *_vssapi, const VSAPI *_vsapi, VSCore *_vscore, VSScript *_vsscript)
+    : vssapi(_vssapi)
+    , vsapi(_vsapi)
+    , vscore(_vscore)
+    , vsscript(_vsscript)
+    , vsnode(nullptr)
+    , requester(_vsapi)
+    , first_frame(0)
+    , num_frames(0)
+    , node_timing_was_enabled(false)
+{
+
+}
+
+
+static void collectUpstreamNodes(const VSAPI *vsapi, VSNode *node, std::unordered_set<VSNode *> &upstream) {
+    std::vector<VSNode *> stack = { node };
+
+    while (stack.size()) {
+        VSNode *current = stack.back();
+        stack.pop_back();
+
+        if (!upstream.insert(current).second)
+            continue;
+
+        const VSFilterDependency *deps = vsapi->getNodeDependencies(current);
+        int num_deps = vsapi->getNumNodeDependencies(current);
+
+        for (int i = 0; i < num_deps; i++)
+            stack.push_back(deps[i].source);
+    }
+}
+
+
+// Runs in the GUI thread, right after the script was evaluated.
+void ScriptProfiler::collectNodes() {
+    std::unordered_set<VSNode *> all_nodes;
+    collectUpstreamNodes(vsapi, vsnode, all_nodes);
+
+    nodes.clear();
+    for (VSNode *node : all_nodes)
+        nodes[node] = { vsapi->getNodeFilterTime(node), std::string() };
+
+    // A preset created the nodes upstream of its output but not upstream of its input.
+    VSMap *names = vsapi->createMap();
+    VSMap *inputs = vsapi->createMap();
+    VSMap *outputs = vsapi->createMap();
+
+    if (!vssapi->getVariable(vsscript, "wobbly_profile_names", names) &&
+        !vssapi->getVariable(vsscript, "wobbly_profile_inputs", inputs) &&
+        !vssapi->getVariable(vsscript, "wobbly_profile_outputs", outputs)) {
+        int calls = vsapi->mapNumElements(names, "wobbly_profile_names");
+
+        for (int i = 0; i < calls; i++) {
+            std::string name = vsapi->mapGetData(names, "wobbly_profile_names", i, nullptr);
+            VSNode *input = vsapi->mapGetNode(inputs, "wobbly_profile_inputs", i, nullptr);
+            VSNode *output = vsapi->mapGetNode(outputs, "wobbly_profile_outputs", i, nullptr);
+
+            std::unordered_set<VSNode *> before;
+            collectUpstreamNodes(vsapi, input, before);
+
+            std::unordered_set<VSNode *> after;
+            collectUpstreamNodes(vsapi, output, after);
+
+            for (VSNode *node : after) {
+                auto it = nodes.find(node);
+                if (!before.count(node) && it != nodes.end() && it->second.preset.empty())
+                    it->second.preset = name;
+            }
+
+            vsapi->freeNode(input);
+            vsapi->freeNode(output);
+        }
+    }
+
+    vsapi->freeMap(names);
+    vsapi->freeMap(inputs);
+    vsapi->freeMap(outputs);
+}
+
+
+void ScriptProfiler::start(const std::string &script, const char *script_name, int first, int last) {
+    vssapi->evalSetWorkingDir(vsscript, 1);
+    if (vssapi->evaluateBuffer(vsscript, script.c_str(), script_name)) {
+        QString error_message = vssapi->getError(vsscript);
+        // The traceback is mostly unnecessary noise.
+        int traceback = error_message.indexOf(QStringLiteral("Traceback"));
+        if (traceback != -1)
+            error_message.insert(traceback, '\n');
+
+        emit errorMessage(QStringLiteral("Failed to evaluate final script. Error message:\n%1").arg(error_message).toUtf8().constData());
+        emit workFinished();
+        return;
+    }
+
+    vsnode = vssapi->getOutputNode(vsscript, 0);
+    if (!vsnode) {
+        emit errorMessage("Final script evaluated successfully, but no node found at output index 0.");
+        emit workFinished();
+        return;
+    }
+
+    int clip_frames = vsapi->getVideoInfo(vsnode)->numFrames;
+    first = std::clamp(first, 0, clip_frames - 1);
+    last = std::clamp(last, first, clip_frames - 1);
+
+    first_frame = first;
+    num_frames = last - first + 1;
+
+    collectNodes();
+
+    node_timing_was_enabled = vsapi->getCoreNodeTiming(vscore);
+    vsapi->setCoreNodeTiming(vscore, 1);
+
+    VSCoreInfo core_info;
+    vsapi->getCoreInfo(vscore, &core_info);
+
+    FrameRequester::Callbacks callbacks;
+
+    callbacks.frame_at = [this] (int index) {
+        return first_frame + index;
+    };
+
+    // Only the time the filters take is of interest, not the frames.
+    callbacks.frame_done = [] (const VSFrame *, int) {
+    };
+
+    callbacks.progress = [this] (int done) {
+        QMetaObject::invokeMethod(this, "reportProgress", Qt::QueuedConnection, Q_ARG(int, done));
+    };
+
+    callbacks.finished = [this] () {
+        QMetaObject::invokeMethod(this, "finish", Qt::QueuedConnection);
+    };
+
+    requester.start(vsnode, num_frames, core_info.numThreads, callbacks);
+}
+
+
+void ScriptProfiler::stop() {
+    requester.stop();
+}
+
+
+// Runs in the GUI thread.
+void ScriptProfiler::reportProgress(int frames) {
+    emit progressUpdate(frames);
+}
+
+
+// Runs in the GUI thread, after the last request has returned.
+void ScriptProfiler::finish() {
+    ScriptProfile profile;
+    profile.first_frame = first_frame;
+    profile.last_frame = first_frame + num_frames - 1;
+    profile.wall_nanoseconds = requester.getElapsedTimer().nsecsElapsed();
+    profile.total_nanoseconds = 0;
+
+    std::map<std::pair<std::string, std::string>, ProfiledFilter> filters;
+
+    for (auto it = nodes.cbegin(); it != nodes.cend(); it++) {
+        int64_t nanoseconds = vsapi->getNodeFilterTime(it->first) - it->second.start_time;
+        std::string name = vsapi->getNodeName(it->first);
+
+        ProfiledFilter &filter = filters[{ it->second.preset, name }];
+        filter.name = name;
+        filter.preset = it->second.preset;
+        filter.nodes++;
+        filter.nanoseconds += nanoseconds;
+
+        profile.total_nanoseconds += nanoseconds;
+
+        if (it->second.preset.size()) {
+            ProfiledPreset &preset = profile.presets[it->second.preset];
+            preset.nanoseconds += nanoseconds;
+            preset.frames = 0;
+        }
+    }
+
+    nodes.clear();
+
+    vsapi->setCoreNodeTiming(vscore, node_timing_was_enabled);
+
+    vsapi->freeNode(vsnode);
+    vsnode = nullptr;
+
+    for (auto it = filters.cbegin(); it != filters.cend(); it++)
+        profile.filters.push_back(it->second);
+
+    std::sort(profile.filters.begin(), profile.filters.end(), [] (const ProfiledFilter &a, const ProfiledFilter &b) {
+        return a.nanoseconds > b.nanoseconds;
+    });
+
+    if (requester.getFailedFrame() != -1) {
+        QString error = QStringLiteral("Profiler: failed to retrieve frame number %1. Error message:\n\n%2").arg(requester.getFailedFrame()).arg(QString::fromStdString(requester.getError()));
+        emit errorMessage(error.toUtf8().constData());
+    } else if (requester.isComplete()) {
+        emit profileCollected(profile);
+    }
+
+    emit workFinished();
+}
+
+
+std::string ScriptProfiler::profileToJSON(const ScriptProfile &profile) {
+    rapidjson::StringBuffer buffer;
+    rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+
+    writer.StartObject();
+
+    writer.Key("first frame");
+    writer.Int(profile.first_frame);
+
+    writer.Key("last frame");
+    writer.Int(profile.last_frame);
+
+    writer.Key("wall time (ms)");
+    writer.Double(profile.wall_nanoseconds / 1e6);
+
+    writer.Key("filter time (ms)");
+    writer.Double(profile.total_nanoseconds / 1e6);
+
+    writer.Key("presets");
+    writer.StartArray();
+    for (auto it = profile.presets.cbegin(); it != profile.presets.cend(); it++) {
+        writer.StartObject();
+        writer.Key("name");
+        writer.String(it->first.c_str(), (rapidjson::SizeType)it->first.size());
+        writer.Key("time (ms)");
+        writer.Double(it->second.nanoseconds / 1e6);
+        writer.Key("frames");
+        writer.Int(it->second.frames);
+        writer.EndObject();
+    }
+    writer.EndArray();
+
+    writer.Key("filters");
+    writer.StartArray();
+    for (size_t i = 0; i < profile.filters.size(); i++) {
+        const ProfiledFilter &filter = profile.filters[i];
+
+        writer.StartObject();
+        writer.Key("name");
+        writer.String(filter.name.c_str(), (rapidjson::SizeType)filter.name.size());
+        writer.Key("preset");
+        writer.String(filter.preset.c_str(), (rapidjson::SizeType)filter.preset.size());
+        writer.Key("nodes");
+        writer.Int(filter.nodes);
+        writer.Key("time (ms)");
+        writer.Double(filter.nanoseconds / 1e6);
+        writer.EndObject();
+    }
+    writer.EndArray();
+
+    writer.EndObject();
+
+    return std::string(buffer.GetString(), buffer.GetSize());
+}
+
+
+std::string ScriptProfiler::profileToCSV(const ScriptProfile &profile) {
+    auto quote = [] (const std::string &text) {
+        std::string quoted = "\"";
+        for (char c : text) {
+            if (c == '"')
+                quoted += '"';
+            quoted += c;
+        }
+        return quoted + "\"";
+    };
+
+    // Presets first, with an empty filter name, then every filter.
+    std::string csv = "filter,preset,nodes,frames,time (ms)\n";
+
+    for (auto it = profile.presets.cbegin(); it != profile.presets.cend(); it++)
+        csv += std::format(",{},,{},{:.3f}\n", quote(it->first), it->second.frames, it->second.nanoseconds / 1e6);
+
+    for (size_t i = 0; i < profile.filters.size(); i++) {
+        const ProfiledFilter &filter = profile.filters[i];
+
+        csv += std::format("{},{},{},,{:.3f}\n", quote(filter.name), quote(filter.preset), filter.nodes, filter.nanoseconds / 1e6);
+    }
+
+    return csv;
+}
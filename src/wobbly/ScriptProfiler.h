@@ -0,0 +1,113 @@
+/*
+
+Copyright (c) 2015, John Smith
+
+Permission to use, copy, modify, and/or distribute this software for
+any purpose with or without fee is hereby granted, provided that the
+above copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+SOFTWARE.
+
+*/
+
+
+#ifndef SCRIPTPROFILER_H
+#define SCRIPTPROFILER_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <VapourSynth4.h>
+#include <VSScript4.h>
+
+#include <QObject>
+
+#include "FrameRequester.h"
+
+
+struct ProfiledFilter {
+    std::string name;
+    std::string preset;     // Empty if the filter isn't created by a preset.
+    int nodes;              // Filters with the same name in the same preset are counted together.
+    int64_t nanoseconds;
+};
+
+
+struct ProfiledPreset {
+    int64_t nanoseconds;    // Sum of the preset's filters.
+    int frames;             // Frames of the range that go through the preset. Filled in by the caller.
+};
+
+
+struct ScriptProfile {
+    int first_frame;
+    int last_frame;
+    int64_t wall_nanoseconds;
+    int64_t total_nanoseconds;                  // Sum of all the filters.
+    std::vector<ProfiledFilter> filters;        // Slowest first.
+    std::map<std::string, ProfiledPreset> presets;
+};
+
+
+// Runs the final script over a range of frames with the core's node timing
+// enabled, and works out how much time each filter and each preset took.
+class ScriptProfiler : public QObject {
+    Q_OBJECT
+
+    const VSSCRIPTAPI *vssapi;
+    const VSAPI *vsapi;
+    VSCore *vscore;
+    VSScript *vsscript;
+    VSNode *vsnode;
+
+    FrameRequester requester;
+
+    int first_frame;
+    int num_frames;
+
+    bool node_timing_was_enabled;
+
+    // Every node in the graph, with its filter time before the run,
+    // and the preset that created it, if any.
+    struct NodeInfo {
+        int64_t start_time;
+        std::string preset;
+    };
+    std::unordered_map<VSNode *, NodeInfo> nodes;
+
+    void collectNodes();
+
+private slots:
+    void reportProgress(int frames);
+    void finish();
+
+public:
+    ScriptProfiler(const VSSCRIPTAPI *_vssapi, const VSAPI *_vsapi, VSCore *_vscore, VSScript *_vsscript);
+
+    // The script must be generated with FinalScriptFormat::profile_presets.
+    void start(const std::string &script, const char *script_name, int first, int last);
+
+    static std::string profileToJSON(const ScriptProfile &profile);
+    static std::string profileToCSV(const ScriptProfile &profile);
+
+signals:
+    void workFinished();
+    void progressUpdate(int frame);
+    void errorMessage(const char *text);
+    void profileCollected(const ScriptProfile &profile);
+
+public slots:
+    void stop();
+};
+
+#endif // SCRIPTPROFILER_H
@@ -19,6 +19,9 @@ SOFTWARE.
 */
 
 
+#include <algorithm>
+#include <memory>
+
 #include <QApplication>
 #include <QButtonGroup>
 #include <QComboBox>
@@ -47,6 +50,7 @@ SOFTWARE.
 
 #include "CombedFramesCollector.h"
 #include "ProgressDialog.h"
+#include "ProjectLoader.h"
 #include "RandomStuff.h"
 #include "ScrollArea.h"
 #include "WobblyException.h"
@@ -74,8 +78,11 @@ SOFTWARE.
 #define KEY_KEYS                            QStringLiteral("user_interface/keys/")
 
 #define KEY_COMPACT_PROJECT_FILES           QStringLiteral("projects/compact_project_files")
+#define KEY_COMPRESS_PROJECT_FILES          QStringLiteral("projects/compress_project_files")
+#define KEY_JOURNAL_COMPACTION_EDITS        QStringLiteral("projects/journal_compaction_edits")
 #define KEY_USE_RELATIVE_PATHS              QStringLiteral("projects/use_relative_paths")
 #define KEY_DECIMATION_FUNCTION             QStringLiteral("projects/decimation_function")
+#define KEY_USE_WOBBLY_PLUGIN               QStringLiteral("projects/use_wobbly_plugin")
 
 
 struct CallbackData {
@@ -95,6 +102,23 @@ struct CallbackData {
 };
 
 
+struct PlaybackCallbackData {
+    WobblyWindow *window;
+    VSNode *node;
+    int generation;
+    const VSAPI *vsapi;
+
+    PlaybackCallbackData(WobblyWindow *_window, VSNode *_node, int _generation, const VSAPI *_vsapi)
+        : window(_window)
+        , node(_node)
+        , generation(_generation)
+        , vsapi(_vsapi)
+    {
+
+    }
+};
+
+
 WobblyWindow::WobblyWindow()
     : QMainWindow()
     , splash_image(720, 480, QImage::Format_RGB32)
@@ -105,19 +129,13 @@ WobblyWindow::WobblyWindow()
     , settings(QApplication::applicationDirPath() + "/wobbly.ini", QSettings::IniFormat)
 #endif
 {
+    startup_timer.start();
+
     createUI();
 
     readSettings();
 
-    try {
-        initialiseVapourSynth();
-    } catch (WobblyException &e) {
-        show();
-        errorPopup(e.what());
-        exit(1);
-    }
-
-    createPluginWindow();
+    startVapourSynthInitialisation();
 }
 
 
@@ -173,12 +191,18 @@ void WobblyWindow::readSettings() {
 
     settings_compact_projects_check->setChecked(settings.value(KEY_COMPACT_PROJECT_FILES, false).toBool());
 
+    settings_compress_projects_check->setChecked(settings.value(KEY_COMPRESS_PROJECT_FILES, false).toBool());
+
+    settings_journal_compaction_spin->setValue(settings.value(KEY_JOURNAL_COMPACTION_EDITS, 0).toInt());
+
     settings_use_relative_paths_check->setChecked(settings.value(KEY_USE_RELATIVE_PATHS, false).toBool());
 
     settings_bookmark_description_check->setChecked(settings.value(KEY_ASK_FOR_BOOKMARK_DESCRIPTION, true).toBool());
 
     settings_decimation_function_combo->setCurrentText(settings.value(KEY_DECIMATION_FUNCTION, "Auto").toString());
 
+    settings_use_wobbly_plugin_check->setChecked(settings.value(KEY_USE_WOBBLY_PLUGIN, false).toBool());
+
     settings_colormatrix_combo->setCurrentText(settings.value(KEY_COLORMATRIX, "BT 601").toString());
 
     settings_cache_spin->setValue(settings.value(KEY_MAXIMUM_CACHE_SIZE, 4096).toInt());
@@ -240,7 +264,12 @@ void WobblyWindow::closeEvent(QCloseEvent *event) {
 
     writeSettings();
 
-    cleanUpVapourSynth();
+    // Python can't be interrupted while it's starting up.
+    if (vs_init_thread.joinable())
+        vs_init_thread.join();
+
+    if (vs_ready)
+        cleanUpVapourSynth();
 
     if (project) {
         delete project;
@@ -449,6 +478,7 @@ void WobblyWindow::createShortcuts() {
         { "", "",                   "Show or hide combed frames window", &WobblyWindow::showHideCombedFramesWindow },
         { "", "",                   "Show or hide orphan fields window", &WobblyWindow::showHideOrphanFieldsWindow },
         { "", "",                   "Show or hide bookmarks window", &WobblyWindow::showHideBookmarksWindow },
+        { "", "",                   "Show or hide edited frames window", &WobblyWindow::showHideEditedFramesWindow },
 
         { "", "",                   "Show or hide frame details printed on the video", &WobblyWindow::showHideFrameDetailsOnVideo },
 
@@ -473,6 +503,9 @@ void WobblyWindow::createShortcuts() {
         { "", "G",                  "Jump to specific frame", &WobblyWindow::jumpToFrame },
         { "", "Shift+Up",           "Jump to next combed frame", &WobblyWindow::jumpToNextCombedFrame },
         { "", "Shift+Down",         "Jump to previous combed frame", &WobblyWindow::jumpToPreviousCombedFrame },
+        { "", "",                   "Jump to next frame that doesn't follow the match pattern", &WobblyWindow::jumpToNextPatternMismatch },
+        { "", "",                   "Jump to next range of edited matches or decimation", &WobblyWindow::jumpToNextEditedRange },
+        { "", "",                   "Jump to previous range of edited matches or decimation", &WobblyWindow::jumpToPreviousEditedRange },
         { "", "Alt+Up",             "Jump to next section with pattern failure", &WobblyWindow::jumpToNextPatternFailureSection },
         { "", "Alt+Down",           "Jump to previous section with pattern failure", &WobblyWindow::jumpToPreviousPatternFailureSection },
         { "", "S",                  "Cycle the current frame's match", &WobblyWindow::cycleMatchCNB },
@@ -493,6 +526,7 @@ void WobblyWindow::createShortcuts() {
         { "", "",                   "Set decimation pattern to range", &WobblyWindow::setDecimationPattern },
         { "", "",                   "Set match and decimation patterns to range", &WobblyWindow::setMatchAndDecimationPatterns },
         { "", "F5",                 "Toggle preview mode", &WobblyWindow::togglePreview },
+        { "", "Space",              "Play or pause", &WobblyWindow::togglePlayback },
         { "", "Ctrl+Num++",         "Zoom in", &WobblyWindow::zoomIn },
         { "", "Ctrl+Num+-",         "Zoom out", &WobblyWindow::zoomOut },
         { "", "",                   "Guess current section's patterns from matches", &WobblyWindow::guessCurrentSectionPatternsFromMatches },
@@ -663,27 +697,43 @@ void WobblyWindow::createCropAssistant() {
 
         project->setCropEnabled(checked);
 
-        try {
-            evaluateScript(preview);
-        } catch (WobblyException &) {
+        updateCropOverlay();
+
+        if (preview) {
+            try {
+                evaluateFinalScript();
+            } catch (WobblyException &) {
 
+            }
         }
     });
 
+    // The source tab only needs the overlay. The preview is updated
+    // once the new value is committed, not for every step of the spin box.
     auto cropChanged = [this] () {
         if (!project)
             return;
 
         project->setCrop(crop_spin[0]->value(), crop_spin[1]->value(), crop_spin[2]->value(), crop_spin[3]->value());
 
+        updateCropOverlay();
+    };
+
+    auto cropCommitted = [this] () {
+        if (!project || !preview)
+            return;
+
         try {
-            evaluateScript(preview);
+            evaluateFinalScript();
         } catch (WobblyException &) {
 
         }
     };
-    for (int i = 0; i < 4; i++)
+
+    for (int i = 0; i < 4; i++) {
         connect(crop_spin[i], static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), cropChanged);
+        connect(crop_spin[i], &QSpinBox::editingFinished, cropCommitted);
+    }
 
     connect(crop_early_check, &QCheckBox::clicked, [this] (bool checked) {
         if (!project)
@@ -1961,8 +2011,10 @@ void WobblyWindow::createFrameRatesViewer() {
     for (int i = 0; i < 5; i++)
         frame_rates_buttons->addButton(new QCheckBox(rates[i] + QStringLiteral(" fps")), i);
 
-    frame_rates_table = new TableWidget(0, 4, this);
-    frame_rates_table->setHorizontalHeaderLabels({ "Start", "End", "Frame rate", "Length" });
+    frame_rates_proxy_model = new FrameRatesProxyModel(this);
+
+    frame_rates_view = new TableView;
+    frame_rates_view->setModel(frame_rates_proxy_model);
 
 
     connect(frame_rates_buttons, static_cast<void (QButtonGroup::*)(int)>(&QButtonGroup::idClicked), [this] () {
@@ -1975,14 +2027,13 @@ void WobblyWindow::createFrameRatesViewer() {
 
         project->setShownFrameRates(shown_rates);
 
-        updateFrameRatesViewer();
+        frame_rates_proxy_model->setShownRates(shown_rates);
     });
 
 
-    connect(frame_rates_table, &TableWidget::cellDoubleClicked, [this] (int row) {
-        QTableWidgetItem *item = frame_rates_table->item(row, 0);
+    connect(frame_rates_view, &TableView::doubleClicked, [this] (const QModelIndex &index) {
         bool ok;
-        int frame = item->text().toInt(&ok);
+        int frame = index.sibling(index.row(), FrameRatesModel::StartColumn).data().toInt(&ok);
         if (ok)
             requestFrames(frame);
     });
@@ -2000,21 +2051,14 @@ void WobblyWindow::createFrameRatesViewer() {
 
     QVBoxLayout *vbox = new QVBoxLayout;
     vbox->addLayout(hbox);
-    vbox->addWidget(frame_rates_table);
+    vbox->addWidget(frame_rates_view);
 
 
     QWidget *frame_rates_widget = new QWidget;
     frame_rates_widget->setLayout(vbox);
 
 
-    frame_rates_dock = new DockWidget("Frame rates", this);
-    frame_rates_dock->setObjectName("frame rates viewer");
-    frame_rates_dock->setVisible(false);
-    frame_rates_dock->setFloating(true);
     frame_rates_dock->setWidget(frame_rates_widget);
-    addDockWidget(Qt::RightDockWidgetArea, frame_rates_dock);
-    tools_menu->addAction(frame_rates_dock->toggleViewAction());
-    connect(frame_rates_dock, &DockWidget::visibilityChanged, frame_rates_dock, &DockWidget::setEnabled);
 }
 
 
@@ -2420,8 +2464,7 @@ void WobblyWindow::createCMatchSequencesWindow() {
     c_match_minimum_spin->setPrefix(QStringLiteral("Minimum: "));
     c_match_minimum_spin->setSuffix(QStringLiteral(" frames"));
 
-    c_match_sequences_table = new TableWidget(0, 2, this);
-    c_match_sequences_table->setHorizontalHeaderLabels({ "Start", "Length" });
+    c_match_sequences_view = new TableView;
 
 
     connect(c_match_minimum_spin, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), [this] (int value) {
@@ -2433,10 +2476,9 @@ void WobblyWindow::createCMatchSequencesWindow() {
         updateCMatchSequencesWindow();
     });
 
-    connect(c_match_sequences_table, &TableWidget::cellDoubleClicked, [this] (int row) {
-        QTableWidgetItem *item = c_match_sequences_table->item(row, 0);
+    connect(c_match_sequences_view, &TableView::doubleClicked, [this] (const QModelIndex &index) {
         bool ok;
-        int frame = item->text().toInt(&ok);
+        int frame = index.sibling(index.row(), CMatchSequencesModel::StartColumn).data().toInt(&ok);
         if (ok)
             requestFrames(frame);
     });
@@ -2449,21 +2491,14 @@ void WobblyWindow::createCMatchSequencesWindow() {
     QVBoxLayout *vbox = new QVBoxLayout;
     vbox->addLayout(hbox);
 
-    vbox->addWidget(c_match_sequences_table);
+    vbox->addWidget(c_match_sequences_view);
 
 
     QWidget *c_match_sequences_widget = new QWidget;
     c_match_sequences_widget->setLayout(vbox);
 
 
-    c_match_sequences_dock = new DockWidget("C match sequences", this);
-    c_match_sequences_dock->setObjectName("c match sequences window");
-    c_match_sequences_dock->setVisible(false);
-    c_match_sequences_dock->setFloating(true);
     c_match_sequences_dock->setWidget(c_match_sequences_widget);
-    addDockWidget(Qt::RightDockWidgetArea, c_match_sequences_dock);
-    tools_menu->addAction(c_match_sequences_dock->toggleViewAction());
-    connect(c_match_sequences_dock, &DockWidget::visibilityChanged, c_match_sequences_dock, &DockWidget::setEnabled);
 }
 
 
@@ -2474,8 +2509,10 @@ void WobblyWindow::createFadesWindow() {
     fades_gaps_spin->setPrefix(QStringLiteral("Ignore gaps of "));
     fades_gaps_spin->setSuffix(QStringLiteral(" frames or fewer"));
 
-    fades_table = new TableWidget(0, 2, this);
-    fades_table->setHorizontalHeaderLabels({ "Start", "End" });
+    fades_model = new FadesModel(this);
+
+    fades_view = new TableView;
+    fades_view->setModel(fades_model);
 
 
     connect(fades_gaps_spin, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), [this] () {
@@ -2485,10 +2522,9 @@ void WobblyWindow::createFadesWindow() {
         updateFadesWindow();
     });
 
-    connect(fades_table, &TableWidget::cellDoubleClicked, [this] (int row, int column) {
-        QTableWidgetItem *item = fades_table->item(row, column);
+    connect(fades_view, &TableView::doubleClicked, [this] (const QModelIndex &index) {
         bool ok;
-        int frame = item->text().toInt(&ok);
+        int frame = index.data().toInt(&ok);
         if (ok)
             requestFrames(frame);
     });
@@ -2500,21 +2536,14 @@ void WobblyWindow::createFadesWindow() {
 
     QVBoxLayout *vbox = new QVBoxLayout;
     vbox->addLayout(hbox);
-    vbox->addWidget(fades_table);
+    vbox->addWidget(fades_view);
 
 
     QWidget *fades_widget = new QWidget;
     fades_widget->setLayout(vbox);
 
 
-    fades_dock = new DockWidget("Interlaced fades", this);
-    fades_dock->setObjectName("interlaced fades window");
-    fades_dock->setVisible(false);
-    fades_dock->setFloating(true);
     fades_dock->setWidget(fades_widget);
-    addDockWidget(Qt::RightDockWidgetArea, fades_dock);
-    tools_menu->addAction(fades_dock->toggleViewAction());
-    connect(fades_dock, &DockWidget::visibilityChanged, fades_dock, &DockWidget::setEnabled);
 }
 
 
@@ -2524,7 +2553,7 @@ void WobblyWindow::createCombedFramesWindow() {
     QPushButton *delete_button = new QPushButton(QStringLiteral("Delete"));
 
     QPushButton *refresh_button = new QPushButton(QStringLiteral("Refresh"));
-    refresh_button->setToolTip(QStringLiteral("Run the 'final' script through tdm.IsCombed to see what frames are still combed."));
+    refresh_button->setToolTip(QStringLiteral("Run the 'final' script through tdm.IsCombed to see what frames are still combed.\nOnly the frames affected by changes made since the last check are looked at again."));
 
 
     connect(combed_view, &TableView::doubleClicked, [this] (const QModelIndex &index) {
@@ -2568,15 +2597,40 @@ void WobblyWindow::createCombedFramesWindow() {
             return;
 
         std::string script;
+        ScriptVariables variables;
 
         try {
-            script = project->generateFinalScript();
+            script = project->generateFinalScript(true, getPreviewScriptFormat(), &variables);
         } catch (WobblyException &e) {
             errorPopup(e.what());
 
             return;
         }
 
+        // Only the frames touched since the last check need to be looked at again.
+        std::vector<FrameRange> dirty_ranges = project->getCombedDirtyRanges();
+        std::vector<int> frames = project->getFramesAfterDecimation(dirty_ranges);
+
+        std::vector<int> source_frames;
+        source_frames.reserve(frames.size());
+        for (size_t i = 0; i < dirty_ranges.size(); i++)
+            for (int frame = dirty_ranges[i].first; frame <= dirty_ranges[i].last; frame++)
+                if (!project->isDecimatedFrame(frame))
+                    source_frames.push_back(frame);
+
+        if (!frames.size()) {
+            if (dirty_ranges.size()) {
+                project->updateCombedFrames(dirty_ranges, std::vector<int>());
+
+                commit("Find combed frames");
+                updateFrameDetails();
+            }
+
+            statusBar()->showMessage(QStringLiteral("No frames changed since the last check for combed frames."), 5000);
+
+            return;
+        }
+
         setEnabled(false);
 
         script += "c.max_cache_size = " + std::to_string(settings_cache_spin->value()) + "\n";
@@ -2589,7 +2643,7 @@ void WobblyWindow::createCombedFramesWindow() {
         progress_dialog->setLabel(new QLabel);
         progress_dialog->reset();
         progress_dialog->setMinimum(0);
-        progress_dialog->setMaximum(project->getNumFrames(PostDecimate));
+        progress_dialog->setMaximum((int)frames.size());
         progress_dialog->setValue(0);
 
         connect(collector, &CombedFramesCollector::errorMessage, this, &WobblyWindow::errorPopup);
@@ -2600,11 +2654,17 @@ void WobblyWindow::createCombedFramesWindow() {
             progress_dialog->setLabelText(QStringLiteral("%1 fps, %2 left").arg(fps, 0, 'f', 2).arg(time_left));
         });
 
-        connect(collector, &CombedFramesCollector::combedFramesCollected, [this] (const std::set<int> &combed_frames) {
-            project->clearCombedFrames();
+        connect(collector, &CombedFramesCollector::combedFramesCollected, [this, dirty_ranges, frames, source_frames] (const std::vector<int> &combed_frames) {
+            std::vector<int> combed_source_frames;
+            combed_source_frames.reserve(combed_frames.size());
+
+            // frames and source_frames line up, so this is just a lookup.
+            for (size_t i = 0; i < combed_frames.size(); i++) {
+                size_t index = std::lower_bound(frames.cbegin(), frames.cend(), combed_frames[i]) - frames.cbegin();
+                combed_source_frames.push_back(source_frames[index]);
+            }
 
-            for (auto it = combed_frames.cbegin(); it != combed_frames.cend(); it++)
-                project->addCombedFrame(project->frameNumberBeforeDecimation(*it));
+            project->updateCombedFrames(dirty_ranges, combed_source_frames);
 
             commit("Find combed frames");
             updateFrameDetails();
@@ -2628,7 +2688,9 @@ void WobblyWindow::createCombedFramesWindow() {
                 setWindowState(windowState() & ~Qt::WindowMinimized);
         });
 
-        collector->start(script, (project_path.isEmpty() ? video_path : project_path).toUtf8().constData());
+        setScriptVariables(variables);
+
+        collector->start(script, (project_path.isEmpty() ? video_path : project_path).toUtf8().constData(), frames);
     });
 
 
@@ -2673,14 +2735,7 @@ void WobblyWindow::createOrphanFieldsWindow() {
     QWidget *orphan_widget = new QWidget;
     orphan_widget->setLayout(vbox);
 
-    orphan_dock = new DockWidget("Orphan fields", this);
-    orphan_dock->setObjectName("orphan fields window");
-    orphan_dock->setVisible(false);
-    orphan_dock->setFloating(true);
     orphan_dock->setWidget(orphan_widget);
-    addDockWidget(Qt::RightDockWidgetArea, orphan_dock);
-    tools_menu->addAction(orphan_dock->toggleViewAction());
-    connect(orphan_dock, &DockWidget::visibilityChanged, orphan_dock, &DockWidget::setEnabled);
 }
 
 
@@ -2743,20 +2798,221 @@ void WobblyWindow::createBookmarksWindow() {
     bookmarks_widget->setLayout(vbox);
 
 
-    bookmarks_dock = new DockWidget(QStringLiteral("Bookmarks"), this);
-    bookmarks_dock->setObjectName(QStringLiteral("bookmarks window"));
-    bookmarks_dock->setVisible(false);
-    bookmarks_dock->setFloating(true);
     bookmarks_dock->setWidget(bookmarks_widget);
-    addDockWidget(Qt::RightDockWidgetArea, bookmarks_dock);
-    tools_menu->addAction(bookmarks_dock->toggleViewAction());
-    connect(bookmarks_dock, &DockWidget::visibilityChanged, bookmarks_dock, &DockWidget::setEnabled);
+}
+
+
+void WobblyWindow::createEditedFramesWindow() {
+    edited_frames_view = new TableView;
+
+    connect(edited_frames_view, &TableView::doubleClicked, [this] (const QModelIndex &index) {
+        bool ok;
+        int frame = index.sibling(index.row(), EditedFramesModel::StartColumn).data().toInt(&ok);
+        if (ok)
+            requestFrames(frame);
+    });
+
+    QVBoxLayout *vbox = new QVBoxLayout;
+    vbox->addWidget(edited_frames_view);
+
+    QWidget *edited_frames_widget = new QWidget;
+    edited_frames_widget->setLayout(vbox);
+
+    edited_frames_dock->setWidget(edited_frames_widget);
+}
+
+
+void WobblyWindow::createProfilerWindow() {
+    profiler_first_spin = new QSpinBox;
+    profiler_first_spin->setRange(0, 9999999);
+    profiler_first_spin->setPrefix(QStringLiteral("First frame: "));
+
+    profiler_last_spin = new QSpinBox;
+    profiler_last_spin->setRange(0, 9999999);
+    profiler_last_spin->setValue(999);
+    profiler_last_spin->setPrefix(QStringLiteral("Last frame: "));
+
+    QPushButton *profiler_run_button = new QPushButton(QStringLiteral("Profile final script"));
+
+    profiler_export_button = new QPushButton(QStringLiteral("Export"));
+    profiler_export_button->setEnabled(false);
+
+    profiler_table = new TableWidget(0, 5, this);
+    profiler_table->setHorizontalHeaderLabels({ "Filter", "Preset", "Nodes", "Frames", "Time (ms)" });
+
+
+    connect(profiler_run_button, &QPushButton::clicked, [this] () {
+        if (!project)
+            return;
+
+        // The presets might have been edited since they were last stored in the project.
+        presetEdited();
+
+        FinalScriptFormat format = getPreviewScriptFormat();
+        format.profile_presets = true;
+
+        std::string script;
+        ScriptVariables variables;
+
+        try {
+            script = project->generateFinalScript(true, format, &variables);
+        } catch (WobblyException &e) {
+            errorPopup(e.what());
+
+            return;
+        }
+
+        script += "c.max_cache_size = " + std::to_string(settings_cache_spin->value()) + "\n";
+
+        setEnabled(false);
+
+        int first = profiler_first_spin->value();
+        int last = std::max(first, profiler_last_spin->value());
+
+        ScriptProfiler *profiler = new ScriptProfiler(vssapi, vsapi, vscore, vsscript);
+
+        ProgressDialog *progress_dialog = new ProgressDialog;
+        progress_dialog->setModal(true);
+        progress_dialog->setWindowTitle(QStringLiteral("Profiling..."));
+        progress_dialog->setLabel(new QLabel);
+        progress_dialog->reset();
+        progress_dialog->setMinimum(0);
+        progress_dialog->setMaximum(last - first + 1);
+        progress_dialog->setValue(0);
+
+        connect(profiler, &ScriptProfiler::errorMessage, this, &WobblyWindow::errorPopup);
+
+        connect(profiler, &ScriptProfiler::progressUpdate, progress_dialog, &QProgressDialog::setValue);
+
+        connect(profiler, &ScriptProfiler::profileCollected, [this] (const ScriptProfile &profile) {
+            last_profile = profile;
+
+            // Count the frames that go through each preset, via the sections and the custom lists.
+            int source_frame = project->frameNumberBeforeDecimation(profile.first_frame);
+
+            for (int n = profile.first_frame; n <= profile.last_frame; n++, source_frame++) {
+                while (source_frame < project->getNumFrames(PostSource) - 1 && project->isDecimatedFrame(source_frame))
+                    source_frame++;
+
+                std::set<std::string> used;
+
+                const Section *section = project->findSection(source_frame);
+                if (section)
+                    for (auto it = section->presets.cbegin(); it != section->presets.cend(); it++)
+                        used.insert(project->getPresetName(*it));
+
+                // The ranges are in source frame numbers, even for the lists after decimation.
+                const CustomListsModel *lists = project->getCustomListsModel();
+                for (size_t i = 0; i < lists->size(); i++)
+                    if (project->findCustomListRange((int)i, source_frame))
+                        used.insert(lists->at(i).preset);
+
+                for (auto it = used.cbegin(); it != used.cend(); it++) {
+                    auto preset = last_profile.presets.find(*it);
+                    if (preset != last_profile.presets.end())
+                        preset->second.frames++;
+                }
+            }
+
+            int frames = profile.last_frame - profile.first_frame + 1;
+
+            profiler_table->setRowCount(0);
+
+            auto addRow = [this] (const QString &filter, const QString &preset, const QString &nodes, const QString &frames, int64_t nanoseconds) {
+                int row = profiler_table->rowCount();
+                profiler_table->insertRow(row);
+                profiler_table->setItem(row, 0, new QTableWidgetItem(filter));
+                profiler_table->setItem(row, 1, new QTableWidgetItem(preset));
+                profiler_table->setItem(row, 2, new QTableWidgetItem(nodes));
+                profiler_table->setItem(row, 3, new QTableWidgetItem(frames));
+                profiler_table->setItem(row, 4, new QTableWidgetItem(QString::number(nanoseconds / 1e6, 'f', 1)));
+            };
+
+            addRow(QStringLiteral("(everything)"), QString(), QString(), QString::number(frames), last_profile.total_nanoseconds);
+
+            for (auto it = last_profile.presets.cbegin(); it != last_profile.presets.cend(); it++)
+                addRow(QStringLiteral("(preset)"), QString::fromStdString(it->first), QString(), QString::number(it->second.frames), it->second.nanoseconds);
+
+            for (size_t i = 0; i < last_profile.filters.size(); i++) {
+                const ProfiledFilter &filter = last_profile.filters[i];
+                addRow(QString::fromStdString(filter.name), QString::fromStdString(filter.preset), QString::number(filter.nodes), QString(), filter.nanoseconds);
+            }
+
+            profiler_table->resizeColumnsToContents();
+
+            profiler_export_button->setEnabled(true);
+
+            statusBar()->showMessage(QStringLiteral("Profiled %1 frames in %2 seconds.").arg(frames).arg(profile.wall_nanoseconds / 1e9, 0, 'f', 2), 5000);
+        });
+
+        connect(profiler, &ScriptProfiler::workFinished, [this, profiler, progress_dialog] () {
+            profiler->deleteLater();
+            progress_dialog->deleteLater();
+
+            setEnabled(true);
+        });
+
+        connect(progress_dialog, &ProgressDialog::canceled, profiler, &ScriptProfiler::stop);
+
+        setScriptVariables(variables);
+
+        profiler->start(script, (project_path.isEmpty() ? video_path : project_path).toUtf8().constData(), first, last);
+    });
+
+    connect(profiler_export_button, &QPushButton::clicked, [this] () {
+        QString path = QFileDialog::getSaveFileName(this, QStringLiteral("Export profile"), settings.value(KEY_LAST_DIR).toString(), QStringLiteral("JSON files (*.json);;CSV files (*.csv)"));
+        if (path.isNull())
+            return;
+
+        std::string contents;
+        if (path.endsWith(QStringLiteral(".csv"), Qt::CaseInsensitive))
+            contents = ScriptProfiler::profileToCSV(last_profile);
+        else
+            contents = ScriptProfiler::profileToJSON(last_profile);
+
+        QFile file(path);
+
+        if (!file.open(QIODevice::WriteOnly)) {
+            errorPopup(("Couldn't open profile file '" + path.toStdString() + "'. Error message: " + file.errorString().toStdString()).c_str());
+            return;
+        }
+
+        file.write(contents.c_str(), contents.size());
+    });
+
+
+    QHBoxLayout *hbox = new QHBoxLayout;
+    hbox->addWidget(profiler_first_spin);
+    hbox->addWidget(profiler_last_spin);
+    hbox->addWidget(profiler_run_button);
+    hbox->addStretch(1);
+    hbox->addWidget(profiler_export_button);
+
+    QVBoxLayout *vbox = new QVBoxLayout;
+    vbox->addLayout(hbox);
+    vbox->addWidget(profiler_table);
+
+
+    QWidget *profiler_widget = new QWidget;
+    profiler_widget->setLayout(vbox);
+
+
+    profiler_dock->setWidget(profiler_widget);
 }
 
 
 void WobblyWindow::createSettingsWindow() {
     settings_compact_projects_check = new QCheckBox("Create compact project files");
 
+    settings_compress_projects_check = new QCheckBox(QStringLiteral("Compress project files"));
+    settings_compress_projects_check->setToolTip(QStringLiteral("Write the project files with gzip. They take a fraction of the space and\nare opened like any other project, also by the VapourSynth plugin."));
+
+    settings_journal_compaction_spin = new SpinBox;
+    settings_journal_compaction_spin->setRange(0, 100000);
+    settings_journal_compaction_spin->setSuffix(QStringLiteral(" edits"));
+    settings_journal_compaction_spin->setSpecialValueText(QStringLiteral("only when saving"));
+    settings_journal_compaction_spin->setToolTip(QStringLiteral("Every edit is recorded in a journal next to the project file, so that it can be\nreplayed after a crash. After this many edits the project file is saved and\nthe journal starts over."));
+
     settings_use_relative_paths_check = new QCheckBox(QStringLiteral("Use relative paths in project files"));
 
     settings_print_details_check = new QCheckBox(QStringLiteral("Print frame details on top of the video"));
@@ -2766,6 +3022,9 @@ void WobblyWindow::createSettingsWindow() {
     settings_decimation_function_combo = new QComboBox;
     settings_decimation_function_combo->addItems({ "Auto", "SelectEvery", "DeleteFrames" });
 
+    settings_use_wobbly_plugin_check = new QCheckBox(QStringLiteral("Use the Wobbly plugin in saved scripts"));
+    settings_use_wobbly_plugin_check->setToolTip(QStringLiteral("The matches, frozen frames, and decimation are read from the project file\nby wobbly.Apply instead of being written into the script, and the sections\nand custom lists are put together with wobbly.Route instead of std.Splice."));
+
     settings_font_spin = new QSpinBox;
     settings_font_spin->setRange(4, 99);
 
@@ -2816,6 +3075,14 @@ void WobblyWindow::createSettingsWindow() {
         settings.setValue(KEY_COMPACT_PROJECT_FILES, checked);
     });
 
+    connect(settings_compress_projects_check, &QCheckBox::toggled, [this] (bool checked) {
+        settings.setValue(KEY_COMPRESS_PROJECT_FILES, checked);
+    });
+
+    connect(settings_journal_compaction_spin, static_cast<void (SpinBox::*)(int)>(&SpinBox::valueChanged), [this] (int value) {
+        settings.setValue(KEY_JOURNAL_COMPACTION_EDITS, value);
+    });
+
     connect(settings_use_relative_paths_check, &QCheckBox::toggled, [this] (bool checked) {
         settings.setValue(KEY_USE_RELATIVE_PATHS, checked);
     });
@@ -2834,6 +3101,10 @@ void WobblyWindow::createSettingsWindow() {
         settings.setValue(KEY_DECIMATION_FUNCTION, text);
     });
 
+    connect(settings_use_wobbly_plugin_check, &QCheckBox::toggled, [this] (bool checked) {
+        settings.setValue(KEY_USE_WOBBLY_PLUGIN, checked);
+    });
+
     connect(settings_font_spin, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), [this] (int value) {
         QFont font = QApplication::font();
         font.setPointSize(value);
@@ -2996,10 +3267,13 @@ void WobblyWindow::createSettingsWindow() {
 
     QFormLayout *form = new QFormLayout;
     form->addRow(settings_compact_projects_check);
+    form->addRow(settings_compress_projects_check);
+    form->addRow(QStringLiteral("Save the project every"), settings_journal_compaction_spin);
     form->addRow(settings_use_relative_paths_check);
     form->addRow(settings_print_details_check);
     form->addRow(settings_bookmark_description_check);
     form->addRow(QStringLiteral("Decimation function"), settings_decimation_function_combo);
+    form->addRow(settings_use_wobbly_plugin_check);
     form->addRow(QStringLiteral("Font size"), settings_font_spin);
     form->addRow(QStringLiteral("Overlay size"), overlay_size_spin);
     form->addRow(QStringLiteral("Application style"), application_style_combo);
@@ -3065,6 +3339,31 @@ void WobblyWindow::createPluginWindow() {
 }
 
 
+DockWidget *WobblyWindow::createLazyDock(const QString &title, const QString &object_name, std::function<void ()> create_contents) {
+    DockWidget *dock = new DockWidget(title, this);
+    dock->setObjectName(object_name);
+    dock->setVisible(false);
+    dock->setFloating(true);
+    addDockWidget(Qt::RightDockWidgetArea, dock);
+    tools_menu->addAction(dock->toggleViewAction());
+    connect(dock, &DockWidget::visibilityChanged, dock, &DockWidget::setEnabled);
+
+    // The dock must exist from the start so restoreState() can find it,
+    // but most of them are never opened, so their widgets can wait.
+    auto connection = std::make_shared<QMetaObject::Connection>();
+    *connection = connect(dock, &DockWidget::visibilityChanged, [connection, create_contents] (bool visible) {
+        if (!visible)
+            return;
+
+        QObject::disconnect(*connection);
+
+        create_contents();
+    });
+
+    return dock;
+}
+
+
 void WobblyWindow::drawColorBars() {
     auto drawRect = [this] (int left, int top, int width, int height, int red, int green, int blue) {
         uint8_t *ptr = splash_image.bits();
@@ -3151,10 +3450,16 @@ void WobblyWindow::createUI() {
     selected_preset_label = new QLabel(QStringLiteral("Selected preset: "));
     selected_custom_list_label = new QLabel(QStringLiteral("Selected custom list: "));
     zoom_label = new QLabel(QStringLiteral("Zoom: 1x"));
+    playback_label = new QLabel;
     statusBar()->addPermanentWidget(selected_preset_label);
     statusBar()->addPermanentWidget(selected_custom_list_label);
+    statusBar()->addPermanentWidget(playback_label);
     statusBar()->addPermanentWidget(zoom_label);
 
+    playback_timer = new QTimer(this);
+    playback_timer->setTimerType(Qt::PreciseTimer);
+    connect(playback_timer, &QTimer::timeout, this, &WobblyWindow::playbackTick);
+
     drawColorBars();
 
     tab_bar = new QTabBar;
@@ -3189,6 +3494,8 @@ void WobblyWindow::createUI() {
     frame_slider->setTracking(false);
     frame_slider->setFocusPolicy(Qt::NoFocus);
 
+    metrics_timeline = new MetricsTimeline;
+
 
     connect(tab_bar, &QTabBar::currentChanged, this, &WobblyWindow::togglePreview);
 
@@ -3203,6 +3510,13 @@ void WobblyWindow::createUI() {
         requestFrames(value);
     });
 
+    connect(metrics_timeline, &MetricsTimeline::frameClicked, [this] (int frame) {
+        if (!project)
+            return;
+
+        requestFrames(frame);
+    });
+
 
     QVBoxLayout *vbox = new QVBoxLayout;
     vbox->addWidget(tab_bar);
@@ -3217,6 +3531,7 @@ void WobblyWindow::createUI() {
     vbox->addLayout(hbox);
 
     vbox->addWidget(frame_slider);
+    vbox->addWidget(metrics_timeline);
 
     QWidget *central_widget = new QWidget;
     central_widget->setLayout(vbox);
@@ -3234,16 +3549,44 @@ void WobblyWindow::createUI() {
     createPatternEditor();
     createSectionsEditor();
     createCustomListsEditor();
-    createFrameRatesViewer();
+    frame_rates_dock = createLazyDock(QStringLiteral("Frame rates"), QStringLiteral("frame rates viewer"), [this] () {
+        createFrameRatesViewer();
+        if (project)
+            initialiseFrameRatesViewer();
+    });
     createFrozenFramesViewer();
     createPatternGuessingWindow();
     createMicSearchWindow();
     createDMetricSearchWindow();
-    createCMatchSequencesWindow();
-    createFadesWindow();
+    c_match_sequences_dock = createLazyDock(QStringLiteral("C match sequences"), QStringLiteral("c match sequences window"), [this] () {
+        createCMatchSequencesWindow();
+        if (project)
+            initialiseCMatchSequencesWindow();
+    });
+    fades_dock = createLazyDock(QStringLiteral("Interlaced fades"), QStringLiteral("interlaced fades window"), [this] () {
+        createFadesWindow();
+        if (project)
+            updateFadesWindow();
+    });
     createCombedFramesWindow();
-    createOrphanFieldsWindow();
-    createBookmarksWindow();
+    orphan_dock = createLazyDock(QStringLiteral("Orphan fields"), QStringLiteral("orphan fields window"), [this] () {
+        createOrphanFieldsWindow();
+        if (project)
+            initialiseOrphanFieldsWindow();
+    });
+    bookmarks_dock = createLazyDock(QStringLiteral("Bookmarks"), QStringLiteral("bookmarks window"), [this] () {
+        createBookmarksWindow();
+        if (project)
+            initialiseBookmarksWindow();
+    });
+    edited_frames_dock = createLazyDock(QStringLiteral("Edited frames"), QStringLiteral("edited frames window"), [this] () {
+        createEditedFramesWindow();
+        if (project)
+            initialiseEditedFramesWindow();
+    });
+    profiler_dock = createLazyDock(QStringLiteral("Profiler"), QStringLiteral("profiler window"), [this] () {
+        createProfilerWindow();
+    });
     createSettingsWindow();
 
 
@@ -3307,6 +3650,57 @@ void WobblyWindow::vsLogPopup(int msgType, const QString &msg) {
 }
 
 
+void WobblyWindow::startVapourSynthInitialisation() {
+    // Importing vapoursynth and loading the plugins takes a while,
+    // so the window is shown in the meantime.
+    vs_init_thread = std::thread([this] () {
+        QString error;
+
+        try {
+            initialiseVapourSynth();
+        } catch (WobblyException &e) {
+            error = e.what();
+        }
+
+        QMetaObject::invokeMethod(this, "vapourSynthInitialised", Qt::QueuedConnection, Q_ARG(QString, error));
+    });
+
+    // This runs once the event loop starts, after the window was shown.
+    QTimer::singleShot(0, this, [this] () {
+        if (startup_window_ms < 0)
+            startup_window_ms = startup_timer.elapsed();
+    });
+}
+
+
+void WobblyWindow::vapourSynthInitialised(const QString &error) {
+    if (vs_init_thread.joinable())
+        vs_init_thread.join();
+
+    if (startup_window_ms < 0)
+        startup_window_ms = startup_timer.elapsed();
+
+    if (!error.isEmpty()) {
+        errorPopup(error.toUtf8().constData());
+        exit(1);
+    }
+
+    createPluginWindow();
+
+    vs_ready = true;
+
+    statusBar()->showMessage(QStringLiteral("Window shown after %1 ms, VapourSynth ready after %2 ms.").arg(startup_window_ms).arg(startup_timer.elapsed()), 5000);
+
+    if (!pending_open_path.isEmpty()) {
+        QString path = pending_open_path;
+        pending_open_path.clear();
+
+        openFile(path);
+    }
+}
+
+
+// Runs in vs_init_thread.
 void WobblyWindow::initialiseVapourSynth() {
     GetVSScriptAPIFunc newVSScriptAPI = fetchVSScript();
 
@@ -3335,6 +3729,9 @@ void WobblyWindow::initialiseVapourSynth() {
 
 
 void WobblyWindow::cleanUpVapourSynth() {
+    if (playing)
+        stopPlayback();
+
     frame_label->setPixmap(QPixmap());
     for (int i = 0; i < MAX_THUMBNAILS; i++)
         thumb_labels[i]->setPixmap(QPixmap());
@@ -3418,14 +3815,20 @@ void WobblyWindow::initialiseCropAssistant() {
     depth_dither_combo->setCurrentIndex(dither_to_index[depth.dither]);
 
 
+    updateCropOverlay();
+
     connect(crop_dock, &DockWidget::visibilityChanged, [this] {
         if (!project)
             return;
 
-        try {
-            evaluateMainDisplayScript();
-        } catch (WobblyException &) {
+        updateCropOverlay();
+
+        if (preview) {
+            try {
+                evaluateFinalScript();
+            } catch (WobblyException &) {
 
+            }
         }
     });
 }
@@ -3461,7 +3864,7 @@ void WobblyWindow::initialiseSectionsEditor() {
         if (ok) {
             const Section *section = project->findSection(frame);
             for (auto it = section->presets.cbegin(); it != section->presets.cend(); it++)
-                section_presets_list->addItem(QString::fromStdString(*it));
+                section_presets_list->addItem(QString::fromStdString(project->getPresetName(*it)));
         }
     });
 
@@ -3481,7 +3884,7 @@ void WobblyWindow::initialiseSectionsEditor() {
         if (ok) {
             const Section *section = project->findSection(frame);
             for (auto it = section->presets.cbegin(); it != section->presets.cend(); it++)
-                section_presets_list->addItem(QString::fromStdString(*it));
+                section_presets_list->addItem(QString::fromStdString(project->getPresetName(*it)));
         }
     });
 }
@@ -3515,82 +3918,27 @@ void WobblyWindow::initialiseCustomListsEditor() {
 }
 
 
-void WobblyWindow::updateFrameRatesViewer() {
-    auto selection = frame_rates_table->selectedRanges();
+void WobblyWindow::initialiseFrameRatesViewer() {
+    if (!frame_rates_view)
+        return;
 
-    int row_count_before = frame_rates_table->rowCount();
+    auto rates = project->getShownFrameRates();
 
-    int verScrollValue = frame_rates_table->verticalScrollBar()->value();
+    for (int i = 0; i < 5; i++)
+        frame_rates_buttons->button(i)->setChecked(rates[i]);
 
-    frame_rates_table->setRowCount(0);
+    frame_rates_proxy_model->setShownRates(rates);
+    frame_rates_proxy_model->setSourceModel(project->getFrameRatesModel());
 
-    auto ranges = project->getDecimationRanges();
+    frame_rates_view->resizeColumnsToContents();
+}
 
-    int rows = 0;
-    for (size_t i = 0; i < ranges.size(); i++) {
-        if (frame_rates_buttons->button(ranges[i].num_dropped)->isChecked()) {
-            rows++;
-            frame_rates_table->setRowCount(rows);
-
-            QTableWidgetItem *item = new QTableWidgetItem(QString::number(ranges[i].start));
-            item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
-            frame_rates_table->setItem(rows - 1, 0, item);
-
-            int end;
-            if (i < ranges.size() - 1)
-                end = ranges[i + 1].start - 1;
-            else
-                end = project->getNumFrames(PostSource) - 1;
-
-            item = new QTableWidgetItem(QString::number(end));
-            item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
-            frame_rates_table->setItem(rows - 1, 1, item);
-
-            const char *rates[] = {
-                "30000/1001",
-                "24000/1001",
-                "18000/1001",
-                "12000/1001",
-                "6000/1001"
-            };
-            item = new QTableWidgetItem(rates[ranges[i].num_dropped]);
-            item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
-            frame_rates_table->setItem(rows - 1, 2, item);
 
-            item = new QTableWidgetItem(QString::number(end - ranges[i].start + 1));
-            item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
-            frame_rates_table->setItem(rows - 1, 3, item);
-        }
-    }
+void WobblyWindow::initialiseFrozenFramesViewer() {
+    frozen_frames_view->setModel(project->getFrozenFramesModel());
 
-    frame_rates_table->resizeColumnsToContents();
-
-    int row_count_after = frame_rates_table->rowCount();
-
-    if (row_count_before == row_count_after) {
-        for (int i = 0; i < selection.size(); i++)
-            frame_rates_table->setRangeSelected(selection[i], true);
-    } else if (row_count_after) {
-        frame_rates_table->verticalScrollBar()->setValue(verScrollValue);
-    }
-}
-
-
-void WobblyWindow::initialiseFrameRatesViewer() {
-    auto rates = project->getShownFrameRates();
-
-    for (int i = 0; i < 5; i++)
-        frame_rates_buttons->button(i)->setChecked(rates[i]);
-
-    updateFrameRatesViewer();
-}
-
-
-void WobblyWindow::initialiseFrozenFramesViewer() {
-    frozen_frames_view->setModel(project->getFrozenFramesModel());
-
-    frozen_frames_view->resizeColumnsToContents();
-}
+    frozen_frames_view->resizeColumnsToContents();
+}
 
 
 void WobblyWindow::updatePatternGuessingWindow() {
@@ -3659,83 +4007,48 @@ void WobblyWindow::initialiseDMetricSearchWindow() {
 }
 
 void WobblyWindow::updateCMatchSequencesWindow() {
-    const auto &sequences = project->getCMatchSequences(c_match_minimum_spin->value());
-
-    c_match_sequences_table->setRowCount(0);
-    c_match_sequences_table->setRowCount(sequences.size());
-
-    int row = 0;
-    for (auto it = sequences.cbegin(); it != sequences.cend(); it++) {
-        QTableWidgetItem *item = new QTableWidgetItem(QString::number(it->first));
-        item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
-        c_match_sequences_table->setItem(row, 0, item);
-
-        item = new QTableWidgetItem(QString::number(it->second));
-        item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
-        c_match_sequences_table->setItem(row, 1, item);
-
-        row++;
-    }
-
-    if (sequences.size())
-        c_match_sequences_table->selectRow(0);
+    if (!c_match_sequences_view)
+        return;
 
-    c_match_sequences_table->resizeColumnsToContents();
+    project->updateCMatchSequences();
 }
 
 
 void WobblyWindow::initialiseCMatchSequencesWindow() {
+    if (!c_match_sequences_view)
+        return;
+
     {
         QSignalBlocker block(c_match_minimum_spin);
         c_match_minimum_spin->setValue(project->getCMatchSequencesMinimum());
     }
 
-    updateCMatchSequencesWindow();
+    project->updateCMatchSequences();
+
+    c_match_sequences_view->setModel(project->getCMatchSequencesModel());
+
+    c_match_sequences_view->resizeColumnsToContents();
 }
 
 
 void WobblyWindow::updateFadesWindow() {
-    auto fades = project->getInterlacedFades();
+    if (!fades_view)
+        return;
+
+    const auto &fades = project->getInterlacedFades();
 
     int ignore_gaps = fades_gaps_spin->value();
 
     std::vector<FrameRange> fades_ranges;
 
-    auto it = fades.cbegin();
-    if (it == fades.cend()) {
-        fades_table->setRowCount(0);
-        return;
-    }
-
-    int start = it->first;
-    int end = start;
-
-    it++;
-    for ( ; it != fades.cend(); it++) {
-        if (it->first - end - 1 > ignore_gaps) {
-            fades_ranges.push_back({ start, end });
-            start = it->first;
-            end = start;
-        } else {
-            end = it->first;
-        }
-        if (it == (fades.cend()--))
-            fades_ranges.push_back({ start, end });
+    for (auto it = fades.cbegin(); it != fades.cend(); it++) {
+        if (fades_ranges.size() && it->first - fades_ranges.back().last - 1 <= ignore_gaps)
+            fades_ranges.back().last = it->first;
+        else
+            fades_ranges.push_back({ it->first, it->first });
     }
 
-    fades_table->setRowCount(fades_ranges.size());
-
-    for (auto range = fades_ranges.cbegin(); range != fades_ranges.cend(); range++) {
-        int row = std::distance(fades_ranges.cbegin(), range);
-
-        QTableWidgetItem *item = new QTableWidgetItem(QString::number(range->first));
-        item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
-        fades_table->setItem(row, 0, item);
-
-        item = new QTableWidgetItem(QString::number(range->last));
-        item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
-        fades_table->setItem(row, 1, item);
-    }
+    fades_model->setRows(fades_ranges);
 }
 
 
@@ -3747,16 +4060,45 @@ void WobblyWindow::initialiseCombedFramesWindow() {
 
 
 void WobblyWindow::initialiseOrphanFieldsWindow() {
+    if (!orphan_view)
+        return;
+
     orphan_view->setModel(project->getOrphanFieldsModel());
 
     orphan_view->resizeColumnsToContents();
 }
 
 
+void WobblyWindow::updateEditedFramesWindow() {
+    if (!edited_frames_view)
+        return;
+
+    project->updateEditedFrames();
+}
+
+
+void WobblyWindow::initialiseEditedFramesWindow() {
+    if (!edited_frames_view)
+        return;
+
+    project->updateEditedFrames();
+
+    edited_frames_view->setModel(project->getEditedFramesModel());
+
+    edited_frames_view->resizeColumnsToContents();
+}
+
+
 void WobblyWindow::initialiseBookmarksWindow() {
+    if (!bookmarks_view)
+        return;
+
     bookmarks_view->setModel(project->getBookmarksModel());
 
-    connect(project->getBookmarksModel(), &BookmarksModel::dataChanged, [this] (const QModelIndex &topLeft, const QModelIndex &bottomRight) {
+    // The dock may have been created for this project already.
+    disconnect(project->getBookmarksModel(), &BookmarksModel::dataChanged, this, nullptr);
+
+    connect(project->getBookmarksModel(), &BookmarksModel::dataChanged, this, [this] (const QModelIndex &topLeft, const QModelIndex &bottomRight) {
         commit("Rename bookmark");
         if (topLeft == bottomRight) {
             int frame = bookmarks_view->model()->index(topLeft.row(), BookmarksModel::FrameColumn).data().toInt();
@@ -3784,6 +4126,11 @@ void WobblyWindow::initialiseUIFromProject() {
     project->setUndoSteps(size_t(settings.value(KEY_UNDO_STEPS, 50).toInt()));
     project->updateOrphanFields();
 
+    metrics_timeline->setProject(project);
+}
+
+
+void WobblyWindow::initialiseDocksFromProject() {
     initialiseCropAssistant();
     initialisePresetEditor();
     initialiseSectionsEditor();
@@ -3798,53 +4145,86 @@ void WobblyWindow::initialiseUIFromProject() {
     initialiseCombedFramesWindow();
     initialiseOrphanFieldsWindow();
     initialiseBookmarksWindow();
+    initialiseEditedFramesWindow();
 }
 
 
 void WobblyWindow::realOpenProject(const QString &path) {
-    WobblyProject *tmp = new WobblyProject(true);
+    if (!vs_ready) {
+        pending_open_path = path;
+        statusBar()->showMessage(QStringLiteral("Waiting for VapourSynth to finish loading..."));
+        return;
+    }
 
-    try {
-        QApplication::setOverrideCursor(Qt::WaitCursor);
+    if (playing)
+        stopPlayback();
 
-        tmp->readProject(path.toStdString());
+    setEnabled(false);
 
-        QApplication::restoreOverrideCursor();
+    // The project is read in the background. Whatever project was open
+    // before stays there if reading fails or is cancelled.
+    ProjectLoader *loader = new ProjectLoader(vssapi, vsscript, path.toStdString());
 
+    ProgressDialog *progress_dialog = new ProgressDialog;
+    progress_dialog->setModal(true);
+    progress_dialog->setWindowTitle(QStringLiteral("Opening project..."));
+    progress_dialog->setLabel(new QLabel);
+    progress_dialog->reset();
+    progress_dialog->setMinimum(0);
+    progress_dialog->setMaximum(1);
+    progress_dialog->setValue(0);
+
+    connect(loader, &ProjectLoader::errorMessage, this, &WobblyWindow::errorPopup);
+
+    connect(loader, &ProjectLoader::progressUpdate, [progress_dialog] (int step, int steps) {
+        progress_dialog->setMaximum(steps);
+        progress_dialog->setValue(step);
+    });
+
+    connect(loader, &ProjectLoader::projectLoaded, [this, path] (WobblyProject *loaded) {
         project_path = path;
         video_path.clear();
 
         if (project)
             delete project;
-        project = tmp;
+        project = loaded;
 
         addRecentFile(path);
 
         current_frame = project->getLastVisitedFrame();
 
-        initialiseUIFromProject();
-        project->commit("Initial");
-
-        vssapi->evaluateBuffer(vsscript, "vs.clear_output(1)", "wobbly.cleanup");
+        try {
+            initialiseUIFromProject();
+            project->commit("Initial");
 
-        connect(project, &WobblyProject::modifiedChanged, this, &WobblyWindow::updateWindowTitle);
+            connect(project, &WobblyProject::modifiedChanged, this, &WobblyWindow::updateWindowTitle);
+            connect(project, &WobblyProject::editJournalled, this, &WobblyWindow::editJournalled);
+            connect(project, &WobblyProject::journalFailed, this, &WobblyWindow::journalFailed);
 
-        evaluateMainDisplayScript();
-    } catch (WobblyException &e) {
-        QApplication::restoreOverrideCursor();
+            startProjectJournal(true);
 
-        errorPopup(e.what());
+            // The first frames are requested before the big models are attached to the docks.
+            evaluateMainDisplayScript();
+        } catch (WobblyException &e) {
+            errorPopup(e.what());
 
-        if (tmp != project) {
-            // If readProject failed then we don't need tmp.
-            // We carry on with whatever project was open previously (if any).
-            delete tmp;
-        } else {
-            // If it was evaluateMainDisplayScript that failed, then just request the current frame.
             // Obviously it won't display anything, but it will update the user interface.
             requestFrames(current_frame);
         }
-    }
+
+        initialiseDocksFromProject();
+    });
+
+    connect(loader, &ProjectLoader::workFinished, [this, loader, progress_dialog] () {
+        loader->deleteLater();
+        progress_dialog->deleteLater();
+
+        setEnabled(true);
+    });
+
+    connect(progress_dialog, &ProgressDialog::canceled, loader, &ProjectLoader::stop);
+
+    loader->start();
 }
 
 
@@ -3876,6 +4256,12 @@ const char *WobblyWindow::getArgsForSourceFilter(const QString &source_filter) {
 }
 
 void WobblyWindow::realOpenVideo(const QString &path) {
+    if (!vs_ready) {
+        pending_open_path = path;
+        statusBar()->showMessage(QStringLiteral("Waiting for VapourSynth to finish loading..."));
+        return;
+    }
+
     try {
         QString source_filter;
 
@@ -3938,6 +4324,7 @@ void WobblyWindow::realOpenVideo(const QString &path) {
         project_path.clear();
 
         initialiseUIFromProject();
+        initialiseDocksFromProject();
         project->commit("Initial");
 
         vssapi->evaluateBuffer(vsscript, "vs.clear_output(1)", "wobbly.cleanup");
@@ -3947,6 +4334,8 @@ void WobblyWindow::realOpenVideo(const QString &path) {
         addRecentFile(path);
 
         connect(project, &WobblyProject::modifiedChanged, this, &WobblyWindow::updateWindowTitle);
+        connect(project, &WobblyProject::editJournalled, this, &WobblyWindow::editJournalled);
+        connect(project, &WobblyProject::journalFailed, this, &WobblyWindow::journalFailed);
     } catch(WobblyException &e) {
         errorPopup(e.what());
     }
@@ -3984,7 +4373,7 @@ void WobblyWindow::realSaveProject(const QString &path) {
     QApplication::setOverrideCursor(Qt::WaitCursor);
 
     try {
-        project->writeProject(path.toStdString(), settings_compact_projects_check->isChecked());
+        project->writeProject(path.toStdString(), settings_compact_projects_check->isChecked(), settings_compress_projects_check->isChecked());
     } catch (WobblyException &e) {
         QApplication::restoreOverrideCursor();
 
@@ -3999,6 +4388,63 @@ void WobblyWindow::realSaveProject(const QString &path) {
     updateWindowTitle();
 
     addRecentFile(path);
+
+    startProjectJournal(false);
+}
+
+
+// Offers to replay the edits a crash left in the project's journal,
+// then records the new ones there.
+void WobblyWindow::startProjectJournal(bool offer_replay) {
+    std::string path = project_path.toStdString();
+
+    try {
+        bool keep_edits = false;
+
+        int edits = offer_replay ? WobblyProject::countJournalEdits(path) : 0;
+        if (edits) {
+            QMessageBox::StandardButton answer = QMessageBox::question(this, QStringLiteral("Replay edits?"), QStringLiteral("The project has %1 edits that were never saved, probably because Wobbly crashed. Replay them?").arg(edits), QMessageBox::Yes | QMessageBox::No, QMessageBox::Yes);
+
+            if (answer == QMessageBox::Yes) {
+                project->replayJournal(path);
+                project->updateOrphanFields();
+                updateUndoActions();
+
+                keep_edits = true;
+            }
+        }
+
+        project->startJournal(path, keep_edits);
+    } catch (WobblyException &e) {
+        errorPopup(e.what());
+    }
+}
+
+
+void WobblyWindow::editJournalled(int edits) {
+    int compaction = settings_journal_compaction_spin->value();
+    if (!compaction || edits < compaction)
+        return;
+
+    // Not in the middle of whatever made the edit.
+    QTimer::singleShot(0, this, [this] () {
+        int compaction = settings_journal_compaction_spin->value();
+        if (!project || project_path.isEmpty() || !compaction || project->getJournalEdits() < compaction)
+            return;
+
+        try {
+            realSaveProject(project_path);
+
+            statusBar()->showMessage(QStringLiteral("Saved the project after %1 edits.").arg(compaction), 5000);
+        } catch (WobblyException &e) {
+            errorPopup(e.what());
+        }
+    });
+}
+
+
+void WobblyWindow::journalFailed(const std::string &error) {
+    errorPopup(("Unsaved edits are no longer recorded in the journal. " + error).c_str());
 }
 
 
@@ -4049,6 +4495,15 @@ void WobblyWindow::realSaveScript(const QString &path) {
     else
         format.decimation_function = DecimationFunction::AUTO;
 
+    if (settings_use_wobbly_plugin_check->isChecked()) {
+        // The plugin reads the project from disk, so what's there must be up to date.
+        if (project_path.isEmpty() || project->isModified())
+            throw WobblyException("Can't save a script that uses the Wobbly plugin: the project must be saved first.");
+
+        format.wobbly_plugin = true;
+        format.project_path = QFileInfo(project_path).absoluteFilePath().toStdString();
+    }
+
     std::string script = project->generateFinalScript(false, format);
 
     QFile file(path);
@@ -4187,7 +4642,7 @@ void WobblyWindow::saveScreenshot() {
     if (!path.isNull()) {
         settings.setValue(KEY_LAST_DIR, QFileInfo(path).absolutePath());
 
-        frame_label->pixmap(Qt::ReturnByValue).scaled(original_frame_width, original_frame_height, Qt::IgnoreAspectRatio, Qt::FastTransformation).save(path, "png");
+        frame_label->getPixmap().save(path, "png");
     }
 }
 
@@ -4322,6 +4777,7 @@ void WobblyWindow::importFromProject() {
                 project->importFromOtherProject(file_name.toStdString(), imports);
 
                 initialiseUIFromProject();
+                initialiseDocksFromProject();
 
                 requestFrames(current_frame);
 
@@ -4427,18 +4883,54 @@ void WobblyWindow::showHideBookmarksWindow() {
 }
 
 
+void WobblyWindow::showHideEditedFramesWindow() {
+    edited_frames_dock->setVisible(!edited_frames_dock->isVisible());
+}
+
+
 void WobblyWindow::showHideFrameDetailsOnVideo() {
     settings_print_details_check->setChecked(!settings_print_details_check->isChecked());
 }
 
 
+FinalScriptFormat WobblyWindow::getPreviewScriptFormat() const {
+    FinalScriptFormat format{};
+
+    // Projects with many sections evaluate much faster with wobbly.Route, if it's installed.
+    format.wobbly_plugin = !!vsapi->getPluginByID(WOBBLY_PLUGIN_ID, vscore);
+
+    return format;
+}
+
+
+void WobblyWindow::setScriptVariables(const ScriptVariables &variables) {
+    VSMap *map = vsapi->createMap();
+
+    for (auto it = variables.data.cbegin(); it != variables.data.cend(); it++)
+        vsapi->mapSetData(map, it->first.c_str(), it->second.data(), (int)it->second.size(), dtBinary, maReplace);
+
+    for (auto it = variables.int_arrays.cbegin(); it != variables.int_arrays.cend(); it++)
+        vsapi->mapSetIntArray(map, it->first.c_str(), it->second.data(), (int)it->second.size());
+
+    vssapi->setVariables(vsscript, map);
+
+    vsapi->freeMap(map);
+}
+
+
 void WobblyWindow::evaluateScript(bool final_script) {
     std::string script;
 
+    // The big tables don't go through Python's parser, which makes
+    // evaluating the script much faster with long videos.
+    ScriptVariables variables;
+
     if (final_script)
-        script = project->generateFinalScript();
+        script = project->generateFinalScript(true, getPreviewScriptFormat(), &variables);
     else
-        script = project->generateMainDisplayScript();
+        script = project->generateMainDisplayScript(&variables);
+
+    setScriptVariables(variables);
 
     QString m = settings_colormatrix_combo->currentText();
     std::string matrix = "709";
@@ -4472,28 +4964,9 @@ void WobblyWindow::evaluateScript(bool final_script) {
             "if src.format is None:\n"
             "    raise vs.Error('The output clip has unknown format. Wobbly cannot display such clips.')\n";
 
-    if (crop_dock->isVisible() && project->isCropEnabled() && !final_script) {
-        script += "src = c.std.CropRel(clip=src, left=";
-        script += std::to_string(crop_spin[0]->value()) + ", top=";
-        script += std::to_string(crop_spin[1]->value()) + ", right=";
-        script += std::to_string(crop_spin[2]->value()) + ", bottom=";
-        script += std::to_string(crop_spin[3]->value()) + ")\n";
-
-        script +=
-                "src = c.resize.Bicubic(clip=src, format=vs.RGB24, dither_type='random', matrix_in_s='" + matrix + "', transfer_in_s='" + transfer + "', primaries_in_s='" + primaries + "')\n";
-
-        script += "src = c.std.AddBorders(clip=src, left=";
-        script += std::to_string(crop_spin[0]->value()) + ", top=";
-        script += std::to_string(crop_spin[1]->value()) + ", right=";
-        script += std::to_string(crop_spin[2]->value()) + ", bottom=";
-        script += std::to_string(crop_spin[3]->value()) + ", color=[224, 81, 255])\n";
-
-        script += "c.query_video_format(vs.GRAY, vs.INTEGER, 32, 0, 0)\n";
-    } else {
-        script +=
+    script +=
             "c.query_video_format(vs.GRAY, vs.INTEGER, 32, 0, 0)\n"
             "src = c.resize.Bicubic(clip=src, format=vs.RGB24, dither_type='random', matrix_in_s='" + matrix + "', transfer_in_s='" + transfer + "', primaries_in_s='" + primaries + "')\n";
-    }
 
     script +=
             "src.set_output()\n";
@@ -4552,6 +5025,10 @@ void VS_CC frameDoneCallback(void *userData, const VSFrame *f, int n, VSNode *,
 
 
 void WobblyWindow::requestFrames(int n) {
+    // Anything that wants to show a particular frame interrupts the playback.
+    if (playing)
+        stopPlayback();
+
     n = std::max(0, std::min(n, project->getNumFrames(PostSource) - 1));
 
     current_frame = n;
@@ -4561,6 +5038,8 @@ void WobblyWindow::requestFrames(int n) {
         frame_slider->setValue(n);
     }
 
+    metrics_timeline->setCurrentFrame(n);
+
     current_pict_type.clear();
     updateFrameDetails();
 
@@ -4636,15 +5115,13 @@ void WobblyWindow::frameDone(void *framev, int n, bool preview_node, const QStri
         offset = n - pending_frame;
 
     if (offset == 0) {
-        int zoom = project->getZoom();
-        frame_label->setPixmap(QPixmap::fromImage(image).scaled(width * zoom, height * zoom, Qt::IgnoreAspectRatio, Qt::FastTransformation));
+        frame_label->setZoom(project->getZoom());
+        frame_label->setPixmap(QPixmap::fromImage(image));
 
         // setOverrideCursor called in requestFrames
         QApplication::restoreOverrideCursor();
 
         current_pict_type = pict_type;
-        original_frame_width = width;
-        original_frame_height = height;
 
         // current_pict_type has changed
         updateFrameDetails();
@@ -4652,11 +5129,232 @@ void WobblyWindow::frameDone(void *framev, int n, bool preview_node, const QStri
 
     thumb_labels[offset + MAX_THUMBNAILS / 2]->setPixmap(getThumbnail(image));
 
-    if (!pending_requests && pending_frame != current_frame)
+    if (!pending_requests && pending_frame != current_frame && !playing)
         requestFrames(current_frame);
 }
 
 
+void VS_CC playbackFrameDoneCallback(void *userData, const VSFrame *f, int n, VSNode *, const char *errorMsg) {
+    PlaybackCallbackData *callback_data = (PlaybackCallbackData *)userData;
+
+    callback_data->vsapi->freeNode(callback_data->node);
+
+    QMetaObject::invokeMethod(callback_data->window, "playbackFrameDone", Qt::QueuedConnection,
+                              Q_ARG(void *, (void *)f),
+                              Q_ARG(int, n),
+                              Q_ARG(int, callback_data->generation),
+                              Q_ARG(QString, QString(errorMsg)));
+
+    delete callback_data;
+}
+
+
+void WobblyWindow::togglePlayback() {
+    if (!project)
+        return;
+
+    if (playing) {
+        stopPlayback();
+
+        // Bring back the thumbnails and the frame details.
+        requestFrames(current_frame);
+    } else {
+        startPlayback();
+    }
+}
+
+
+void WobblyWindow::startPlayback() {
+    VSNode *node = vsnode[(int)preview];
+    if (!node)
+        return;
+
+    const VSVideoInfo *vi = vsapi->getVideoInfo(node);
+
+    playback_fps_num = vi->fpsNum;
+    playback_fps_den = vi->fpsDen;
+
+    if (!playback_fps_num) {
+        // Variable frame rate, e.g. the preview with mixed decimation.
+        // Use the source's frame rate scaled by the overall decimation ratio.
+        const VSVideoInfo *source_vi = vsnode[0] ? vsapi->getVideoInfo(vsnode[0]) : nullptr;
+        if (!source_vi || !source_vi->fpsNum)
+            return;
+
+        playback_fps_num = source_vi->fpsNum * project->getNumFrames(preview ? PostDecimate : PostSource);
+        playback_fps_den = source_vi->fpsDen * project->getNumFrames(PostSource);
+    }
+
+    playback_start = preview ? project->frameNumberAfterDecimation(current_frame) : current_frame;
+    if (playback_start >= vi->numFrames - 1)
+        playback_start = 0;
+
+    playing = true;
+    playback_generation++;
+    playback_requests = 0;
+    playback_next_request = playback_start;
+    playback_last_shown = playback_start - 1;
+    playback_frames_shown = 0;
+    playback_frames_dropped = 0;
+    playback_frames.clear();
+
+    playback_clock.start();
+
+    // Check twice per frame, so frames aren't shown much later than they should be.
+    playback_timer->start(std::max(1, (int)(playback_fps_den * 500 / playback_fps_num)));
+
+    requestPlaybackFrames();
+
+    updatePlaybackLabel();
+}
+
+
+void WobblyWindow::stopPlayback() {
+    playing = false;
+    playback_generation++;
+    playback_requests = 0;
+    playback_frames.clear();
+    playback_timer->stop();
+
+    updatePlaybackLabel();
+}
+
+
+int WobblyWindow::getPlaybackTarget() const {
+    return playback_start + (int)(playback_clock.elapsed() * playback_fps_num / (playback_fps_den * 1000));
+}
+
+
+void WobblyWindow::requestPlaybackFrames() {
+    VSNode *node = vsnode[(int)preview];
+
+    int last_frame = vsapi->getVideoInfo(node)->numFrames - 1;
+
+    // Frames that are already late are not even requested.
+    int target = getPlaybackTarget();
+    if (playback_next_request < target) {
+        playback_frames_dropped += target - playback_next_request;
+        playback_next_request = target;
+    }
+
+    VSCoreInfo core_info;
+    vsapi->getCoreInfo(vscore, &core_info);
+
+    int max_requests = std::max(2, core_info.numThreads);
+
+    while (playback_requests < max_requests && playback_next_request <= last_frame) {
+        playback_requests++;
+        PlaybackCallbackData *callback_data = new PlaybackCallbackData(this, vsapi->addNodeRef(node), playback_generation, vsapi);
+        vsapi->getFrameAsync(playback_next_request, node, playbackFrameDoneCallback, (void *)callback_data);
+        playback_next_request++;
+    }
+}
+
+
+// Runs in the GUI thread.
+void WobblyWindow::playbackFrameDone(void *framev, int n, int generation, const QString &errorMsg) {
+    const VSFrame *frame = (const VSFrame *)framev;
+
+    if (generation != playback_generation) {
+        vsapi->freeFrame(frame);
+        return;
+    }
+
+    playback_requests--;
+
+    if (!frame) {
+        stopPlayback();
+
+        errorPopup(QStringLiteral("Failed to retrieve frame %1. Error message: %2").arg(n).arg(errorMsg).toUtf8().constData());
+
+        return;
+    }
+
+    if (n < getPlaybackTarget()) {
+        // Too late to be shown.
+        playback_frames_dropped++;
+        vsapi->freeFrame(frame);
+    } else {
+        int width = vsapi->getFrameWidth(frame, 0);
+        int height = vsapi->getFrameHeight(frame, 0);
+        uint8_t *frame_data = packRGBFrame(vsapi, frame);
+        vsapi->freeFrame(frame);
+
+        playback_frames.insert({ n, QImage(frame_data, width, height, width * 4, QImage::Format_RGB32, free, frame_data) });
+    }
+
+    requestPlaybackFrames();
+}
+
+
+void WobblyWindow::playbackTick() {
+    if (!playing)
+        return;
+
+    int target = getPlaybackTarget();
+
+    // Show the newest frame that is due. Anything older is dropped.
+    auto due = playback_frames.upper_bound(target);
+    if (due != playback_frames.begin()) {
+        auto newest = std::prev(due);
+
+        playback_frames_dropped += (int)std::distance(playback_frames.begin(), newest);
+
+        int n = newest->first;
+
+        frame_label->setZoom(project->getZoom());
+        frame_label->setPixmap(QPixmap::fromImage(newest->second));
+
+        playback_frames.erase(playback_frames.begin(), due);
+
+        playback_last_shown = n;
+        playback_frames_shown++;
+
+        current_frame = preview ? project->frameNumberBeforeDecimation(n) : n;
+
+        {
+            QSignalBlocker block(frame_slider);
+            frame_slider->setValue(current_frame);
+        }
+
+        current_pict_type.clear();
+        updateFrameDetails();
+    }
+
+    int last_frame = vsapi->getVideoInfo(vsnode[(int)preview])->numFrames - 1;
+
+    if (playback_last_shown >= last_frame || (playback_next_request > last_frame && !playback_requests && playback_frames.empty())) {
+        // Reached the end.
+        stopPlayback();
+        requestFrames(current_frame);
+        return;
+    }
+
+    requestPlaybackFrames();
+
+    updatePlaybackLabel();
+}
+
+
+void WobblyWindow::updatePlaybackLabel() {
+    double target_fps = (double)playback_fps_num / playback_fps_den;
+
+    qint64 elapsed = playback_clock.isValid() ? playback_clock.elapsed() : 0;
+    double achieved_fps = elapsed ? playback_frames_shown * 1000.0 / elapsed : 0.0;
+
+    if (!playing && !playback_frames_shown) {
+        playback_label->clear();
+        return;
+    }
+
+    playback_label->setText(QStringLiteral("%1: %2 of %3 fps, %4 dropped")
+                            .arg(playing ? QStringLiteral("Playing") : QStringLiteral("Paused"))
+                            .arg(achieved_fps, 0, 'f', 2)
+                            .arg(target_fps, 0, 'f', 3)
+                            .arg(playback_frames_dropped));
+}
+
+
 void WobblyWindow::updateFrameDetails() {
     if (!project)
         return;
@@ -4772,7 +5470,7 @@ void WobblyWindow::updateFrameDetails() {
     for (auto it = current_section->presets.cbegin(); it != current_section->presets.cend(); it++) {
         if (!presets.isEmpty())
             presets += "\n";
-        presets += QString::fromStdString(*it);
+        presets += QString::fromStdString(project->getPresetName(*it));
     }
 
     if (presets.isNull())
@@ -5051,6 +5749,40 @@ void WobblyWindow::jumpToNextCombedFrame() {
 }
 
 
+void WobblyWindow::jumpToNextPatternMismatch() {
+    if (!project)
+        return;
+
+    // The pattern editor lets through patterns that are still being typed.
+    if (match_pattern.size() < 5)
+        return;
+
+    int frame = project->findNextPatternMismatch(current_frame, match_pattern.toStdString());
+    if (frame != current_frame)
+        requestFrames(frame);
+}
+
+
+void WobblyWindow::jumpToNextEditedRange() {
+    if (!project)
+        return;
+
+    int frame = project->findNextEditedRange(current_frame);
+    if (frame != current_frame)
+        requestFrames(frame);
+}
+
+
+void WobblyWindow::jumpToPreviousEditedRange() {
+    if (!project)
+        return;
+
+    int frame = project->findPreviousEditedRange(current_frame);
+    if (frame != current_frame)
+        requestFrames(frame);
+}
+
+
 void WobblyWindow::jumpToPreviousCombedFrame() {
     if (!project)
         return;
@@ -5237,8 +5969,6 @@ void WobblyWindow::toggleDecimation() {
     jumpRelative(0);
 
     updateFrameDetails();
-
-    updateFrameRatesViewer();
 }
 
 
@@ -5467,8 +6197,6 @@ void WobblyWindow::rotateAndSetPatterns() {
 
     updateSectionOrphanFields(section);
 
-    updateFrameRatesViewer();
-
     updateCMatchSequencesWindow();
 
     try {
@@ -5519,8 +6247,6 @@ void WobblyWindow::setDecimationPattern() {
 
     cancelRange();
 
-    updateFrameRatesViewer();
-
     if (project)
         project->updateOrphanFields();
 
@@ -5547,8 +6273,6 @@ void WobblyWindow::setMatchAndDecimationPatterns() {
 
     cancelRange();
 
-    updateFrameRatesViewer();
-
     updateSectionOrphanFields(current_frame);
 
     updateCMatchSequencesWindow();
@@ -5611,8 +6335,6 @@ void WobblyWindow::guessCurrentSectionPatternsFromMics() {
     QApplication::restoreOverrideCursor();
 
     if (success) {
-        updateFrameRatesViewer();
-
         updateSectionOrphanFields(current_frame);
 
         updateCMatchSequencesWindow();
@@ -5657,8 +6379,6 @@ void WobblyWindow::guessCurrentSectionPatternsFromDMetrics() {
     QApplication::restoreOverrideCursor();
 
     if (success) {
-        updateFrameRatesViewer();
-
         updateSectionOrphanFields(current_frame);
 
         updateCMatchSequencesWindow();
@@ -5703,8 +6423,6 @@ void WobblyWindow::guessCurrentSectionPatternsFromMicsAndDMetrics() {
     QApplication::restoreOverrideCursor();
 
     if (success) {
-        updateFrameRatesViewer();
-
         updateSectionOrphanFields(current_frame);
 
         updateCMatchSequencesWindow();
@@ -5739,8 +6457,6 @@ void WobblyWindow::guessProjectPatternsFromMics() {
 
         updatePatternGuessingWindow();
 
-        updateFrameRatesViewer();
-
         updateCMatchSequencesWindow();
 
         evaluateScript(preview);
@@ -5774,8 +6490,6 @@ void WobblyWindow::guessProjectPatternsFromDMetrics() {
 
         updatePatternGuessingWindow();
 
-        updateFrameRatesViewer();
-
         updateCMatchSequencesWindow();
 
         evaluateScript(preview);
@@ -5809,8 +6523,6 @@ void WobblyWindow::guessProjectPatternsFromMicsAndDMetrics() {
 
         updatePatternGuessingWindow();
 
-        updateFrameRatesViewer();
-
         updateCMatchSequencesWindow();
 
         evaluateScript(preview);
@@ -5838,8 +6550,6 @@ void WobblyWindow::guessCurrentSectionPatternsFromMatches() {
     QApplication::restoreOverrideCursor();
 
     if (success) {
-        updateFrameRatesViewer();
-
         updateCMatchSequencesWindow();
 
         try {
@@ -5864,8 +6574,6 @@ void WobblyWindow::guessProjectPatternsFromMatches() {
 
     updatePatternGuessingWindow();
 
-    updateFrameRatesViewer();
-
     updateCMatchSequencesWindow();
 
     QApplication::restoreOverrideCursor();
@@ -5903,6 +6611,16 @@ void WobblyWindow::togglePreview() {
         QSignalBlocker block(tab_bar);
         tab_bar->setCurrentIndex((int)preview);
     }
+
+    updateCropOverlay();
+}
+
+
+void WobblyWindow::updateCropOverlay() {
+    // The final script already includes the cropping.
+    bool enabled = project && crop_dock->isVisible() && project->isCropEnabled() && !preview;
+
+    frame_label->setCropOverlay(enabled, QMargins(crop_spin[0]->value(), crop_spin[1]->value(), crop_spin[2]->value(), crop_spin[3]->value()));
 }
 
 void WobblyWindow::undo() {
@@ -5922,6 +6640,7 @@ void WobblyWindow::commit(std::string message) {
     project->commit(message);
 
     updateUndoActions();
+    updateEditedFramesWindow();
 }
 
 void WobblyWindow::updateUndoActions() {
@@ -5954,9 +6673,9 @@ void WobblyWindow::updateAfterUndo() {
     updateUndoActions();
 
     project->updateOrphanFields();
-    updateFrameRatesViewer();
     updatePatternGuessingWindow();
     updateCMatchSequencesWindow();
+    updateEditedFramesWindow();
     updateFadesWindow();
     presetChanged(preset_combo->currentText());
 
@@ -5972,11 +6691,9 @@ void WobblyWindow::zoom(bool in) {
     if ((!in && zoom > 1) || (in && zoom < 8)) {
         zoom += in ? 1 : -1;
         project->setZoom(zoom);
-        try {
-            requestFrames(current_frame);
-        } catch (WobblyException &e) {
-            errorPopup(e.what());
-        }
+
+        // The frame is scaled while painting, so there is no need to request it again.
+        frame_label->setZoom(zoom);
     }
 
     zoom_label->setText(QStringLiteral("Zoom: %1x").arg(zoom));
@@ -6249,7 +6966,7 @@ void WobblyWindow::copyCurrentFrameNumberToClipboard() {
 void WobblyWindow::copyCurrentFrameImageToClipboard() {
     if(project != nullptr) {
         QClipboard *clipboard = QGuiApplication::clipboard();
-        clipboard->setPixmap(frame_label->pixmap(Qt::ReturnByValue).scaled(original_frame_width, original_frame_height, Qt::IgnoreAspectRatio, Qt::FastTransformation));
+        clipboard->setPixmap(frame_label->getPixmap());
     }
 }
 
@@ -22,30 +22,40 @@ SOFTWARE.
 #define WOBBLYWINDOW_H
 
 
+#include <functional>
+#include <thread>
+
 #include <QCheckBox>
 #include <QCloseEvent>
 #include <QComboBox>
+#include <QElapsedTimer>
 #include <QGroupBox>
 #include <QLabel>
 #include <QLineEdit>
 #include <QListWidget>
 #include <QMainWindow>
 #include <QMessageBox>
+#include <QPushButton>
 #include <QSettings>
 #include <QSignalMapper>
 #include <QSlider>
 #include <QSpinBox>
 #include <QStringListModel>
+#include <QTimer>
 
 #include <VapourSynth4.h>
 #include <VSScript4.h>
 
 #include "DockWidget.h"
+#include "FadesModel.h"
 #include "FrameLabel.h"
+#include "FrameRatesProxyModel.h"
 #include "ImportWindow.h"
 #include "ListWidget.h"
+#include "MetricsTimeline.h"
 #include "OverlayLabel.h"
 #include "PresetTextEdit.h"
+#include "ScriptProfiler.h"
 #include "ScrollArea.h"
 #include "SectionsProxyModel.h"
 #include "SpinBox.h"
@@ -83,6 +93,7 @@ private:
     QLabel *thumb_labels[MAX_THUMBNAILS];
     OverlayLabel *overlay_label;
     QSlider *frame_slider;
+    MetricsTimeline *metrics_timeline;
 
     QLabel *frame_num_label;
     QLabel *time_label;
@@ -101,6 +112,7 @@ private:
     QLabel *selected_preset_label;
     QLabel *selected_custom_list_label;
     QLabel *zoom_label;
+    QLabel *playback_label;
 
     DockWidget *crop_dock;
     QSpinBox *crop_spin[4];
@@ -136,9 +148,11 @@ private:
     QButtonGroup *cl_position_group;
     TableView *cl_ranges_view;
 
-    QButtonGroup *frame_rates_buttons;
+    // The contents of some docks are only created when the dock is first shown.
+    QButtonGroup *frame_rates_buttons = nullptr;
     DockWidget *frame_rates_dock;
-    TableWidget *frame_rates_table;
+    FrameRatesProxyModel *frame_rates_proxy_model = nullptr;
+    TableView *frame_rates_view = nullptr;
 
     DockWidget *frozen_frames_dock;
     TableView *frozen_frames_view;
@@ -158,27 +172,40 @@ private:
     QSpinBox *dmetric_search_minimum_spin;
 
     DockWidget *c_match_sequences_dock;
-    QSpinBox *c_match_minimum_spin;
-    TableWidget *c_match_sequences_table;
+    QSpinBox *c_match_minimum_spin = nullptr;
+    TableView *c_match_sequences_view = nullptr;
 
     DockWidget *fades_dock;
-    QSpinBox *fades_gaps_spin;
-    TableWidget *fades_table;
+    QSpinBox *fades_gaps_spin = nullptr;
+    FadesModel *fades_model = nullptr;
+    TableView *fades_view = nullptr;
 
     DockWidget *combed_dock;
     TableView *combed_view;
 
     DockWidget *orphan_dock;
-    TableView *orphan_view;
+    TableView *orphan_view = nullptr;
 
     DockWidget *bookmarks_dock;
-    TableView *bookmarks_view;
+    TableView *bookmarks_view = nullptr;
+
+    DockWidget *edited_frames_dock;
+    TableView *edited_frames_view = nullptr;
+
+    DockWidget *profiler_dock;
+    QSpinBox *profiler_first_spin = nullptr;
+    QSpinBox *profiler_last_spin = nullptr;
+    TableWidget *profiler_table = nullptr;
+    QPushButton *profiler_export_button = nullptr;
+    ScriptProfile last_profile;
 
     DockWidget *settings_dock;
     QSpinBox *settings_font_spin;
     QSpinBox *overlay_size_spin;
     QComboBox *application_style_combo;
     QCheckBox *settings_compact_projects_check;
+    QCheckBox *settings_compress_projects_check;
+    SpinBox *settings_journal_compaction_spin;
     QCheckBox *settings_use_relative_paths_check;
     QComboBox *settings_colormatrix_combo;
     QSpinBox *settings_cache_spin;
@@ -186,6 +213,7 @@ private:
     QCheckBox *settings_print_details_check;
     QCheckBox *settings_bookmark_description_check;
     QComboBox *settings_decimation_function_combo;
+    QCheckBox *settings_use_wobbly_plugin_check;
     SpinBox *settings_num_thumbnails_spin;
     QDoubleSpinBox *settings_thumbnail_size_dspin;
     TableWidget *settings_shortcuts_table;
@@ -214,6 +242,21 @@ private:
     int pending_requests = 0;
     VSNode *pending_requests_node = nullptr; // Don't free, it's just a copy.
 
+    // Playback. Frame numbers are those of the node being played.
+    bool playing = false;
+    int playback_generation = 0; // Frames requested by an earlier playback are thrown away.
+    int playback_requests = 0;
+    int playback_start = 0;
+    int playback_next_request = 0;
+    int playback_last_shown = -1;
+    int playback_frames_shown = 0;
+    int playback_frames_dropped = 0;
+    int64_t playback_fps_num = 0;
+    int64_t playback_fps_den = 1;
+    QElapsedTimer playback_clock;
+    QTimer *playback_timer;
+    std::map<int, QImage> playback_frames; // Arrived, but not shown yet.
+
     QString match_pattern;
     QString decimation_pattern;
 
@@ -237,8 +280,6 @@ private:
     QSettings settings;
 
     QString current_pict_type;
-    int original_frame_width;
-    int original_frame_height;
 
 
     // VapourSynth stuff.
@@ -249,6 +290,15 @@ private:
     VSCore *vscore = nullptr;
     VSNode *vsnode[2] = {};
 
+    // Python and the plugins are loaded in this thread while the window comes up.
+    // It fills in the fields above, so the GUI thread must not look at them until
+    // vs_ready is set, which happens only after the thread was joined.
+    std::thread vs_init_thread;
+    bool vs_ready = false;
+    QString pending_open_path; // Opened once VapourSynth is ready.
+    QElapsedTimer startup_timer;
+    qint64 startup_window_ms = -1;
+
 
     // Functions
 
@@ -271,8 +321,11 @@ private:
     void createCombedFramesWindow();
     void createOrphanFieldsWindow();
     void createBookmarksWindow();
+    void createEditedFramesWindow();
+    void createProfilerWindow();
     void createSettingsWindow();
     void createPluginWindow();
+    DockWidget *createLazyDock(const QString &title, const QString &object_name, std::function<void ()> create_contents);
     void drawColorBars();
     void createUI();
 
@@ -281,6 +334,7 @@ private:
     void readSettings();
     void writeSettings();
 
+    void startVapourSynthInitialisation();
     void initialiseVapourSynth();
     void cleanUpVapourSynth();
 
@@ -290,7 +344,6 @@ private:
     void initialisePresetEditor();
     void initialiseSectionsEditor();
     void initialiseCustomListsEditor();
-    void updateFrameRatesViewer();
     void initialiseFrameRatesViewer();
     void initialiseFrozenFramesViewer();
     void updatePatternGuessingWindow();
@@ -303,12 +356,23 @@ private:
     void initialiseCombedFramesWindow();
     void initialiseOrphanFieldsWindow();
     void initialiseBookmarksWindow();
+    void updateEditedFramesWindow();
+    void initialiseEditedFramesWindow();
     void initialiseUIFromProject();
+    void initialiseDocksFromProject();
 
+    FinalScriptFormat getPreviewScriptFormat() const;
+    void setScriptVariables(const ScriptVariables &variables);
     void evaluateScript(bool final_script);
+    void updateCropOverlay();
     void evaluateMainDisplayScript();
     void evaluateFinalScript();
     void requestFrames(int n);
+    void startPlayback();
+    void stopPlayback();
+    int getPlaybackTarget() const;
+    void requestPlaybackFrames();
+    void updatePlaybackLabel();
     void updateFrameDetails();
 
     void errorPopup(const char *msg);
@@ -324,6 +388,7 @@ private:
     void realOpenProject(const QString &path);
     void realOpenVideo(const QString &path);
     void realSaveProject(const QString &path);
+    void startProjectJournal(bool offer_replay);
     void realSaveScript(const QString &path);
     void realSaveTimecodes(const QString &path);
     void realSaveSections(const QString &path);
@@ -386,6 +451,11 @@ public slots:
     void jumpToPreviousCombedFrame();
     void jumpToNextCombedFrame();
 
+    void jumpToNextPatternMismatch();
+
+    void jumpToPreviousEditedRange();
+    void jumpToNextEditedRange();
+
     void jumpToPreviousPatternFailureSection();
     void jumpToNextPatternFailureSection();
 
@@ -436,6 +506,7 @@ public slots:
     void showHideCombedFramesWindow();
     void showHideOrphanFieldsWindow();
     void showHideBookmarksWindow();
+    void showHideEditedFramesWindow();
 
     void showHideFrameDetailsOnVideo();
 
@@ -464,6 +535,9 @@ public slots:
 
     void togglePreview();
 
+    void togglePlayback();
+    void playbackTick();
+
     void zoomIn();
     void zoomOut();
 
@@ -473,8 +547,12 @@ public slots:
     void updateUndoActions();
     void updateAfterUndo();
 
+    void vapourSynthInitialised(const QString &error);
+    void editJournalled(int edits);
+    void journalFailed(const std::string &error);
     void vsLogPopup(int msgType, const QString &msg);
     void frameDone(void *framev, int n, bool preview_node, const QString &errorMsg);
+    void playbackFrameDone(void *framev, int n, int generation, const QString &errorMsg);
 };
 
 #endif // WOBBLYWINDOW_H